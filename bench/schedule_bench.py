@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Timetable dispatch jitter over a simulated day of periods.
+
+Builds the firmwares for the PlatformIO `native` env like session_bench.py,
+stores one roster per period with POST /rosters and a day of hourly periods
+with POST /timetable, then walks the master's clock through the day: before
+each period the clock is set (POST /time) to --lead-ms ahead of its start, so
+the day runs in seconds instead of hours. For every period it records
+
+  late_ms      start time -> dispatch, as the master measured it (from
+               GET /timetable "last", also sent with the "scheduled" event)
+  observed_ms  the same seen from the host: POST /time -> "scheduled" event
+               on GET /events, minus --lead-ms (includes HTTP latency)
+
+and checks the session ran to a /results upload. Exits non-zero if a period
+was missed, never uploaded, or was dispatched later than --max-late-ms.
+
+  bench/schedule_bench.py
+  bench/schedule_bench.py --periods 12 -o schedule.json
+"""
+
+import argparse
+import calendar
+import json
+import os
+import queue
+import shutil
+import socket
+import sys
+import tempfile
+import threading
+import time
+
+from session_bench import (ADDRESSES, DEFAULT_WORK_DIR, ResultsServer, Rig, build, make_roster,
+                           percentile, post_text, request, roster_lines)
+
+DAY = calendar.timegm((2026, 10, 19, 0, 0, 0))  # A Monday; the clock is local time
+MONDAY = 1
+
+
+class EventStream:
+    """GET /events, queued as (monotonic time, event, data)."""
+
+    def __init__(self, port):
+        self.events = queue.Queue()
+        self.sock = socket.create_connection(("127.0.0.1", port))
+        self.sock.sendall(b"GET /events HTTP/1.1\r\nHost: master\r\nAccept: text/event-stream\r\n\r\n")
+        threading.Thread(target=self.read, daemon=True).start()
+
+    def read(self):
+        buffer = b""
+        event, data = None, None
+        while True:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                return
+            buffer += chunk
+            while b"\n" in buffer:
+                line, buffer = buffer.split(b"\n", 1)
+                line = line.rstrip(b"\r").decode(errors="replace")
+                if line.startswith("event:"):
+                    event = line[6:].strip()
+                elif line.startswith("data:"):
+                    data = line[5:].strip()
+                elif not line and event:
+                    self.events.put((time.monotonic(), event, data))
+                    event, data = None, None
+
+    def wait_for(self, name, timeout):
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            try:
+                at, event, data = self.events.get(timeout=remaining)
+            except queue.Empty:
+                return None
+            if event == name:
+                return at, json.loads(data)
+
+    def close(self):
+        self.sock.close()
+
+
+def wait_halt(port, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        status, body = request(port, "/status")
+        if status == 200 and json.loads(body).get("state") == "HALT":
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--periods", type=int, default=8, help="hourly periods from 09:00 (default 8)")
+    parser.add_argument("--roster", type=int, default=30, help="USNs per room per period")
+    parser.add_argument("--window-ms", type=int, default=2000,
+                        help="slave ACTIVE window compiled into the bench build (default 2000)")
+    parser.add_argument("--lead-ms", type=int, default=2000, help="clock set this far before each start")
+    parser.add_argument("--max-late-ms", type=float, default=100.0,
+                        help="fail if the master dispatches later than this (default 100)")
+    parser.add_argument("--timeout", type=float, default=60.0, help="per-period limit in seconds")
+    parser.add_argument("-o", "--output", help="write the JSON report here (default stdout)")
+    parser.add_argument("--pio", default="pio", help="PlatformIO CLI")
+    parser.add_argument("--work-dir", default=DEFAULT_WORK_DIR)
+    parser.add_argument("--skip-build", action="store_true", help="reuse binaries in --work-dir")
+    args = parser.parse_args()
+    if not 1 <= args.periods <= 15:
+        parser.error("--periods must be 1..15 (09:00 to 23:00)")
+
+    window = f"-DACTIVE_DURATION={args.window_ms}"
+    binaries = {
+        "master": build(args, "master", "master", ""),
+        "RVU101": build(args, "slave", "slave-rvu101", f"{window} '-DSLAVE_ADDRESS=\"RVU101\"'"),
+        "RVU102": build(args, "slave", "slave-rvu102", f"{window} '-DSLAVE_ADDRESS=\"RVU102\"'"),
+    }
+
+    data_dir = tempfile.mkdtemp(prefix="schedule-bench-")
+    results = ResultsServer()
+    rig = Rig(args, binaries, results, master_extra=["--data-dir", data_dir])
+    report = {"version": 1, "periods": [], "window_ms": args.window_ms, "lead_ms": args.lead_ms}
+    failures = []
+    stream = None
+    try:
+        rig.wait_ready()
+        periods = []
+        for i in range(args.periods):
+            name = f"p{9 + i:02d}"
+            rosters = {a: make_roster(10 * i + r, args.roster) for r, a in enumerate(ADDRESSES)}
+            status, body = post_text(rig.master_port, f"/rosters?name={name}", roster_lines(rosters))
+            if status != 200:
+                raise RuntimeError(f"POST /rosters {name}: {status} {body}")
+            periods.append({"days": [MONDAY], "start": f"{9 + i:02d}:00", "roster": name})
+        status, body = request(rig.master_port, "/timetable", {"now": DAY + 8 * 3600, "periods": periods})
+        if status != 200:
+            raise RuntimeError(f"POST /timetable: {status} {body}")
+
+        stream = EventStream(rig.master_port)
+        for i, period in enumerate(periods):
+            start = DAY + (9 + i) * 3600
+            results.reset()
+            t_set = time.monotonic()
+            request(rig.master_port, "/time", {"now": start - args.lead_ms // 1000})
+            scheduled = stream.wait_for("scheduled", args.lead_ms / 1000.0 + 5.0)
+            row = {"roster": period["roster"], "start": period["start"]}
+            if scheduled is None:
+                failures.append(f"{period['roster']} never dispatched")
+                row["status"] = "missed"
+            else:
+                at, data = scheduled
+                row.update(late_ms=data["late_ms"],
+                           observed_ms=round((at - t_set) * 1000.0 - args.lead_ms, 1))
+                if data["roster"] != period["roster"]:
+                    failures.append(f"{period['roster']}: dispatched {data['roster']} instead")
+                if data["late_ms"] > args.max_late_ms:
+                    failures.append(f"{period['roster']}: {data['late_ms']} ms late")
+                uploaded = results.event.wait(args.timeout)
+                row["status"] = "ok" if uploaded else "no_upload"
+                if not uploaded:
+                    failures.append(f"{period['roster']}: no /results upload")
+            report["periods"].append(row)
+            print(f"[schedule] {row['start']} {row['roster']}: {row['status']}"
+                  f" late={row.get('late_ms')}ms observed={row.get('observed_ms')}ms", file=sys.stderr)
+            if not wait_halt(rig.master_port, args.timeout):
+                failures.append(f"{period['roster']}: master never returned to HALT")
+                break
+
+        status, body = request(rig.master_port, "/timetable")
+        timetable = json.loads(body)
+        report["missed"] = timetable["missed"]
+        if timetable["missed"]:
+            failures.append(f"master counted {timetable['missed']} missed periods")
+    finally:
+        if stream:
+            stream.close()
+        rig.close()
+        results.close()
+        shutil.rmtree(data_dir, ignore_errors=True)
+
+    late = [p["late_ms"] for p in report["periods"] if "late_ms" in p]
+    observed = [p["observed_ms"] for p in report["periods"] if "observed_ms" in p]
+    if late:
+        report["late_ms"] = {"p50": percentile(late, 50), "p95": percentile(late, 95), "max": max(late)}
+        report["observed_ms"] = {"p50": percentile(observed, 50), "p95": percentile(observed, 95),
+                                 "max": max(observed)}
+        print(f"[schedule] late p50={report['late_ms']['p50']}ms p95={report['late_ms']['p95']}ms"
+              f" max={report['late_ms']['max']}ms; observed p50={report['observed_ms']['p50']}ms"
+              f" max={report['observed_ms']['max']}ms", file=sys.stderr)
+    report["failures"] = failures
+
+    text = json.dumps(report, indent=2) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    for line in failures:
+        print(f"[schedule] FAIL {line}", file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
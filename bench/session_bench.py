@@ -0,0 +1,528 @@
+#!/usr/bin/env python3
+"""End-to-end session benchmark for the master/slave firmwares.
+
+Builds both firmwares for the PlatformIO `native` env (common/Hal/native),
+wires one master and two slaves together over socketpairs, stands in for the
+/results server, and times whole attendance sessions over a matrix of
+rooms x roster size x marking rate:
+
+  start_ms         POST /start round trip                    (handleStartTask)
+  dispatch_ms      /start accepted -> last slave serving HTTP (link negotiation,
+                   roster transfer, slave roster parsing)
+  mark_rate        /attendance taps per second achieved       (handleAttendance)
+  mark_p50_ms, mark_p95_ms  tap latency
+                   (each USN taps from its own 127.0.x.y address, one
+                   phone per student, so per-client limits see real clients)
+  reply_upload_ms  slave window end -> /results received     (reply transfer,
+                   processUARTData(), upload)
+  e2e_ms           POST /start -> /results received
+
+Per-zone time (PROFILE_ZONE totals) and the heap peak come from each device's GET /profile.
+Results are written as JSON and compared against a checked-in baseline
+(bench/baseline.json); a metric that is worse than the baseline by more than
+--tolerance and an absolute floor is reported as a regression and the script
+exits non-zero.
+
+The firmware has exactly two links (RVU101, RVU102), so `rooms` is 1 or 2;
+with one room the second slave still runs with an empty roster because the
+master always waits for both. A roster larger than the session arena
+allows (see loadTasks()) is refused with 413 and recorded as "rejected", not
+as a failure; the full matrix keeps such sizes so the refusal is covered too.
+
+  bench/session_bench.py                      # quick matrix, compare
+  bench/session_bench.py --matrix full -o out.json
+  bench/session_bench.py --update-baseline    # after an intended change
+
+Baselines are machine-specific: the report records the machine, compiler
+and ArduinoJson version it was built with, and a baseline from another
+configuration is not compared against. Regenerate on the machine that runs
+the comparison.
+"""
+
+import argparse
+import http.client
+import http.server
+import json
+import os
+import platform
+import socket
+import subprocess
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_BASELINE = os.path.join(ROOT, "bench", "baseline.json")
+DEFAULT_WORK_DIR = os.path.join(ROOT, "bench", ".build")
+
+ADDRESSES = ["RVU101", "RVU102"]
+MASTER_RX_PIN = {"RVU101": 12, "RVU102": 5}  # softSerial / softSerial2 in master/src/main.cpp
+SLAVE_RX_PIN = 14                              # soft(14, 5) in slave/src/main.cpp
+
+MATRICES = {
+    "quick": {"rooms": [2], "roster": [30], "rate": [20]},
+    "full": {"rooms": [1, 2], "roster": [30, 60, 120, 250, 2000], "rate": [5, 20, 50]},
+}
+
+# Metrics where larger is better; everything else is a cost
+HIGHER_IS_BETTER = {"mark_rate"}
+# Differences below these never count as regressions (timer and scheduler noise)
+ABSOLUTE_FLOOR = {"ms": 25.0, "us": 5000.0, "bytes": 1024.0, "rate": 1.0}
+
+MASTER_ZONES = ["start_task", "link_negotiate", "dispatch", "uart_rx", "parse_reply", "upload"]
+SLAVE_ZONES = ["uart_rx", "parse_roster", "attendance", "json_parse"]
+
+
+# ==================== BUILD ====================
+def build(args, project, name, flags):
+    build_dir = os.path.join(args.work_dir, name)
+    program = os.path.join(build_dir, "native", "program")
+    if args.skip_build and os.path.exists(program):
+        return program
+    env = dict(os.environ, PLATFORMIO_BUILD_DIR=build_dir, PLATFORMIO_BUILD_FLAGS=flags)
+    print(f"[build] {name}: {flags or '(default flags)'}", file=sys.stderr)
+    subprocess.run([args.pio, "run", "-d", os.path.join(ROOT, project), "-e", "native"],
+                   env=env, check=True, stdout=subprocess.DEVNULL)
+    return program
+
+
+# ==================== HTTP HELPERS ====================
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def request(port, path, body=None, timeout=5.0):
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(f"http://127.0.0.1:{port}{path}", data=data,
+                                 method="POST" if data is not None else "GET")
+    if data is not None:
+        req.add_header("Content-Type", "application/json")
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            return resp.status, resp.read().decode()
+    except urllib.error.HTTPError as e:
+        return e.code, e.read().decode()
+
+
+def post_text(port, path, text):
+    req = urllib.request.Request(f"http://127.0.0.1:{port}{path}", data=text.encode(), method="POST")
+    req.add_header("Content-Type", "text/plain")
+    try:
+        with urllib.request.urlopen(req, timeout=5.0) as resp:
+            return resp.status, resp.read().decode()
+    except urllib.error.HTTPError as e:
+        return e.code, e.read().decode()
+
+
+def roster_lines(rosters):
+    """ADDRESS|USN1|USN2|... lines, as POST /rosters takes them."""
+    return "".join(f"{address}|{'|'.join(usns)}\n" for address, usns in rosters.items())
+
+
+def try_request(port, path):
+    try:
+        return request(port, path, timeout=0.5)
+    except (OSError, urllib.error.URLError):
+        return None, None
+
+
+class ResultsServer:
+    """Stand-in for the laptop's /results endpoint."""
+
+    def __init__(self):
+        self.uploads = []
+        self.event = threading.Event()
+        owner = self
+
+        class Handler(http.server.BaseHTTPRequestHandler):
+            def do_POST(self):
+                body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+                owner.uploads.append((time.monotonic(), self.path, body))
+                owner.event.set()
+                self.send_response(200)
+                self.send_header("Content-Length", "2")
+                self.end_headers()
+                self.wfile.write(b"ok")
+
+            def log_message(self, *args):
+                pass
+
+        self.server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+        self.port = self.server.server_address[1]
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+
+    def reset(self):
+        self.uploads.clear()
+        self.event.clear()
+
+    def close(self):
+        self.server.shutdown()
+
+
+# ==================== ONE SESSION ====================
+class Rig:
+    """One master and two slaves wired like the real boards."""
+
+    def __init__(self, args, binaries, results, master_extra=()):
+        self.procs = []
+        self.master_port = free_port()
+        self.slave_ports = {}
+        master_args = [binaries["master"], "--http-port", str(self.master_port),
+                       "--upstream", f"127.0.0.1:{results.port}", "--quiet", *master_extra]
+        keep = []
+        for address in ADDRESSES:
+            # One socketpair per slave: the master's shared TX reaches every
+            # port with the same TX pin, each slave's TX reaches one master RX
+            master_end, slave_end = socket.socketpair()
+            keep += [master_end, slave_end]
+            master_args += ["--serial", f"{MASTER_RX_PIN[address]}=fd:{master_end.fileno()}"]
+            self.slave_ports[address] = free_port()
+            self.spawn([binaries[address], "--http-port", str(self.slave_ports[address]),
+                        "--serial", f"{SLAVE_RX_PIN}=fd:{slave_end.fileno()}", "--quiet"],
+                       slave_end.fileno())
+        self.spawn(master_args, *[s.fileno() for s in keep[0::2]])
+        for s in keep:
+            s.close()
+
+    def spawn(self, argv, *fds):
+        self.procs.append(subprocess.Popen(argv, pass_fds=fds, stdout=subprocess.DEVNULL))
+
+    def wait_ready(self, timeout=10.0):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            if try_request(self.master_port, "/status")[0] == 200:
+                time.sleep(0.1)  # Slaves have no endpoint before ACTIVE; let setup() finish
+                return
+            time.sleep(0.05)
+        raise RuntimeError("master did not come up")
+
+    def close(self):
+        for p in self.procs:
+            p.kill()
+        for p in self.procs:
+            p.wait()
+
+
+def make_roster(room, size):
+    return [f"1RV2{room}CS{i:04d}" for i in range(size)]
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(round(p / 100.0 * (len(ordered) - 1))))]
+
+
+def zone_totals(profile, names, prefix, out):
+    for zone in profile.get("zones", []):
+        if zone["name"] in names:
+            out[f"{prefix}.{zone['name']}_us"] = zone["total_us"]
+
+
+def phone_address(i):
+    """Loopback source address for the i-th phone, so the slave sees one client IP per student."""
+    return f"127.0.{1 + i // 250}.{1 + i % 250}"
+
+
+def post_from(port, source, path, body, timeout=5.0):
+    conn = http.client.HTTPConnection("127.0.0.1", port, timeout=timeout, source_address=(source, 0))
+    try:
+        conn.request("POST", path, json.dumps(body), {"Content-Type": "application/json"})
+        resp = conn.getresponse()
+        return resp.status, resp.read().decode()
+    finally:
+        conn.close()
+
+
+def tap(port, usns, rate, latencies, errors):
+    interval = 1.0 / rate
+    next_at = time.monotonic()
+    for i, usn in enumerate(usns):
+        delay = next_at - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        next_at += interval
+        t = time.monotonic()
+        try:
+            status, _ = post_from(port, phone_address(i), "/attendance", {"usn": usn, "status": "success"})
+        except (OSError, http.client.HTTPException):
+            status = None
+        if status == 200:
+            latencies.append((time.monotonic() - t) * 1000.0)
+        else:
+            errors.append(status)
+
+
+def run_case(args, binaries, results, rooms, roster, rate):
+    name = f"rooms{rooms}-roster{roster}-rate{rate}"
+    case = {"name": name, "rooms": rooms, "roster": roster, "rate": rate}
+    window_s = args.window_ms / 1000.0
+    addressed = ADDRESSES[:rooms]
+    rosters = {a: make_roster(i, roster) for i, a in enumerate(addressed)}
+
+    results.reset()
+    rig = Rig(args, binaries, results)
+    try:
+        rig.wait_ready()
+        t0 = time.monotonic()
+        status, body = request(rig.master_port, "/start",
+                               {"tasks": [{"address": a, "usns": rosters[a]} for a in addressed]})
+        start_ms = (time.monotonic() - t0) * 1000.0
+        if status != 200:
+            case.update(status="rejected", http_status=status, detail=body.strip()[:120])
+            return case
+
+        # A slave only serves HTTP once it has parsed its roster and gone ACTIVE
+        active_at = {}
+        deadline = t0 + args.timeout
+        while len(active_at) < len(addressed) and time.monotonic() < deadline:
+            for a in addressed:
+                if a not in active_at and try_request(rig.slave_ports[a], "/stations")[0] == 200:
+                    active_at[a] = time.monotonic()
+            time.sleep(0.002)
+        if len(active_at) < len(addressed):
+            case.update(status="failed", detail="roster never reached " +
+                        ",".join(a for a in addressed if a not in active_at))
+            return case
+        dispatch_ms = (max(active_at.values()) - t0) * 1000.0
+
+        # Tap as many distinct USNs as fit in most of the window. A slave marks
+        # about 9 a second at most (each mark blinks its LED for 100 ms), which
+        # the default window allows for the full matrix's largest roster.
+        taps = min(roster, int(rate * window_s * 0.7))
+        latencies, errors, threads = [], [], []
+        mark_start = time.monotonic()
+        for a in addressed:
+            th = threading.Thread(target=tap, args=(rig.slave_ports[a], rosters[a][:taps],
+                                                    rate, latencies, errors))
+            th.start()
+            threads.append(th)
+        for th in threads:
+            th.join()
+        mark_elapsed = time.monotonic() - mark_start
+
+        # Slaves stop serving HTTP when the window closes, so read them now
+        zones, heap = {}, {}
+        for a in addressed:
+            status, body = try_request(rig.slave_ports[a], "/profile")
+            if status == 200:
+                profile = json.loads(body)
+                zone_totals(profile, SLAVE_ZONES, f"slave{a[-3:]}", zones)
+                heap[f"slave{a[-3:]}"] = profile.get("heap_peak", 0)
+
+        if not results.event.wait(max(0.0, deadline - time.monotonic())):
+            case.update(status="failed", detail="no /results upload before timeout")
+            return case
+        uploaded_at, _, payload = results.uploads[0]
+
+        status, body = request(rig.master_port, "/profile")
+        if status == 200:
+            profile = json.loads(body)
+            zone_totals(profile, MASTER_ZONES, "master", zones)
+            heap["master"] = profile.get("heap_peak", 0)
+
+        # Every tap must come back in the upload
+        marked = {r["address"]: len(r["usns"]) for r in json.loads(payload).get("results", [])}
+        expected = {a: taps for a in addressed}
+        correct = not errors and all(marked.get(a, 0) == n for a, n in expected.items())
+
+        window_end = min(active_at.values()) + window_s
+        case.update(
+            status="ok" if correct else "wrong_results",
+            taps=taps * len(addressed),
+            stages={
+                "start_ms": round(start_ms, 1),
+                "dispatch_ms": round(dispatch_ms, 1),
+                "mark_rate": round(taps * len(addressed) / mark_elapsed, 1) if mark_elapsed else None,
+                "mark_p50_ms": round(percentile(latencies, 50), 2) if latencies else None,
+                "mark_p95_ms": round(percentile(latencies, 95), 2) if latencies else None,
+                "reply_upload_ms": round((uploaded_at - window_end) * 1000.0, 1),
+                "e2e_ms": round((uploaded_at - t0) * 1000.0, 1),
+            },
+            zone_us=zones,
+            heap_peak_bytes=heap,
+        )
+        if not correct:
+            case["detail"] = f"uploaded {marked}, expected {expected}, {len(errors)} tap errors"
+        return case
+    finally:
+        rig.close()
+
+
+# ==================== BASELINE ====================
+def cpu_model():
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or None
+
+
+def compiler_version():
+    try:
+        out = subprocess.run(["g++", "--version"], capture_output=True, text=True, check=True).stdout
+        return out.splitlines()[0]
+    except (OSError, subprocess.CalledProcessError, IndexError):
+        return None
+
+
+def json_library():
+    """ArduinoJson version the native env installed, None if it is not there."""
+    path = os.path.join(ROOT, "master", ".pio", "libdeps", "native", "ArduinoJson", "library.json")
+    try:
+        with open(path) as f:
+            return json.load(f)["version"]
+    except (OSError, ValueError, KeyError):
+        return None
+
+
+def configuration(args):
+    return {
+        "machine": platform.machine(),
+        "cpu": cpu_model(),
+        "os": platform.platform(),
+        "python": platform.python_version(),
+        "compiler": compiler_version(),
+        "arduinojson": json_library(),
+        "window_ms": args.window_ms,
+    }
+
+
+def unit_of(metric):
+    if metric.endswith("_us"):
+        return "us"
+    if metric == "mark_rate":
+        return "rate"
+    return "ms"
+
+
+def flatten(case):
+    metrics = {}
+    for k, v in case.get("stages", {}).items():
+        metrics[k] = (v, unit_of(k))
+    for k, v in case.get("zone_us", {}).items():
+        metrics[k] = (v, "us")
+    for k, v in case.get("heap_peak_bytes", {}).items():
+        metrics[f"heap_peak.{k}"] = (v, "bytes")
+    return metrics
+
+
+def compare(report, baseline, tolerance):
+    regressions = []
+    base_cases = {c["name"]: c for c in baseline.get("cases", [])}
+    for case in report["cases"]:
+        base = base_cases.get(case["name"])
+        if base is None:
+            print(f"  {case['name']}: no baseline")
+            continue
+        if case["status"] != base["status"]:
+            regressions.append(f"{case['name']}: status {base['status']} -> {case['status']}"
+                               f" ({case.get('detail', '')})")
+            continue
+        current, previous = flatten(case), flatten(base)
+        for metric, (value, unit) in current.items():
+            if metric not in previous or value is None or previous[metric][0] is None:
+                continue
+            old = previous[metric][0]
+            worse = old - value if metric in HIGHER_IS_BETTER else value - old
+            if worse > ABSOLUTE_FLOOR[unit] and worse > abs(old) * tolerance:
+                regressions.append(f"{case['name']}: {metric} {old} -> {value}")
+    return regressions
+
+
+# ==================== MAIN ====================
+def parse_list(text):
+    return [int(x) for x in text.split(",")] if text else None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--matrix", choices=sorted(MATRICES), default="quick")
+    parser.add_argument("--rooms", help="comma list overriding the matrix, 1..2")
+    parser.add_argument("--roster", help="comma list of roster sizes per room")
+    parser.add_argument("--rate", help="comma list of taps per second per room")
+    parser.add_argument("--window-ms", type=int, default=16000,
+                        help="slave ACTIVE window compiled into the bench build (default 16000)")
+    parser.add_argument("--timeout", type=float, default=180.0, help="per-session limit in seconds")
+    parser.add_argument("-o", "--output", help="write the JSON report here (default stdout)")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="write the report to --baseline instead of comparing")
+    parser.add_argument("--tolerance", type=float, default=0.25,
+                        help="relative slack before a metric counts as regressed (default 0.25)")
+    parser.add_argument("--pio", default="pio", help="PlatformIO CLI")
+    parser.add_argument("--work-dir", default=DEFAULT_WORK_DIR)
+    parser.add_argument("--skip-build", action="store_true", help="reuse binaries in --work-dir")
+    args = parser.parse_args()
+
+    matrix = dict(MATRICES[args.matrix])
+    for key in ("rooms", "roster", "rate"):
+        override = parse_list(getattr(args, key))
+        if override:
+            matrix[key] = override
+    if any(r not in (1, 2) for r in matrix["rooms"]):
+        parser.error("the master has two links, so --rooms must be 1 or 2")
+
+    window = f"-DACTIVE_DURATION={args.window_ms}"
+    binaries = {
+        "master": build(args, "master", "master", ""),
+        "RVU101": build(args, "slave", "slave-rvu101", f"{window} '-DSLAVE_ADDRESS=\"RVU101\"'"),
+        "RVU102": build(args, "slave", "slave-rvu102", f"{window} '-DSLAVE_ADDRESS=\"RVU102\"'"),
+    }
+
+    results = ResultsServer()
+    report = {"version": 2, "config": configuration(args), "cases": []}
+    try:
+        for rooms in matrix["rooms"]:
+            for roster in matrix["roster"]:
+                for rate in matrix["rate"]:
+                    case = run_case(args, binaries, results, rooms, roster, rate)
+                    stages = case.get("stages")
+                    summary = (f" e2e={stages['e2e_ms']}ms dispatch={stages['dispatch_ms']}ms"
+                               f" reply={stages['reply_upload_ms']}ms" if stages else
+                               f" {case.get('detail', '')}")
+                    print(f"[bench] {case['name']}: {case['status']}{summary}", file=sys.stderr)
+                    report["cases"].append(case)
+    finally:
+        results.close()
+
+    text = json.dumps(report, indent=2) + "\n"
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            f.write(text)
+        print(f"[bench] baseline written to {args.baseline}", file=sys.stderr)
+        return 0
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+    if not os.path.exists(args.baseline):
+        print("[bench] no baseline to compare against", file=sys.stderr)
+        return 0
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    differs = [k for k in ("machine", "cpu", "compiler", "arduinojson", "window_ms")
+               if baseline.get("config", {}).get(k) != report["config"][k]]
+    if differs:
+        print(f"[bench] baseline has a different {', '.join(differs)}, not comparing", file=sys.stderr)
+        return 0
+    regressions = compare(report, baseline, args.tolerance)
+    for line in regressions:
+        print(f"[bench] REGRESSION {line}", file=sys.stderr)
+    if not regressions:
+        print("[bench] no regressions against baseline", file=sys.stderr)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""/attendance load test under retry amplification.
+
+Builds the firmwares for the PlatformIO `native` env like session_bench.py,
+starts a one-room session and lets a crowd of students mark at once. Each
+student is one phone (its own 127.0.0.x source address, so the slave sees
+a distinct client IP) and sends its tap --amplification times back to back,
+the way flaky phones retry. Optionally --abusers phones hammer /attendance
+flat out for the whole run, with taps the slave cannot answer from its
+cache. Reports
+
+  first_marks_per_s   students whose first tap was answered "attendance
+                      marked", per second from the first tap to the last one
+  first_mark_p50_ms, first_mark_p95_ms   latency of those first taps
+  requests_per_s      everything the slave answered, repeats included
+  rate_limited        429s, legitimate and abusive separately
+  cached              repeats answered from the slave's cache (GET /stations)
+
+and exits non-zero if a student was not marked or a legitimate phone got 429.
+
+  bench/tap_bench.py
+  bench/tap_bench.py --students 120 --workers 16 --amplification 3 --abusers 2
+"""
+
+import argparse
+import http.client
+import json
+import queue
+import sys
+import threading
+import time
+
+from session_bench import (DEFAULT_WORK_DIR, ResultsServer, Rig, build, make_roster, percentile,
+                           phone_address, post_from, request, try_request)
+
+MARKED = "attendance marked"
+
+
+def tap(port, source, usn):
+    """One POST /attendance from this source address: (status, response text)."""
+    try:
+        status, body = post_from(port, source, "/attendance", {"usn": usn, "status": "success"}, timeout=10.0)
+    except (OSError, http.client.HTTPException):
+        return None, ""
+    return status, json.loads(body).get("response", "") if status == 200 else body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--students", type=int, default=60, help="phones, one USN each (default 60)")
+    parser.add_argument("--workers", type=int, default=8, help="phones tapping at the same time (default 8)")
+    parser.add_argument("--amplification", type=int, default=3, help="copies of every tap (default 3)")
+    parser.add_argument("--abusers", type=int, default=1, help="phones hammering all along (default 1)")
+    parser.add_argument("--window-ms", type=int, default=60000,
+                        help="slave ACTIVE window compiled into the bench build (default 60000)")
+    parser.add_argument("-o", "--output", help="write the JSON report here (default stdout)")
+    parser.add_argument("--pio", default="pio", help="PlatformIO CLI")
+    parser.add_argument("--work-dir", default=DEFAULT_WORK_DIR)
+    parser.add_argument("--skip-build", action="store_true", help="reuse binaries in --work-dir")
+    args = parser.parse_args()
+
+    window = f"-DACTIVE_DURATION={args.window_ms}"
+    binaries = {
+        "master": build(args, "master", "master", ""),
+        "RVU101": build(args, "slave", "slave-rvu101", f"{window} '-DSLAVE_ADDRESS=\"RVU101\"'"),
+        "RVU102": build(args, "slave", "slave-rvu102", f"{window} '-DSLAVE_ADDRESS=\"RVU102\"'"),
+    }
+
+    roster = make_roster(0, args.students)
+    results = ResultsServer()
+    rig = Rig(args, binaries, results)
+    report = {"version": 1, "students": args.students, "workers": args.workers,
+              "amplification": args.amplification, "abusers": args.abusers}
+    failures = []
+    try:
+        rig.wait_ready()
+        status, body = request(rig.master_port, "/start", {"tasks": [{"address": "RVU101", "usns": roster}]})
+        if status != 200:
+            raise RuntimeError(f"POST /start: {status} {body}")
+        port = rig.slave_ports["RVU101"]
+        deadline = time.monotonic() + 30.0
+        while try_request(port, "/stations")[0] != 200:
+            if time.monotonic() > deadline:
+                raise RuntimeError("slave never went ACTIVE")
+            time.sleep(0.01)
+
+        lock = threading.Lock()
+        first_latency, statuses = [], {"legit": {}, "abuse": {}}
+        unmarked = []
+        stop = threading.Event()
+
+        def count(kind, status):
+            with lock:
+                statuses[kind][status] = statuses[kind].get(status, 0) + 1
+
+        pending = queue.Queue()
+        for i, usn in enumerate(roster):
+            pending.put((phone_address(i), usn))
+
+        def student_worker():
+            while True:
+                try:
+                    source, usn = pending.get_nowait()
+                except queue.Empty:
+                    return
+                for copy in range(args.amplification):
+                    t = time.monotonic()
+                    status, text = tap(port, source, usn)
+                    count("legit", status)
+                    if copy == 0:
+                        if status == 200 and text == MARKED:
+                            with lock:
+                                first_latency.append((time.monotonic() - t) * 1000.0)
+                        else:
+                            with lock:
+                                unmarked.append((usn, status, text))
+
+        def abuser(i):
+            # A new USN every time: repeats would be answered from the cache
+            source = f"127.1.{i}.1"
+            n = 0
+            while not stop.is_set():
+                count("abuse", tap(port, source, f"ABUSE{i:02d}{n:06d}")[0])
+                n += 1
+
+        abusers = [threading.Thread(target=abuser, args=(i,)) for i in range(args.abusers)]
+        for th in abusers:
+            th.start()
+        t0 = time.monotonic()
+        workers = [threading.Thread(target=student_worker) for _ in range(args.workers)]
+        for th in workers:
+            th.start()
+        for th in workers:
+            th.join()
+        elapsed = time.monotonic() - t0
+        stop.set()
+        for th in abusers:
+            th.join()
+
+        status, body = try_request(port, "/stations")
+        cached = json.loads(body).get("taps", {}) if status == 200 else {}
+
+        legit = statuses["legit"]
+        answered = sum(legit.values()) - legit.get(None, 0)
+        report.update(
+            first_marks_per_s=round(len(first_latency) / elapsed, 1),
+            first_mark_p50_ms=round(percentile(first_latency, 50), 1) if first_latency else None,
+            first_mark_p95_ms=round(percentile(first_latency, 95), 1) if first_latency else None,
+            requests_per_s=round(answered / elapsed, 1),
+            elapsed_s=round(elapsed, 2),
+            rate_limited={"legit": legit.get(429, 0), "abuse": statuses["abuse"].get(429, 0)},
+            abuse_requests=sum(statuses["abuse"].values()),
+            cached=cached.get("cached"),
+        )
+        if unmarked:
+            failures.append(f"{len(unmarked)} students not marked, e.g. {unmarked[0]}")
+        if legit.get(429):
+            failures.append(f"{legit[429]} legitimate taps got 429")
+    finally:
+        rig.close()
+        results.close()
+
+    print(f"[taps] {len(first_latency)}/{args.students} first marks at {report.get('first_marks_per_s')}/s"
+          f" (p50 {report.get('first_mark_p50_ms')} ms, p95 {report.get('first_mark_p95_ms')} ms),"
+          f" {report.get('requests_per_s')} requests/s, cached {report.get('cached')},"
+          f" 429 {report.get('rate_limited')}", file=sys.stderr)
+    report["failures"] = failures
+    text = json.dumps(report, indent=2) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    for line in failures:
+        print(f"[taps] FAIL {line}", file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
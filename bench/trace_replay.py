@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Replay a recorded traffic trace through the native firmware.
+
+A trace is what a board's GET /trace (or GET /trace?saved=1, the copy saved
+when its last session ended, in builds with TRACE_FLUSH=1) returns; see
+common/Trace/Trace.h. This builds the firmware for the PlatformIO `native`
+env like session_bench.py and runs it with --replay: on a virtual clock,
+the recorded link bytes reach processUARTData() / processUARTInput() and
+the recorded HTTP requests reach the handlers at the times the board saw
+them, with no sockets or serial ports involved. Build with the flags the
+board was built with (--flags), or its timers will not line up with the
+recording. Reports
+
+  records, duration_ms   what the trace holds
+  requests               replayed HTTP requests, their statuses, host CPU
+                         time per request (p50, max)
+  tx                     per link: bytes the firmware sent vs the recording,
+                         and how many leading bytes matched
+  states                 state transitions recorded vs replayed (from the
+                         replayed firmware's own /trace), and the largest
+                         time difference between them
+  zones                  PROFILE_ZONE totals of the replay (host CPU time)
+
+Every run is repeated --runs times and must come out identical apart from
+CPU times. Exits non-zero if the replay sent different bytes, went through
+different states or was not deterministic.
+
+  bench/trace_replay.py master.trc
+  bench/trace_replay.py --firmware slave --address RVU102 http://192.168.4.3/trace?saved=1
+"""
+
+import argparse
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import urllib.request
+
+from session_bench import DEFAULT_WORK_DIR, ResultsServer, build, percentile
+
+MAGIC = b"TRC1"
+FILE_HEADER = struct.Struct("<4sIII")   # Trace::FileHeader
+RECORD_HEADER = struct.Struct("<IBBH")  # Trace::RecordHeader
+UART_RX, UART_TX, HTTP, STATE = 1, 2, 3, 4
+
+STATE_NAMES = {
+    "master": ["HALT", "ACTIVE", "WAIT"],
+    "slave": ["HALT", "ACTIVE", "SEND"],
+}
+
+
+def parse_trace(data):
+    """(FileHeader fields, [(time, type, channel, payload)]) of a trace file."""
+    if len(data) < FILE_HEADER.size or data[:4] != MAGIC:
+        raise ValueError("not a trace (bad magic)")
+    magic, ring_size, dropped, saved_at = FILE_HEADER.unpack_from(data)
+    records = []
+    at = FILE_HEADER.size
+    while at + RECORD_HEADER.size <= len(data):
+        time, kind, channel, length = RECORD_HEADER.unpack_from(data, at)
+        at += RECORD_HEADER.size
+        records.append((time, kind, channel, data[at:at + length]))
+        at += length
+    return {"ring_size": ring_size, "dropped_records": dropped, "saved_at": saved_at}, records
+
+
+def states_of(records):
+    return [(time, channel) for time, kind, channel, _ in records if kind == STATE]
+
+
+def load_trace(source):
+    if source.startswith("http://"):
+        with urllib.request.urlopen(source, timeout=10.0) as resp:
+            return resp.read()
+    with open(source, "rb") as f:
+        return f.read()
+
+
+def replay(args, program, trace_path, run, upstream):
+    out = os.path.join(args.work_dir, f"replay-{run}")
+    data = os.path.join(out, "data")
+    shutil.rmtree(out, ignore_errors=True)
+    os.makedirs(data)
+    subprocess.run([program, "--replay", trace_path, "--replay-out", out, "--replay-tail", str(args.tail_ms),
+                    "--replay-dump", "/profile", "--replay-dump", "/trace", "--data-dir", data,
+                    "--upstream", f"127.0.0.1:{upstream}", "--quiet"],
+                   check=True, stdout=subprocess.DEVNULL, timeout=args.timeout)
+    with open(os.path.join(out, "summary.json")) as f:
+        summary = json.load(f)
+    with open(os.path.join(out, "requests.jsonl")) as f:
+        requests = [json.loads(line) for line in f]
+    dumps = {d["uri"]: os.path.join(out, d["file"]) for d in summary["dumps"] if d["status"] == 200}
+    profile = {}
+    if "/profile" in dumps:
+        with open(dumps["/profile"]) as f:
+            profile = json.load(f)
+    states = []
+    if "/trace" in dumps:
+        with open(dumps["/trace"], "rb") as f:
+            states = states_of(parse_trace(f.read())[1])
+    return summary, requests, profile, states
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("trace", help="trace file, or an http:// URL to GET it from a board")
+    parser.add_argument("--firmware", choices=["master", "slave"], default="master")
+    parser.add_argument("--address", default="RVU101", help="SLAVE_ADDRESS of a slave build (default RVU101)")
+    parser.add_argument("--flags", default="", help="extra build flags, as the board was built")
+    parser.add_argument("--runs", type=int, default=2, help="replays that must agree (default 2)")
+    parser.add_argument("--tail-ms", type=int, default=2000, help="run on after the last record (default 2000)")
+    parser.add_argument("--timeout", type=float, default=120.0, help="per-replay limit in seconds")
+    parser.add_argument("-o", "--output", help="write the JSON report here (default stdout)")
+    parser.add_argument("--pio", default="pio", help="PlatformIO CLI")
+    parser.add_argument("--work-dir", default=DEFAULT_WORK_DIR)
+    parser.add_argument("--skip-build", action="store_true", help="reuse binaries in --work-dir")
+    args = parser.parse_args()
+
+    data = load_trace(args.trace)
+    header, records = parse_trace(data)
+    os.makedirs(args.work_dir, exist_ok=True)
+    trace_path = os.path.join(args.work_dir, "replay.trc")
+    with open(trace_path, "wb") as f:
+        f.write(data)
+
+    flags = args.flags
+    name = "master"
+    if args.firmware == "slave":
+        flags = f"'-DSLAVE_ADDRESS=\"{args.address}\"' {flags}".strip()
+        name = f"slave-{args.address.lower()}"
+    program = build(args, args.firmware, name, flags)
+
+    results = ResultsServer()
+    try:
+        runs = [replay(args, program, trace_path, run, results.port) for run in range(args.runs)]
+    finally:
+        results.close()
+
+    names = STATE_NAMES[args.firmware]
+    recorded = states_of(records)
+    summary, requests, profile, replayed = runs[0]
+    failures = []
+
+    def label(states):
+        return [names[s] if s < len(names) else str(s) for _, s in states]
+
+    # A trace that lost its oldest records does not start at boot, so the
+    # replay starts from a different state than the board did: report only
+    mismatches = []
+    state_skew = None
+    if [s for _, s in replayed] != [s for _, s in recorded]:
+        mismatches.append(f"states {label(replayed)} replayed, {label(recorded)} recorded")
+    else:
+        state_skew = max((abs(a[0] - b[0]) for a, b in zip(replayed, recorded)), default=0)
+    for check in summary["tx"]:
+        if check["matched"] != check["expected"] or check["sent"] != check["expected"]:
+            mismatches.append(f"link {check['channel']}: sent {check['sent']} bytes, {check['expected']} recorded,"
+                              f" first {check['matched']} matched")
+    if header["dropped_records"]:
+        for line in mismatches:
+            print(f"[replay] {line} (the trace does not start at boot)", file=sys.stderr)
+    else:
+        failures += mismatches
+    if summary["unserved_requests"]:
+        failures.append(f"{summary['unserved_requests']} requests never replayed")
+
+    def outcome(run):
+        s, reqs, _, states = run
+        return (s["end_ms"], s["tx"], [(r["replayed_at"], r["status"], r["bytes"]) for r in reqs], states)
+
+    deterministic = all(outcome(run) == outcome(runs[0]) for run in runs[1:])
+    if not deterministic:
+        failures.append("replays disagree")
+
+    cpu = [r["cpu_us"] for r in requests]
+    statuses = {}
+    for r in requests:
+        statuses[str(r["status"])] = statuses.get(str(r["status"]), 0) + 1
+    report = {
+        "version": 1,
+        "firmware": args.firmware,
+        "records": len(records),
+        "duration_ms": records[-1][0] - records[0][0] if records else 0,
+        "dropped_records": header["dropped_records"],
+        "requests": {
+            "replayed": len(requests),
+            "truncated": sum(1 for r in requests if r["truncated"]),
+            "statuses": statuses,
+            "cpu_p50_us": percentile(cpu, 50),
+            "cpu_max_us": max(cpu, default=None),
+        },
+        "tx": summary["tx"],
+        "states": {"recorded": label(recorded), "replayed": label(replayed), "max_skew_ms": state_skew},
+        "zones": {z["name"]: z["total_us"] for z in profile.get("zones", [])},
+        "deterministic": deterministic,
+        "failures": failures,
+    }
+
+    sent = sum(c["sent"] for c in summary["tx"])
+    matched = sum(c["matched"] for c in summary["tx"])
+    print(f"[replay] {len(records)} records over {report['duration_ms']} ms: {len(requests)} requests,"
+          f" {matched}/{sent} link bytes as recorded, states {' > '.join(label(replayed)) or 'none'},"
+          f" skew {state_skew} ms, {'deterministic' if deterministic else 'NOT deterministic'}", file=sys.stderr)
+    text = json.dumps(report, indent=2) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    for line in failures:
+        print(f"[replay] FAIL {line}", file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
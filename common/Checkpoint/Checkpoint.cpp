@@ -0,0 +1,73 @@
+#include "Checkpoint.h"
+
+namespace Checkpoint {
+
+static const uint32_t MAGIC = 0x54504b43;  // "CKPT"
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t length;
+  uint32_t crc;
+};
+
+// Staging copy: RTC transfers are whole 4-byte words
+static uint32_t record[(HEADER_SIZE + CAPACITY) / 4];
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+bool save(uint32_t version, const void* data, size_t length) {
+  if (length > CAPACITY) return false;
+  Header* header = reinterpret_cast<Header*>(record);
+  uint8_t* body = reinterpret_cast<uint8_t*>(record) + HEADER_SIZE;
+  size_t padded = (length + 3) & ~(size_t)3;
+  memcpy(body, data, length);
+  memset(body + length, 0, padded - length);
+  header->magic = MAGIC;
+  header->version = version;
+  header->length = length;
+  header->crc = crc32(body, length);
+  return hal::rtcWrite(OFFSET, record, HEADER_SIZE + padded);
+}
+
+size_t load(uint32_t version, void* data, size_t maxLength) {
+  Header* header = reinterpret_cast<Header*>(record);
+  uint8_t* body = reinterpret_cast<uint8_t*>(record) + HEADER_SIZE;
+  if (!hal::rtcRead(OFFSET, record, HEADER_SIZE)) return 0;
+  if (header->magic != MAGIC || header->version != version || header->length > maxLength ||
+      header->length > CAPACITY) {
+    return 0;
+  }
+  size_t length = header->length;
+  size_t padded = (length + 3) & ~(size_t)3;
+  if (!hal::rtcRead(OFFSET + HEADER_SIZE, body, padded) || crc32(body, length) != header->crc) {
+    return 0;
+  }
+  memcpy(data, body, length);
+  return length;
+}
+
+void clear() {
+  Header header = {0, 0, 0, 0};
+  hal::rtcWrite(OFFSET, &header, HEADER_SIZE);
+}
+
+uint32_t hash(const void* data, size_t length) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    h = (h ^ bytes[i]) * 16777619u;
+  }
+  return h;
+}
+
+}  // namespace Checkpoint
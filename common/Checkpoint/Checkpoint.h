@@ -0,0 +1,34 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <Hal.h>
+
+// One session checkpoint in RTC user memory (see HalRtc.h), so a watchdog
+// or exception reset in the middle of a session can pick it back up.
+//
+// The firmware owns the record's layout; this only frames it with a magic,
+// the firmware's layout version, the length and a CRC32, so garbage left by
+// a power-up or a record from another firmware build never loads. Writes
+// are plain RTC stores (no flash wear), cheap enough to repeat every second.
+// The first 128 bytes of RTC user memory are left to the core's OTA loader.
+
+namespace Checkpoint {
+
+const size_t OFFSET = 128;
+const size_t HEADER_SIZE = 16;
+const size_t CAPACITY = hal::RTC_USER_MEMORY_SIZE - OFFSET - HEADER_SIZE;
+
+bool save(uint32_t version, const void* data, size_t length);
+
+// Copies the stored record into data and returns its length, or 0 when
+// there is none for this version (or it is longer than maxLength)
+size_t load(uint32_t version, void* data, size_t maxLength);
+
+void clear();
+
+// FNV-1a, for recognising a roster or request kept in flash
+uint32_t hash(const void* data, size_t length);
+
+}  // namespace Checkpoint
+
+#endif
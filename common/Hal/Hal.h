@@ -0,0 +1,32 @@
+#ifndef HAL_H
+#define HAL_H
+
+// Thin hardware abstraction layer shared by the master and slave firmwares.
+//
+// Clock, heap accounting, RTC memory, flash files, serial ports, HTTP
+// server/client, LED and the WiFi access point go through the hal:: types
+// declared here. esp8266/ implements them on the Arduino core; native/
+// implements them on Linux (ptys or inherited fds for the serial links,
+// loopback sockets for HTTP, a data directory for RTC memory and files) so
+// both state machines also build and run as host executables under the
+// PlatformIO `native` env.
+
+#if defined(ARDUINO)
+#define HAL_NATIVE 0
+#include <Arduino.h>
+#else
+#define HAL_NATIVE 1
+#include "native/ArduinoCompat.h"
+#endif
+
+#include "HalClock.h"
+#include "HalSerialPort.h"
+#include "HalHttpServer.h"
+#include "HalHttpClient.h"
+#include "HalHeap.h"
+#include "HalRtc.h"
+#include "HalFiles.h"
+#include "HalLed.h"
+#include "HalWifi.h"
+
+#endif
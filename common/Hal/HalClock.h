@@ -0,0 +1,24 @@
+#ifndef HAL_CLOCK_H
+#define HAL_CLOCK_H
+
+#include <stdint.h>
+
+namespace hal {
+
+#if HAL_NATIVE
+uint32_t millis();
+void delay(uint32_t ms);
+void yield();
+uint32_t cycleCount();  // Nanoseconds on the host
+uint32_t cpuMHz();      // 1000 on the host, so cycles / cpuMHz() is still microseconds
+#else
+inline uint32_t millis() { return ::millis(); }
+inline void delay(uint32_t ms) { ::delay(ms); }
+inline void yield() { ::yield(); }
+inline uint32_t cycleCount() { return ESP.getCycleCount(); }
+inline uint32_t cpuMHz() { return ESP.getCpuFreqMHz(); }
+#endif
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef HAL_FILES_H
+#define HAL_FILES_H
+
+#include <stddef.h>
+
+namespace hal {
+namespace files {
+
+// Small files in flash: LittleFS on the ESP (formatted on first mount),
+// --data-dir on the host. Paths are flat, like "/roster". Everything fails
+// until begin() has succeeded.
+bool begin();
+bool write(const char* path, const char* data, size_t length);
+bool append(const char* path, const char* data, size_t length);  // Creates the file if needed
+bool read(const char* path, String& out);
+bool exists(const char* path);
+bool remove(const char* path);
+
+// Reads a file a piece at a time from any offset, so it never has to fit
+// in RAM. The file stays open from open() to close().
+class Reader {
+public:
+  Reader() : impl(nullptr) {}
+  ~Reader() { close(); }
+
+  bool open(const char* path);
+  bool isOpen() const { return impl != nullptr; }
+  size_t size() const;
+  // Bytes read, short at the end of the file
+  size_t read(size_t offset, void* buffer, size_t length);
+  void close();
+
+  struct Impl;
+
+private:
+  Reader(const Reader&);
+  Reader& operator=(const Reader&);
+  Impl* impl;
+};
+
+}  // namespace files
+}  // namespace hal
+
+#endif
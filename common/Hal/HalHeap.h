@@ -0,0 +1,18 @@
+#ifndef HAL_HEAP_H
+#define HAL_HEAP_H
+
+#include <stdint.h>
+
+namespace hal {
+
+// Heap bytes in use since startup, and the most seen since resetHeapPeak().
+// The host build counts every allocation exactly; the ESP compares
+// ESP.getFreeHeap() with its value at boot, so its peak only covers the
+// moments heapUsed() was called.
+uint32_t heapUsed();
+uint32_t heapPeak();
+void resetHeapPeak();
+
+}  // namespace hal
+
+#endif
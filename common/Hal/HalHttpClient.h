@@ -0,0 +1,20 @@
+#ifndef HAL_HTTP_CLIENT_H
+#define HAL_HTTP_CLIENT_H
+
+#include <stdint.h>
+
+namespace hal {
+
+class HttpClient {
+public:
+  // POSTs body to http://host:port/path and stores the response body.
+  // Returns the HTTP status code, or a negative error if no response came back.
+  int post(const char* host, uint16_t port, const char* path,
+           const char* contentType, const String& body, String& response);
+
+  static String errorToString(int code);
+};
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef HAL_HTTP_SERVER_H
+#define HAL_HTTP_SERVER_H
+
+#include <stdint.h>
+
+#if HAL_NATIVE
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+#else
+#include <ESP8266WebServer.h>
+#endif
+
+namespace hal {
+
+// Request/response HTTP server with the same handler model as
+// ESP8266WebServer: register handlers with on(), call handleClient() from
+// loop(), and answer from inside the handler with send().
+class HttpServer {
+public:
+  typedef void (*Handler)();
+
+  explicit HttpServer(uint16_t port);
+
+  void on(const char* uri, HTTPMethod method, Handler handler);
+  void onNotFound(Handler handler);
+  // Called before every request's handler, with the accessors below valid
+  void onRequest(Handler observer);
+  void begin();
+  void handleClient();
+
+  // Request accessors, valid inside a handler. The POST body is arg("plain").
+  bool hasArg(const char* name);
+  String arg(const char* name);
+  int args();
+  String argName(int i);
+  String arg(int i);
+  HTTPMethod method();
+  String uri();
+  uint32_t clientIP();
+
+  // Request headers other than the ones the server parses itself are only
+  // kept if named here first (before begin()); header() then reads them.
+  void collectHeaders(const char* const* names, size_t count);
+  String header(const char* name);
+
+  void sendHeader(const char* name, const String& value);
+  void send(int code, const char* contentType, const String& body);
+  void send(int code, const char* contentType, const char* body, size_t length);
+  void send(int code);
+  // Body in flash (PROGMEM), streamed out without a RAM copy
+  void sendProgmem(int code, const char* contentType, const uint8_t* data, size_t length);
+
+  // Response of unknown length, streamed in pieces: beginResponse(), any
+  // number of sendContent(), then endResponse().
+  void beginResponse(int code, const char* contentType);
+  void sendContent(const char* data, size_t length);
+  void endResponse();
+
+  // Server-sent events. Inside a handler, openEventStream() answers with
+  // text/event-stream and keeps the connection after the handler returns;
+  // the stream is then fed with writeEventStream() from anywhere in loop().
+  // Returns -1 when all MAX_EVENT_STREAMS are taken. A write that fails
+  // means the client went away and the slot is free again.
+  static const int MAX_EVENT_STREAMS = 4;
+  int openEventStream();
+  bool writeEventStream(int stream, const char* data, size_t length);
+  void closeEventStream(int stream);
+
+  struct Impl;
+
+private:
+  Impl* impl;
+};
+
+}  // namespace hal
+
+#endif
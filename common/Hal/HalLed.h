@@ -0,0 +1,24 @@
+#ifndef HAL_LED_H
+#define HAL_LED_H
+
+#include <stdint.h>
+
+namespace hal {
+
+class Led {
+public:
+  Led(uint8_t pin, bool activeLow) : pin(pin), activeLow(activeLow) {}
+
+  void begin();  // Configures the pin and turns the LED off
+  void on();
+  void off();
+  void dim(uint16_t level);  // PWM brightness, 0..1023
+
+private:
+  uint8_t pin;
+  bool activeLow;
+};
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HAL_RTC_H
+#define HAL_RTC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+
+// RTC user memory: survives resets (watchdog, exceptions, restart()) but not
+// power loss, so whatever is read back has to be validated. Offsets and
+// lengths are multiples of 4. The host build keeps it in --data-dir/rtc.bin,
+// so a killed and restarted executable sees it again.
+const size_t RTC_USER_MEMORY_SIZE = 512;
+
+bool rtcRead(size_t offset, void* data, size_t length);
+bool rtcWrite(size_t offset, const void* data, size_t length);
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef HAL_SERIAL_PORT_H
+#define HAL_SERIAL_PORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+
+struct HardwareUart {
+  bool swapPins;  // UART0 on GPIO13 (RX) / GPIO15 (TX) instead of GPIO3/GPIO1
+};
+
+// Byte-oriented serial port for the master/slave link.
+//
+// On the ESP8266 this is a SoftwareSerial on the given pins, or UART0. On the
+// host each port is bound by RX pin to a pty, inherited fd or device (see
+// native/NativeMain.cpp), and ports that share a TX pin share writes, just
+// like the master's two receive lines sharing GPIO14.
+class SerialPort {
+public:
+  SerialPort(int8_t rxPin, int8_t txPin);  // txPin -1: receive only
+  explicit SerialPort(HardwareUart uart);
+
+  void begin(uint32_t baud);
+  void setBaud(uint32_t baud);
+  uint32_t baud() const;
+  bool isHardware() const;
+  int8_t rxPin() const;  // Identifies the port, e.g. in traces
+
+  int available();
+  int read();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* data, size_t len);
+  size_t print(const char* s);
+  size_t print(const String& s);
+  size_t println(const String& s);
+  void flush();
+
+  struct Impl;
+
+private:
+  Impl* impl;
+};
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HAL_WIFI_H
+#define HAL_WIFI_H
+
+#include <stdint.h>
+
+namespace hal {
+
+// IPv4 addresses are uint32_t in network byte order, as in IPAddress
+inline uint32_t ip(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+String ipToString(uint32_t address);
+
+namespace wifi {
+
+typedef void (*StationHandler)(const uint8_t mac[6]);
+
+bool startAccessPoint(const char* ssid, const char* password, uint32_t address,
+                      uint32_t netmask, uint8_t channel, uint8_t maxConnections);
+uint32_t accessPointIP();
+
+void onStationConnected(StationHandler handler);
+void onStationDisconnected(StationHandler handler);
+
+// Looks up the MAC of the associated station that holds address
+bool stationMac(uint32_t address, uint8_t mac[6]);
+
+// Disconnects an associated station. canDeauth() is false where the
+// platform offers no way to (the ESP8266 SDK has none); deauth() then fails.
+bool canDeauth();
+bool deauth(const uint8_t mac[6]);
+
+}  // namespace wifi
+}  // namespace hal
+
+#endif
@@ -0,0 +1,82 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+#include <LittleFS.h>
+
+namespace hal {
+namespace files {
+
+static bool mounted = false;
+
+bool begin() {
+  if (!mounted) mounted = LittleFS.begin();
+  return mounted;
+}
+
+bool write(const char* path, const char* data, size_t length) {
+  if (!mounted) return false;
+  File file = LittleFS.open(path, "w");
+  if (!file) return false;
+  bool ok = file.write(reinterpret_cast<const uint8_t*>(data), length) == length;
+  file.close();
+  return ok;
+}
+
+bool append(const char* path, const char* data, size_t length) {
+  if (!mounted) return false;
+  File file = LittleFS.open(path, "a");
+  if (!file) return false;
+  bool ok = file.write(reinterpret_cast<const uint8_t*>(data), length) == length;
+  file.close();
+  return ok;
+}
+
+bool read(const char* path, String& out) {
+  if (!mounted) return false;
+  File file = LittleFS.open(path, "r");
+  if (!file) return false;
+  out = "";
+  if (!out.reserve(file.size())) return false;
+  char buffer[128];
+  size_t n;
+  while ((n = file.read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer))) > 0) {
+    out.concat(buffer, n);
+  }
+  return true;
+}
+
+bool exists(const char* path) { return mounted && LittleFS.exists(path); }
+
+bool remove(const char* path) { return mounted && LittleFS.remove(path); }
+
+struct Reader::Impl {
+  File file;
+};
+
+bool Reader::open(const char* path) {
+  close();
+  if (!mounted) return false;
+  File file = LittleFS.open(path, "r");
+  if (!file) return false;
+  impl = new Impl{file};
+  return true;
+}
+
+size_t Reader::size() const { return impl ? impl->file.size() : 0; }
+
+size_t Reader::read(size_t offset, void* buffer, size_t length) {
+  if (!impl || !impl->file.seek(offset)) return 0;
+  return impl->file.read(static_cast<uint8_t*>(buffer), length);
+}
+
+void Reader::close() {
+  if (!impl) return;
+  impl->file.close();
+  delete impl;
+  impl = nullptr;
+}
+
+}  // namespace files
+}  // namespace hal
+
+#endif
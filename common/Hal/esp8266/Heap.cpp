@@ -0,0 +1,29 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+
+namespace hal {
+
+static const uint32_t bootFreeHeap = ESP.getFreeHeap();
+static uint32_t peak = 0;
+
+uint32_t heapUsed() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t used = bootFreeHeap > freeHeap ? bootFreeHeap - freeHeap : 0;
+  if (used > peak) peak = used;
+  return used;
+}
+
+uint32_t heapPeak() {
+  heapUsed();
+  return peak;
+}
+
+void resetHeapPeak() {
+  peak = 0;
+  heapUsed();
+}
+
+}  // namespace hal
+
+#endif
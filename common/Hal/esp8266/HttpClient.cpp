@@ -0,0 +1,28 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+#include <ESP8266HTTPClient.h>
+
+namespace hal {
+
+int HttpClient::post(const char* host, uint16_t port, const char* path,
+                     const char* contentType, const String& body, String& response) {
+  WiFiClient client;
+  HTTPClient http;
+
+  http.begin(client, host, port, path);
+  http.addHeader("Content-Type", contentType);
+
+  int code = http.POST(body);
+  if (code > 0) {
+    response = http.getString();
+  }
+  http.end();
+  return code;
+}
+
+String HttpClient::errorToString(int code) { return HTTPClient::errorToString(code); }
+
+}  // namespace hal
+
+#endif
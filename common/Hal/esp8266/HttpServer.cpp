@@ -0,0 +1,121 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+
+namespace hal {
+
+struct HttpServer::Impl {
+  ESP8266WebServer server;
+  WiFiClient streams[MAX_EVENT_STREAMS];
+  HttpServer::Handler observer;
+  explicit Impl(uint16_t port) : server(port), observer(nullptr) {}
+};
+
+static const char EVENT_STREAM_HEADERS[] PROGMEM =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: keep-alive\r\n\r\n";
+
+HttpServer::HttpServer(uint16_t port) : impl(new Impl(port)) {}
+
+// Handlers are wrapped so the onRequest() observer runs first
+void HttpServer::on(const char* uri, HTTPMethod method, Handler handler) {
+  Impl* state = impl;
+  impl->server.on(uri, method, [state, handler]() {
+    if (state->observer) state->observer();
+    handler();
+  });
+}
+
+void HttpServer::onNotFound(Handler handler) {
+  Impl* state = impl;
+  impl->server.onNotFound([state, handler]() {
+    if (state->observer) state->observer();
+    handler();
+  });
+}
+
+void HttpServer::onRequest(Handler observer) { impl->observer = observer; }
+void HttpServer::begin() { impl->server.begin(); }
+void HttpServer::handleClient() { impl->server.handleClient(); }
+
+bool HttpServer::hasArg(const char* name) { return impl->server.hasArg(name); }
+String HttpServer::arg(const char* name) { return impl->server.arg(name); }
+int HttpServer::args() { return impl->server.args(); }
+String HttpServer::argName(int i) { return impl->server.argName(i); }
+String HttpServer::arg(int i) { return impl->server.arg(i); }
+HTTPMethod HttpServer::method() { return impl->server.method(); }
+String HttpServer::uri() { return impl->server.uri(); }
+uint32_t HttpServer::clientIP() { return impl->server.client().remoteIP(); }
+
+void HttpServer::collectHeaders(const char* const* names, size_t count) {
+  impl->server.collectHeaders(const_cast<const char**>(names), count);
+}
+
+String HttpServer::header(const char* name) { return impl->server.header(name); }
+
+void HttpServer::sendHeader(const char* name, const String& value) {
+  impl->server.sendHeader(name, value);
+}
+
+void HttpServer::send(int code, const char* contentType, const String& body) {
+  impl->server.send(code, contentType, body);
+}
+
+void HttpServer::send(int code, const char* contentType, const char* body, size_t length) {
+  impl->server.send(code, contentType, body, length);
+}
+
+void HttpServer::send(int code) { impl->server.send(code); }
+
+void HttpServer::sendProgmem(int code, const char* contentType, const uint8_t* data, size_t length) {
+  impl->server.send_P(code, contentType, (PGM_P)data, length);
+}
+
+void HttpServer::beginResponse(int code, const char* contentType) {
+  impl->server.setContentLength(CONTENT_LENGTH_UNKNOWN);  // Chunked transfer
+  impl->server.send(code, contentType, "");
+}
+
+void HttpServer::sendContent(const char* data, size_t length) {
+  impl->server.sendContent(data, length);
+}
+
+void HttpServer::endResponse() { impl->server.sendContent(""); }  // Final empty chunk
+
+// Holding a copy of the request's WiFiClient keeps the TCP connection open
+// once ESP8266WebServer lets go of it (as in the core's ServerSentEvents example)
+int HttpServer::openEventStream() {
+  for (int i = 0; i < MAX_EVENT_STREAMS; i++) {
+    if (!impl->streams[i].connected()) {
+      WiFiClient& client = impl->streams[i];
+      client = impl->server.client();
+      client.setNoDelay(true);
+      client.write_P(EVENT_STREAM_HEADERS, sizeof(EVENT_STREAM_HEADERS) - 1);
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool HttpServer::writeEventStream(int stream, const char* data, size_t length) {
+  if (stream < 0 || stream >= MAX_EVENT_STREAMS) return false;
+  WiFiClient& client = impl->streams[stream];
+  // Never block the loop on a slow subscriber: a full send buffer counts as gone
+  if (!client.connected() || client.availableForWrite() < length ||
+      client.write((const uint8_t*)data, length) != length) {
+    client.stop();
+    return false;
+  }
+  return true;
+}
+
+void HttpServer::closeEventStream(int stream) {
+  if (stream >= 0 && stream < MAX_EVENT_STREAMS) impl->streams[stream].stop();
+}
+
+}  // namespace hal
+
+#endif
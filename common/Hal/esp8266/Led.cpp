@@ -0,0 +1,18 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+
+namespace hal {
+
+void Led::begin() {
+  pinMode(pin, OUTPUT);
+  off();
+}
+
+void Led::on() { digitalWrite(pin, activeLow ? LOW : HIGH); }
+void Led::off() { digitalWrite(pin, activeLow ? HIGH : LOW); }
+void Led::dim(uint16_t level) { analogWrite(pin, activeLow ? 1023 - level : level); }
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,20 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+
+namespace hal {
+
+// The core's rtcUserMemory calls take 4-byte block offsets
+bool rtcRead(size_t offset, void* data, size_t length) {
+  if (offset % 4 != 0 || length % 4 != 0) return false;
+  return ESP.rtcUserMemoryRead(offset / 4, static_cast<uint32_t*>(data), length);
+}
+
+bool rtcWrite(size_t offset, const void* data, size_t length) {
+  if (offset % 4 != 0 || length % 4 != 0) return false;
+  return ESP.rtcUserMemoryWrite(offset / 4, static_cast<uint32_t*>(const_cast<void*>(data)), length);
+}
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,64 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+#include <SoftwareSerial.h>
+
+namespace hal {
+
+struct SerialPort::Impl {
+  int8_t rxPin;
+  SoftwareSerial* software;
+  HardwareSerial* hardware;
+  bool swapPins;
+  uint32_t baud;
+
+  Stream& stream() {
+    if (hardware) return *hardware;
+    return *software;
+  }
+};
+
+SerialPort::SerialPort(int8_t rxPin, int8_t txPin)
+    : impl(new Impl{rxPin, new SoftwareSerial(rxPin, txPin), nullptr, false, 0}) {}
+
+SerialPort::SerialPort(HardwareUart uart)
+    : impl(new Impl{(int8_t)(uart.swapPins ? 13 : 3), nullptr, &Serial, uart.swapPins, 0}) {}
+
+void SerialPort::begin(uint32_t baud) {
+  impl->baud = baud;
+  if (impl->hardware) {
+    impl->hardware->begin(baud);
+    if (impl->swapPins) impl->hardware->swap();  // RX=GPIO13, TX=GPIO15
+  } else {
+    impl->software->begin(baud);
+  }
+}
+
+void SerialPort::setBaud(uint32_t baud) {
+  if (baud == impl->baud) return;
+  flush();
+  impl->baud = baud;
+  if (impl->hardware) {
+    impl->hardware->updateBaudRate(baud);
+  } else {
+    impl->software->end();
+    impl->software->begin(baud);
+  }
+}
+
+uint32_t SerialPort::baud() const { return impl->baud; }
+bool SerialPort::isHardware() const { return impl->hardware != nullptr; }
+int8_t SerialPort::rxPin() const { return impl->rxPin; }
+
+int SerialPort::available() { return impl->stream().available(); }
+int SerialPort::read() { return impl->stream().read(); }
+size_t SerialPort::write(uint8_t c) { return impl->stream().write(c); }
+size_t SerialPort::write(const uint8_t* data, size_t len) { return impl->stream().write(data, len); }
+size_t SerialPort::print(const char* s) { return impl->stream().print(s); }
+size_t SerialPort::print(const String& s) { return impl->stream().print(s); }
+size_t SerialPort::println(const String& s) { return impl->stream().println(s); }
+void SerialPort::flush() { impl->stream().flush(); }
+
+}  // namespace hal
+
+#endif
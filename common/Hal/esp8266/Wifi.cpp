@@ -0,0 +1,77 @@
+#if defined(ARDUINO)
+
+#include "../Hal.h"
+#include <ESP8266WiFi.h>
+
+extern "C" {
+#include <user_interface.h>
+}
+
+namespace hal {
+
+String ipToString(uint32_t address) { return IPAddress(address).toString(); }
+
+namespace wifi {
+
+static StationHandler connectedHandler = nullptr;
+static StationHandler disconnectedHandler = nullptr;
+static WiFiEventHandler connectedEvent;
+static WiFiEventHandler disconnectedEvent;
+
+// The SDK keeps the AP settings in flash and brings the AP up from them
+// before setup() runs, so after a reset this normally finds everything in
+// place: the mode and addressing are only touched when they differ, and
+// softAP() itself skips the flash write and restart for an unchanged config.
+bool startAccessPoint(const char* ssid, const char* password, uint32_t address,
+                      uint32_t netmask, uint8_t channel, uint8_t maxConnections) {
+  WiFi.persistent(true);
+  if (WiFi.getMode() != WIFI_AP) WiFi.mode(WIFI_AP);
+  if (WiFi.softAPIP() != IPAddress(address)) {
+    WiFi.softAPConfig(IPAddress(address), IPAddress(address), IPAddress(netmask));
+  }
+  return WiFi.softAP(ssid, password, channel, 0, maxConnections);
+}
+
+uint32_t accessPointIP() { return WiFi.softAPIP(); }
+
+void onStationConnected(StationHandler handler) {
+  connectedHandler = handler;
+  connectedEvent = WiFi.onSoftAPModeStationConnected(
+      [](const WiFiEventSoftAPModeStationConnected& event) {
+        if (connectedHandler) connectedHandler(event.mac);
+      });
+}
+
+void onStationDisconnected(StationHandler handler) {
+  disconnectedHandler = handler;
+  disconnectedEvent = WiFi.onSoftAPModeStationDisconnected(
+      [](const WiFiEventSoftAPModeStationDisconnected& event) {
+        if (disconnectedHandler) disconnectedHandler(event.mac);
+      });
+}
+
+bool stationMac(uint32_t address, uint8_t mac[6]) {
+  bool found = false;
+  struct station_info* info = wifi_softap_get_station_info();
+  while (info != nullptr) {
+    if (info->ip.addr == address) {
+      memcpy(mac, info->bssid, 6);
+      found = true;
+      break;
+    }
+    info = STAILQ_NEXT(info, next);
+  }
+  wifi_softap_free_station_info();
+  return found;
+}
+
+// The NONOS SDK has no call that deauthenticates one SoftAP station, and
+// its wifi_send_pkt_freedom() refuses deauthentication frames, so stations
+// here only leave on their own
+bool canDeauth() { return false; }
+bool deauth(const uint8_t*) { return false; }
+
+}  // namespace wifi
+}  // namespace hal
+
+#endif
@@ -0,0 +1,67 @@
+#if !defined(ARDUINO)
+
+#include "ArduinoCompat.h"
+#include "NativeConfig.h"
+
+#include <stdarg.h>
+
+DebugSerial Serial;
+DebugSerial Serial1;
+
+String::String(double value, unsigned char decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+  str = buf;
+}
+
+void String::append(long long value, unsigned char base) {
+  if (value < 0) {
+    str += '-';
+    append((unsigned long long)(-value), base);
+  } else {
+    append((unsigned long long)value, base);
+  }
+}
+
+void String::append(unsigned long long value, unsigned char base) {
+  char buf[66];
+  char* p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  str += p;
+}
+
+void String::trim() {
+  size_t start = 0;
+  size_t end = str.size();
+  while (start < end && isspace((unsigned char)str[start])) start++;
+  while (end > start && isspace((unsigned char)str[end - 1])) end--;
+  str = str.substr(start, end - start);
+}
+
+String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+size_t DebugSerial::write(const uint8_t* data, size_t len) {
+  if (hal::native::config().quiet) return len;
+  return fwrite(data, 1, len, stdout);
+}
+
+#endif
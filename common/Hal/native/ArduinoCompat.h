@@ -0,0 +1,141 @@
+#ifndef HAL_ARDUINO_COMPAT_H
+#define HAL_ARDUINO_COMPAT_H
+
+// The parts of the Arduino core the firmwares use that aren't hardware:
+// String, Print and the debug Serial ports (which write to stdout).
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+
+// No separate flash address space on the host
+#define PROGMEM
+#define PGM_P const char*
+
+class String {
+public:
+  String() {}
+  String(const char* s) : str(s ? s : "") {}
+  String(const std::string& s) : str(s) {}
+  explicit String(char c) : str(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10) { append(value, base); }
+  explicit String(int value, unsigned char base = 10) { append(value, base); }
+  explicit String(unsigned int value, unsigned char base = 10) { append(value, base); }
+  explicit String(long value, unsigned char base = 10) { append(value, base); }
+  explicit String(unsigned long value, unsigned char base = 10) { append(value, base); }
+  explicit String(long long value, unsigned char base = 10) { append(value, base); }
+  explicit String(unsigned long long value, unsigned char base = 10) { append(value, base); }
+  explicit String(double value, unsigned char decimals = 2);
+
+  const char* c_str() const { return str.c_str(); }
+  unsigned int length() const { return str.size(); }
+  bool isEmpty() const { return str.empty(); }
+  bool reserve(unsigned int size) { str.reserve(size); return true; }
+
+  char operator[](unsigned int i) const { return i < str.size() ? str[i] : '\0'; }
+  char& operator[](unsigned int i) { return str[i]; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& s) { str += s.str; return *this; }
+  String& operator+=(const char* s) { str += s; return *this; }
+  String& operator+=(char c) { str += c; return *this; }
+  String& operator+=(int v) { append(v, 10); return *this; }
+  String& operator+=(unsigned int v) { append(v, 10); return *this; }
+  String& operator+=(long v) { append(v, 10); return *this; }
+  String& operator+=(unsigned long v) { append(v, 10); return *this; }
+  bool concat(const char* s) { str += s; return true; }
+  bool concat(const char* s, unsigned int len) { str.append(s, len); return true; }
+  bool concat(char c) { str += c; return true; }
+
+  // Lets ArduinoJson serialize straight into a String
+  size_t write(uint8_t c) { str += (char)c; return 1; }
+  size_t write(const uint8_t* s, size_t n) { str.append((const char*)s, n); return n; }
+
+  bool operator==(const String& s) const { return str == s.str; }
+  bool operator==(const char* s) const { return str == s; }
+  bool operator!=(const String& s) const { return str != s.str; }
+  bool operator!=(const char* s) const { return str != s; }
+  bool operator<(const String& s) const { return str < s.str; }
+  bool equals(const String& s) const { return str == s.str; }
+  bool startsWith(const String& prefix) const { return str.compare(0, prefix.str.size(), prefix.str) == 0; }
+  bool endsWith(const String& suffix) const {
+    return str.size() >= suffix.str.size() &&
+           str.compare(str.size() - suffix.str.size(), suffix.str.size(), suffix.str) == 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const { return find(str.find(c, from)); }
+  int indexOf(const String& s, unsigned int from = 0) const { return find(str.find(s.str, from)); }
+  int lastIndexOf(char c) const { return find(str.rfind(c)); }
+  String substring(unsigned int from) const { return from < str.size() ? String(str.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) { unsigned int t = from; from = to; to = t; }
+    if (from >= str.size()) return String();
+    return String(str.substr(from, to - from));
+  }
+
+  void trim();
+  void toUpperCase() { for (char& c : str) c = toupper(c); }
+  void toLowerCase() { for (char& c : str) c = tolower(c); }
+  long toInt() const { return strtol(str.c_str(), nullptr, 10); }
+
+private:
+  std::string str;
+
+  static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+  void append(long long value, unsigned char base);
+  void append(unsigned long long value, unsigned char base);
+  void append(int value, unsigned char base) { append((long long)value, base); }
+  void append(long value, unsigned char base) { append((long long)value, base); }
+  void append(unsigned char value, unsigned char base) { append((unsigned long long)value, base); }
+  void append(unsigned int value, unsigned char base) { append((unsigned long long)value, base); }
+  void append(unsigned long value, unsigned char base) { append((unsigned long long)value, base); }
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  size_t write(uint8_t c) { return write(&c, 1); }
+
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return print(String(v, base)); }
+  size_t print(int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+
+  template <typename T>
+  size_t println(const T& v) { return print(v) + println(); }
+  size_t println() { return print("\r\n"); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// Serial/Serial1 on the host: debug output only, to stdout
+class DebugSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  void flush() { fflush(stdout); }
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+};
+
+extern DebugSerial Serial;
+extern DebugSerial Serial1;
+
+#endif
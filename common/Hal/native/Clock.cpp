@@ -0,0 +1,47 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "Replay.h"
+
+#include <sched.h>
+#include <time.h>
+
+namespace hal {
+
+static uint64_t monotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static const uint64_t bootNs = monotonicNs();
+
+uint32_t millis() {
+  if (native::replay::active()) return (uint32_t)(native::replay::micros() / 1000);
+  return (uint32_t)((monotonicNs() - bootNs) / 1000000ull);
+}
+
+void delay(uint32_t ms) {
+  if (native::replay::active()) {
+    native::replay::advance((uint64_t)ms * 1000);
+    return;
+  }
+  struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+  while (nanosleep(&ts, &ts) != 0) {
+  }
+}
+
+void yield() {
+  if (native::replay::active()) {
+    native::replay::advance(native::replay::YIELD_US);
+    return;
+  }
+  sched_yield();
+}
+
+uint32_t cycleCount() { return (uint32_t)(monotonicNs() - bootNs); }
+uint32_t cpuMHz() { return 1000; }
+
+}  // namespace hal
+
+#endif
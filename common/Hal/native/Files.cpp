@@ -0,0 +1,93 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+
+#include <sys/stat.h>
+
+#include <string>
+
+namespace hal {
+namespace files {
+
+static std::string root;  // Empty until begin()
+
+bool begin() {
+  const char* dir = native::config().dataDir;
+  if (!dir) return false;
+  root = std::string(dir) + "/fs";
+  mkdir(root.c_str(), 0755);
+  struct stat st;
+  return stat(root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool write(const char* path, const char* data, size_t length) {
+  if (root.empty()) return false;
+  FILE* file = fopen((root + path).c_str(), "wb");
+  if (!file) return false;
+  bool ok = fwrite(data, 1, length, file) == length;
+  return fclose(file) == 0 && ok;
+}
+
+bool append(const char* path, const char* data, size_t length) {
+  if (root.empty()) return false;
+  FILE* file = fopen((root + path).c_str(), "ab");
+  if (!file) return false;
+  bool ok = fwrite(data, 1, length, file) == length;
+  return fclose(file) == 0 && ok;
+}
+
+bool read(const char* path, String& out) {
+  if (root.empty()) return false;
+  FILE* file = fopen((root + path).c_str(), "rb");
+  if (!file) return false;
+  out = "";
+  char buffer[1024];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    out.concat(buffer, n);
+  }
+  fclose(file);
+  return true;
+}
+
+bool exists(const char* path) {
+  struct stat st;
+  return !root.empty() && stat((root + path).c_str(), &st) == 0;
+}
+
+bool remove(const char* path) { return !root.empty() && ::remove((root + path).c_str()) == 0; }
+
+struct Reader::Impl {
+  FILE* file;
+  size_t size;
+};
+
+bool Reader::open(const char* path) {
+  close();
+  if (root.empty()) return false;
+  FILE* file = fopen((root + path).c_str(), "rb");
+  if (!file) return false;
+  fseek(file, 0, SEEK_END);
+  impl = new Impl{file, (size_t)ftell(file)};
+  return true;
+}
+
+size_t Reader::size() const { return impl ? impl->size : 0; }
+
+size_t Reader::read(size_t offset, void* buffer, size_t length) {
+  if (!impl || fseek(impl->file, offset, SEEK_SET) != 0) return 0;
+  return fread(buffer, 1, length, impl->file);
+}
+
+void Reader::close() {
+  if (!impl) return;
+  fclose(impl->file);
+  delete impl;
+  impl = nullptr;
+}
+
+}  // namespace files
+}  // namespace hal
+
+#endif
@@ -0,0 +1,81 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+// glibc's own allocator entry points, so the wrappers below can count bytes
+// without a dlsym() dance
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+static size_t inUse = 0;
+static size_t peak = 0;
+
+static void* counted(void* ptr) {
+  if (ptr) {
+    inUse += malloc_usable_size(ptr);
+    if (inUse > peak) peak = inUse;
+  }
+  return ptr;
+}
+
+extern "C" {
+
+void* malloc(size_t size) { return counted(__libc_malloc(size)); }
+void* calloc(size_t n, size_t size) { return counted(__libc_calloc(n, size)); }
+void* memalign(size_t alignment, size_t size) { return counted(__libc_memalign(alignment, size)); }
+void* aligned_alloc(size_t alignment, size_t size) { return memalign(alignment, size); }
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+  void* ptr = memalign(alignment, size);
+  if (!ptr) return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+void free(void* ptr) {
+  if (ptr) inUse -= malloc_usable_size(ptr);
+  __libc_free(ptr);
+}
+
+void* realloc(void* ptr, size_t size) {
+  size_t before = ptr ? malloc_usable_size(ptr) : 0;
+  void* grown = __libc_realloc(ptr, size);
+  if (grown || size == 0) inUse -= before;  // On failure the old block is untouched
+  return counted(grown);
+}
+
+}  // extern "C"
+
+namespace hal {
+
+uint32_t heapUsed() { return (uint32_t)inUse; }
+uint32_t heapPeak() { return (uint32_t)peak; }
+void resetHeapPeak() { peak = inUse; }
+
+}  // namespace hal
+
+#else
+
+// Other host libcs: no allocation accounting
+namespace hal {
+
+uint32_t heapUsed() { return 0; }
+uint32_t heapPeak() { return 0; }
+void resetHeapPeak() {}
+
+}  // namespace hal
+
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace hal {
+
+// Same codes as ESP8266HTTPClient
+static const int ERROR_CONNECTION_FAILED = -1;
+static const int ERROR_SEND_FAILED = -3;
+static const int ERROR_NO_RESPONSE = -4;
+static const int ERROR_TIMEOUT = -11;
+
+static const int RESPONSE_TIMEOUT_MS = 5000;
+
+int HttpClient::post(const char* host, uint16_t port, const char* path,
+                     const char* contentType, const String& body, String& response) {
+  // --upstream HOST[:PORT] redirects every request, e.g. to a local results server
+  std::string connectHost = host;
+  if (native::config().upstream) {
+    connectHost = native::config().upstream;
+    size_t colon = connectHost.find(':');
+    if (colon != std::string::npos) {
+      port = (uint16_t)atoi(connectHost.c_str() + colon + 1);
+      connectHost.resize(colon);
+    }
+  }
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* res = nullptr;
+  char portText[8];
+  snprintf(portText, sizeof(portText), "%u", port);
+  if (getaddrinfo(connectHost.c_str(), portText, &hints, &res) != 0) return ERROR_CONNECTION_FAILED;
+
+  int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  bool connected = fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) == 0;
+  freeaddrinfo(res);
+  if (!connected) {
+    if (fd >= 0) close(fd);
+    return ERROR_CONNECTION_FAILED;
+  }
+
+  std::string request = std::string("POST ") + path + " HTTP/1.1\r\nHost: " + host + "\r\n" +
+                        "Content-Type: " + contentType + "\r\n" +
+                        "Content-Length: " + std::to_string(body.length()) + "\r\n" +
+                        "Connection: close\r\n\r\n";
+  request.append(body.c_str(), body.length());
+  for (size_t sent = 0; sent < request.size();) {
+    ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      close(fd);
+      return ERROR_SEND_FAILED;
+    }
+    sent += n;
+  }
+
+  std::string reply;
+  char buf[1024];
+  for (;;) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, RESPONSE_TIMEOUT_MS) <= 0) {
+      close(fd);
+      return ERROR_TIMEOUT;
+    }
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) break;
+    reply.append(buf, n);
+  }
+  close(fd);
+
+  int code = 0;
+  if (sscanf(reply.c_str(), "HTTP/%*d.%*d %d", &code) != 1) return ERROR_NO_RESPONSE;
+  size_t bodyStart = reply.find("\r\n\r\n");
+  response = bodyStart == std::string::npos ? String() : String(reply.substr(bodyStart + 4));
+  return code;
+}
+
+String HttpClient::errorToString(int code) {
+  switch (code) {
+    case ERROR_CONNECTION_FAILED: return "connection failed";
+    case ERROR_SEND_FAILED: return "send payload failed";
+    case ERROR_NO_RESPONSE: return "no HTTP server";
+    case ERROR_TIMEOUT: return "read Timeout";
+    default: return String();
+  }
+}
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,476 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+#include "Replay.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hal {
+
+static const int MAX_ROUTES = 32;
+static const int REQUEST_TIMEOUT_MS = 2000;
+static const size_t MAX_REQUEST_SIZE = 64 * 1024;
+
+struct Route {
+  const char* uri;
+  HTTPMethod method;
+  HttpServer::Handler handler;
+};
+
+// One connection at a time, Connection: close, like ESP8266WebServer
+struct HttpServer::Impl {
+  uint16_t port;
+  int listenFd;
+  Route routes[MAX_ROUTES];
+  int routeCount;
+  HttpServer::Handler notFound;
+  HttpServer::Handler observer;
+
+  // Current request
+  int clientFd;
+  uint32_t clientAddress;
+  HTTPMethod method;
+  std::string uri;
+  std::string head;  // Request line and headers, for header()
+  std::vector<std::pair<std::string, std::string>> args;
+  std::string extraHeaders;
+  bool responded;
+  bool streaming;  // Between beginResponse() and endResponse()
+  std::string* capture;  // Replayed requests: the response goes here, not to a socket
+  int status;
+
+  bool connected() const { return clientFd >= 0 || capture != nullptr; }
+
+  int eventFds[MAX_EVENT_STREAMS];  // Open event streams, -1 when free
+};
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static std::string urlDecode(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') {
+      out += ' ';
+    } else if (s[i] == '%' && i + 2 < s.size() && hexValue(s[i + 1]) >= 0 && hexValue(s[i + 2]) >= 0) {
+      out += (char)(hexValue(s[i + 1]) * 16 + hexValue(s[i + 2]));
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+static void parseQuery(const std::string& query, std::vector<std::pair<std::string, std::string>>& args) {
+  size_t start = 0;
+  while (start < query.size()) {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos) end = query.size();
+    std::string pair = query.substr(start, end - start);
+    size_t eq = pair.find('=');
+    if (!pair.empty()) {
+      if (eq == std::string::npos) {
+        args.push_back({urlDecode(pair), ""});
+      } else {
+        args.push_back({urlDecode(pair.substr(0, eq)), urlDecode(pair.substr(eq + 1))});
+      }
+    }
+    start = end + 1;
+  }
+}
+
+static HTTPMethod parseMethod(const std::string& m) {
+  if (m == "GET") return HTTP_GET;
+  if (m == "HEAD") return HTTP_HEAD;
+  if (m == "POST") return HTTP_POST;
+  if (m == "PUT") return HTTP_PUT;
+  if (m == "PATCH") return HTTP_PATCH;
+  if (m == "DELETE") return HTTP_DELETE;
+  if (m == "OPTIONS") return HTTP_OPTIONS;
+  return HTTP_ANY;
+}
+
+static const char* statusText(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+// Reads headers and body; false on timeout, oversize or malformed request
+static bool readRequest(int fd, std::string& head, std::string& body) {
+  std::string data;
+  size_t headerEnd = std::string::npos;
+  size_t contentLength = 0;
+  char buf[1024];
+
+  for (;;) {
+    if (headerEnd != std::string::npos && data.size() >= headerEnd + 4 + contentLength) break;
+
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) return false;
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return false;
+    data.append(buf, n);
+    if (data.size() > MAX_REQUEST_SIZE) return false;
+
+    if (headerEnd == std::string::npos) {
+      headerEnd = data.find("\r\n\r\n");
+      if (headerEnd != std::string::npos) {
+        std::string lower = data.substr(0, headerEnd);
+        for (char& c : lower) c = tolower(c);
+        size_t cl = lower.find("\r\ncontent-length:");
+        if (cl != std::string::npos) contentLength = strtoul(lower.c_str() + cl + 17, nullptr, 10);
+      }
+    }
+  }
+
+  head = data.substr(0, headerEnd);
+  body = data.substr(headerEnd + 4, contentLength);
+  return true;
+}
+
+// Every server, for requests replayed without a socket
+static const size_t MAX_SERVERS = 4;
+static HttpServer::Impl* servers[MAX_SERVERS];
+static size_t serverCount = 0;
+
+static void sendAll(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    data += n;
+    len -= n;
+  }
+}
+
+// To the client, or into the capture of a replayed request
+static void output(HttpServer::Impl* impl, const char* data, size_t len) {
+  if (impl->capture) {
+    impl->capture->append(data, len);
+  } else {
+    sendAll(impl->clientFd, data, len);
+  }
+}
+
+HttpServer::HttpServer(uint16_t port) : impl(new Impl()) {
+  impl->port = port;
+  impl->listenFd = -1;
+  impl->routeCount = 0;
+  impl->notFound = nullptr;
+  impl->observer = nullptr;
+  impl->clientFd = -1;
+  impl->capture = nullptr;
+  if (serverCount < MAX_SERVERS) servers[serverCount++] = impl;
+  for (int i = 0; i < MAX_EVENT_STREAMS; i++) impl->eventFds[i] = -1;
+}
+
+void HttpServer::on(const char* uri, HTTPMethod method, Handler handler) {
+  if (impl->routeCount < MAX_ROUTES) {
+    impl->routes[impl->routeCount++] = {uri, method, handler};
+  }
+}
+
+void HttpServer::onNotFound(Handler handler) { impl->notFound = handler; }
+void HttpServer::onRequest(Handler observer) { impl->observer = observer; }
+
+void HttpServer::begin() {
+  if (impl->listenFd >= 0 || native::replay::active()) return;
+
+  int port = native::config().httpPort ? native::config().httpPort : impl->port;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+    fprintf(stderr, "[HAL] HTTP server: cannot listen on port %d: %s\n", port, strerror(errno));
+    close(fd);
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  impl->listenFd = fd;
+  fprintf(stderr, "[HAL] HTTP server on 127.0.0.1:%d\n", port);
+}
+
+// Sets up the current request and runs its route's handler; false if
+// no route (and no onNotFound() handler) takes it
+static bool dispatch(HttpServer::Impl* impl, HTTPMethod method, const std::string& target,
+                     uint32_t clientAddress, const std::string& head, const std::string& body) {
+  size_t q = target.find('?');
+  impl->clientAddress = clientAddress;
+  impl->method = method;
+  impl->uri = target.substr(0, q);
+  impl->head = head;
+  impl->args.clear();
+  impl->extraHeaders.clear();
+  impl->responded = false;
+  impl->streaming = false;
+  impl->status = 0;
+  if (q != std::string::npos) parseQuery(target.substr(q + 1), impl->args);
+  if (impl->method == HTTP_POST || impl->method == HTTP_PUT || impl->method == HTTP_PATCH) {
+    impl->args.push_back({"plain", body});
+  }
+
+  HttpServer::Handler handler = impl->notFound;
+  for (int i = 0; i < impl->routeCount; i++) {
+    const Route& route = impl->routes[i];
+    if (impl->uri == route.uri && (route.method == HTTP_ANY || route.method == impl->method)) {
+      handler = route.handler;
+      break;
+    }
+  }
+
+  if (!handler) return false;
+  if (impl->observer) impl->observer();
+  handler();
+  return true;
+}
+
+static void replayRequest(HttpServer& server, HttpServer::Impl* impl, const native::replay::Request& request) {
+  std::string response;
+  impl->capture = &response;
+  uint32_t start = cycleCount();
+  bool handled = dispatch(impl, (HTTPMethod)request.method, request.uri, request.clientAddress, "", request.body);
+  if (!impl->responded) server.send(handled ? 500 : 404, "text/plain", handled ? "" : "Not found");
+  uint32_t cpuUs = (cycleCount() - start) / cpuMHz();
+  impl->capture = nullptr;
+  native::replay::served(request, impl->status, response.size(), cpuUs);
+}
+
+void HttpServer::handleClient() {
+  if (native::replay::active()) {
+    native::replay::Request request;
+    if (native::replay::nextRequest(request)) replayRequest(*this, impl, request);
+    return;
+  }
+  if (impl->listenFd < 0) return;
+
+  struct sockaddr_in peer = {};
+  socklen_t peerLen = sizeof(peer);
+  int fd = accept(impl->listenFd, (struct sockaddr*)&peer, &peerLen);
+  if (fd < 0) return;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  std::string head, body;
+  if (!readRequest(fd, head, body)) {
+    close(fd);
+    return;
+  }
+
+  // Request line: METHOD /path?query HTTP/1.x
+  size_t sp1 = head.find(' ');
+  size_t sp2 = head.find(' ', sp1 + 1);
+  impl->clientFd = fd;
+  bool handled = dispatch(impl, parseMethod(head.substr(0, sp1)), head.substr(sp1 + 1, sp2 - sp1 - 1),
+                          peer.sin_addr.s_addr, head, body);
+  if (!impl->responded) {
+    send(handled ? 500 : 404, "text/plain", handled ? "" : "Not found");
+  }
+
+  if (impl->clientFd >= 0) close(impl->clientFd);  // Unless it became an event stream
+  impl->clientFd = -1;
+}
+
+bool HttpServer::hasArg(const char* name) {
+  for (const auto& a : impl->args) {
+    if (a.first == name) return true;
+  }
+  return false;
+}
+
+String HttpServer::arg(const char* name) {
+  for (const auto& a : impl->args) {
+    if (a.first == name) return String(a.second);
+  }
+  return String();
+}
+
+int HttpServer::args() { return impl->args.size(); }
+
+String HttpServer::argName(int i) {
+  return i >= 0 && i < (int)impl->args.size() ? String(impl->args[i].first) : String();
+}
+
+String HttpServer::arg(int i) {
+  return i >= 0 && i < (int)impl->args.size() ? String(impl->args[i].second) : String();
+}
+
+HTTPMethod HttpServer::method() { return impl->method; }
+String HttpServer::uri() { return String(impl->uri); }
+uint32_t HttpServer::clientIP() { return impl->clientAddress; }
+
+// The whole head is kept per request, so any header can be read
+void HttpServer::collectHeaders(const char* const* names, size_t count) {
+  (void)names;
+  (void)count;
+}
+
+String HttpServer::header(const char* name) {
+  size_t nameLength = strlen(name);
+  size_t line = impl->head.find("\r\n");
+  while (line != std::string::npos) {
+    line += 2;
+    size_t end = impl->head.find("\r\n", line);
+    if (end == std::string::npos) end = impl->head.size();
+    if (end - line > nameLength && impl->head[line + nameLength] == ':' &&
+        strncasecmp(impl->head.c_str() + line, name, nameLength) == 0) {
+      size_t value = line + nameLength + 1;
+      while (value < end && impl->head[value] == ' ') value++;
+      return String(impl->head.substr(value, end - value));
+    }
+    line = impl->head.find("\r\n", line);
+  }
+  return String();
+}
+
+void HttpServer::sendHeader(const char* name, const String& value) {
+  impl->extraHeaders += name;
+  impl->extraHeaders += ": ";
+  impl->extraHeaders += value.c_str();
+  impl->extraHeaders += "\r\n";
+}
+
+void HttpServer::send(int code, const char* contentType, const String& body) {
+  send(code, contentType, body.c_str(), body.length());
+}
+
+// Status line and headers; a negative length leaves the body delimited by
+// the connection closing
+static std::string responseHead(HttpServer::Impl* impl, int code, const char* contentType, long length) {
+  char status[128];
+  snprintf(status, sizeof(status), "HTTP/1.1 %d %s\r\n", code, statusText(code));
+  std::string head = status;
+  if (contentType) {
+    head += "Content-Type: ";
+    head += contentType;
+    head += "\r\n";
+  }
+  if (length >= 0) head += "Content-Length: " + std::to_string(length) + "\r\n";
+  head += impl->extraHeaders;
+  head += "Connection: close\r\n\r\n";
+  return head;
+}
+
+void HttpServer::send(int code, const char* contentType, const char* body, size_t length) {
+  if (!impl->connected() || impl->responded) return;
+  impl->responded = true;
+  impl->status = code;
+
+  std::string response = responseHead(impl, code, contentType, (long)length);
+  if (impl->method != HTTP_HEAD) response.append(body, length);
+  output(impl, response.data(), response.size());
+}
+
+void HttpServer::send(int code) { send(code, nullptr, String()); }
+
+// No separate flash on the host; PROGMEM data is ordinary memory
+void HttpServer::sendProgmem(int code, const char* contentType, const uint8_t* data, size_t length) {
+  send(code, contentType, (const char*)data, length);
+}
+
+void HttpServer::beginResponse(int code, const char* contentType) {
+  if (!impl->connected() || impl->responded) return;
+  impl->responded = true;
+  impl->streaming = true;
+  impl->status = code;
+
+  std::string head = responseHead(impl, code, contentType, -1);
+  output(impl, head.data(), head.size());
+}
+
+void HttpServer::sendContent(const char* data, size_t length) {
+  if (!impl->connected() || !impl->streaming || impl->method == HTTP_HEAD) return;
+  output(impl, data, length);
+}
+
+void HttpServer::endResponse() { impl->streaming = false; }
+
+int HttpServer::openEventStream() {
+  if (impl->clientFd < 0 || impl->responded) return -1;
+  for (int i = 0; i < MAX_EVENT_STREAMS; i++) {
+    if (impl->eventFds[i] < 0) {
+      static const char headers[] =
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Type: text/event-stream\r\n"
+          "Cache-Control: no-cache\r\n"
+          "Access-Control-Allow-Origin: *\r\n"
+          "Connection: keep-alive\r\n\r\n";
+      sendAll(impl->clientFd, headers, sizeof(headers) - 1);
+      impl->responded = true;
+      impl->eventFds[i] = impl->clientFd;
+      impl->clientFd = -1;  // handleClient() must not close it
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool HttpServer::writeEventStream(int stream, const char* data, size_t length) {
+  if (stream < 0 || stream >= MAX_EVENT_STREAMS || impl->eventFds[stream] < 0) return false;
+  // Never block the loop on a slow subscriber: a full socket buffer counts as gone
+  ssize_t n = ::send(impl->eventFds[stream], data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (n != (ssize_t)length) {
+    closeEventStream(stream);
+    return false;
+  }
+  return true;
+}
+
+void HttpServer::closeEventStream(int stream) {
+  if (stream < 0 || stream >= MAX_EVENT_STREAMS || impl->eventFds[stream] < 0) return;
+  close(impl->eventFds[stream]);
+  impl->eventFds[stream] = -1;
+}
+
+namespace native {
+
+bool serveLocally(const replay::Request& request, int& status, std::string& response) {
+  if (serverCount == 0) return false;
+  HttpServer::Impl* impl = servers[0];
+  impl->capture = &response;
+  bool handled = dispatch(impl, (HTTPMethod)request.method, request.uri, request.clientAddress, "", request.body);
+  impl->capture = nullptr;
+  status = impl->responded ? impl->status : 404;
+  if (!impl->responded) return false;
+  // Only the body is wanted
+  size_t bodyStart = response.find("\r\n\r\n");
+  response.erase(0, bodyStart == std::string::npos ? response.size() : bodyStart + 4);
+  return handled;
+}
+
+}  // namespace native
+}  // namespace hal
+
+#endif
@@ -0,0 +1,15 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+
+// No LED on the host; the blink delays still run so timing matches the board
+namespace hal {
+
+void Led::begin() {}
+void Led::on() {}
+void Led::off() {}
+void Led::dim(uint16_t) {}
+
+}  // namespace hal
+
+#endif
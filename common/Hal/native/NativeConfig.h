@@ -0,0 +1,40 @@
+#ifndef HAL_NATIVE_CONFIG_H
+#define HAL_NATIVE_CONFIG_H
+
+#include <stdint.h>
+
+// Host-side wiring, filled in from the command line by NativeMain.cpp
+
+namespace hal {
+namespace native {
+
+const int MAX_SERIAL_BINDINGS = 8;
+const int MAX_REPLAY_DUMPS = 8;
+
+struct SerialBinding {
+  int8_t rxPin;
+  const char* spec;  // "pty", "fd:N" or a device path
+};
+
+struct Config {
+  SerialBinding serial[MAX_SERIAL_BINDINGS];
+  int serialCount;
+  int httpPort;          // Overrides the port passed to HttpServer (0 = keep)
+  const char* upstream;  // HOST[:PORT] that every outgoing HTTP request connects to instead
+  bool quiet;            // Drop Serial/Serial1 debug output
+  bool pacing;           // Make serial writes take as long as they would on the wire
+  const char* dataDir;   // RTC memory and flash files (nullptr = none kept)
+  const char* replay;    // Trace to replay instead of live I/O (see Replay.h)
+  const char* replayOut;
+  uint32_t replayTailMs;  // Keep running this long after the last record
+  const char* replayDumps[MAX_REPLAY_DUMPS];  // GET these when done
+  int replayDumpCount;
+};
+
+Config& config();
+const char* serialSpec(int8_t rxPin);
+
+}  // namespace native
+}  // namespace hal
+
+#endif
@@ -0,0 +1,119 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+#include "Replay.h"
+
+#include <signal.h>
+
+// Arduino entry points, defined by the firmware
+void setup();
+void loop();
+
+namespace hal {
+namespace native {
+
+static Config current = {{}, 0, 0, nullptr, false, true, nullptr, nullptr, nullptr, 2000, {}, 0};
+
+Config& config() { return current; }
+
+const char* serialSpec(int8_t rxPin) {
+  for (int i = 0; i < current.serialCount; i++) {
+    if (current.serial[i].rxPin == rxPin) return current.serial[i].spec;
+  }
+  return nullptr;
+}
+
+// Unit tests bring their own main()
+#if !defined(PIO_UNIT_TESTING)
+static void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --serial RX=SPEC        bind the serial port receiving on GPIO RX to SPEC:\n"
+          "                          'pty' (create and print a pseudo-terminal), 'fd:N', or a device path\n"
+          "  --http-port N           listen on 127.0.0.1:N instead of the firmware's port\n"
+          "  --upstream HOST[:PORT]  send every outgoing HTTP request to HOST\n"
+          "  --no-pacing             don't delay serial writes by their wire time\n"
+          "  --data-dir DIR          keep RTC memory and flash files in DIR, across restarts\n"
+          "  --quiet                 drop Serial debug output\n"
+          "  --replay FILE           run on a virtual clock, fed from a trace instead of live I/O\n"
+          "  --replay-out DIR        write requests.jsonl, summary.json and dumps to DIR (default .)\n"
+          "  --replay-dump PATH      GET PATH once the trace has played out, into DIR (repeatable)\n"
+          "  --replay-tail MS        keep running MS after the last record (default 2000)\n",
+          argv0);
+}
+
+static bool parseArgs(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (strcmp(arg, "--serial") == 0 && value) {
+      const char* eq = strchr(value, '=');
+      if (!eq || current.serialCount >= MAX_SERIAL_BINDINGS) return false;
+      current.serial[current.serialCount++] = {(int8_t)atoi(value), eq + 1};
+      i++;
+    } else if (strcmp(arg, "--http-port") == 0 && value) {
+      current.httpPort = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--upstream") == 0 && value) {
+      current.upstream = value;
+      i++;
+    } else if (strcmp(arg, "--data-dir") == 0 && value) {
+      current.dataDir = value;
+      i++;
+    } else if (strcmp(arg, "--replay") == 0 && value) {
+      current.replay = value;
+      i++;
+    } else if (strcmp(arg, "--replay-out") == 0 && value) {
+      current.replayOut = value;
+      i++;
+    } else if (strcmp(arg, "--replay-dump") == 0 && value && value[0] == '/' &&
+               current.replayDumpCount < MAX_REPLAY_DUMPS) {
+      current.replayDumps[current.replayDumpCount++] = value;
+      i++;
+    } else if (strcmp(arg, "--replay-tail") == 0 && value) {
+      current.replayTailMs = strtoul(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--no-pacing") == 0) {
+      current.pacing = false;
+    } else if (strcmp(arg, "--quiet") == 0) {
+      current.quiet = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
+}  // namespace native
+}  // namespace hal
+
+#if !defined(PIO_UNIT_TESTING)
+int main(int argc, char** argv) {
+  if (!hal::native::parseArgs(argc, argv)) {
+    hal::native::usage(argv[0]);
+    return 2;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if (hal::native::config().replay && !hal::native::replay::load(hal::native::config().replay)) {
+    return 1;
+  }
+
+  setup();
+  if (hal::native::replay::active()) {
+    do {
+      loop();
+    } while (hal::native::replay::tick());
+    hal::native::replay::finish();
+    return 0;
+  }
+  for (;;) {
+    loop();
+  }
+}
+#endif
+
+#endif
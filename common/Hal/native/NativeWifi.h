@@ -0,0 +1,23 @@
+#ifndef HAL_NATIVE_WIFI_H
+#define HAL_NATIVE_WIFI_H
+
+#include <stdint.h>
+
+// Stations on the simulated access point, for tests of SoftAP station
+// handling. associate() and leave() raise the events a phone joining or
+// leaving would; hal::wifi::deauth() drops a station silently.
+
+namespace hal {
+namespace native {
+namespace wifi {
+
+// False when the MAC is already associated or every slot is taken
+bool associate(const uint8_t mac[6], uint32_t address);
+bool leave(const uint8_t mac[6]);
+bool associated(const uint8_t mac[6]);
+
+}  // namespace wifi
+}  // namespace native
+}  // namespace hal
+
+#endif
@@ -0,0 +1,231 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+#include "Replay.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace hal {
+namespace native {
+namespace replay {
+
+// Layout of a trace file (common/Trace/Trace.h)
+static const char MAGIC[4] = {'T', 'R', 'C', '1'};
+static const size_t FILE_HEADER_SIZE = 16;
+static const size_t RECORD_HEADER_SIZE = 8;
+enum { UART_RX = 1, UART_TX = 2, HTTP = 3, STATE = 4 };
+static const uint8_t BODY_TRUNCATED = 0x80;
+
+static const uint64_t LOOP_US = 1000;
+
+struct Chunk {
+  uint32_t time;
+  std::string bytes;
+};
+
+struct TxCheck {
+  std::string expected;
+  size_t sent = 0;
+  size_t matched = 0;  // Leading bytes identical to the recording
+  bool diverged = false;
+};
+
+static bool loaded = false;
+static uint64_t clockUs = 0;
+static uint32_t lastRecord = 0;
+static uint32_t dropped = 0;
+static std::map<int8_t, std::deque<Chunk>> rxQueues;
+static std::map<int8_t, TxCheck> txChecks;
+static std::deque<Request> requests;
+static size_t stateRecords = 0;
+static size_t served_ = 0;
+static FILE* requestLog = nullptr;
+
+static uint32_t le32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t le16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+static std::string outPath(const std::string& name) {
+  const char* dir = config().replayOut ? config().replayOut : ".";
+  return std::string(dir) + "/" + name;
+}
+
+static void writeJsonString(FILE* out, const std::string& s) {
+  fputc('"', out);
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20 || c >= 0x7F) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+bool load(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "[HAL] Replay: cannot open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + n);
+  fclose(file);
+
+  if (data.size() < FILE_HEADER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+    fprintf(stderr, "[HAL] Replay: %s is not a trace\n", path);
+    return false;
+  }
+  dropped = le32(&data[8]);
+
+  size_t records = 0;
+  for (size_t at = FILE_HEADER_SIZE; at + RECORD_HEADER_SIZE <= data.size(); records++) {
+    const uint8_t* record = &data[at];
+    uint32_t time = le32(record);
+    uint8_t type = record[4];
+    uint8_t channel = record[5];
+    size_t length = le16(record + 6);
+    const uint8_t* payload = record + RECORD_HEADER_SIZE;
+    if (at + RECORD_HEADER_SIZE + length > data.size()) break;  // Cut short
+    at += RECORD_HEADER_SIZE + length;
+    lastRecord = time;
+
+    if (type == UART_RX) {
+      rxQueues[(int8_t)channel].push_back({time, std::string((const char*)payload, length)});
+    } else if (type == UART_TX) {
+      txChecks[(int8_t)channel].expected.append((const char*)payload, length);
+    } else if (type == HTTP && length >= 5 && 5u + payload[4] <= length) {
+      Request request;
+      request.time = time;
+      request.method = channel & ~BODY_TRUNCATED;
+      request.truncated = channel & BODY_TRUNCATED;
+      request.clientAddress = le32(payload);
+      request.uri.assign((const char*)payload + 5, payload[4]);
+      request.body.assign((const char*)payload + 5 + payload[4], length - 5 - payload[4]);
+      requests.push_back(request);
+    } else if (type == STATE) {
+      stateRecords++;
+    }
+  }
+
+  requestLog = fopen(outPath("requests.jsonl").c_str(), "w");
+  if (!requestLog) {
+    fprintf(stderr, "[HAL] Replay: cannot write to %s\n", outPath("").c_str());
+    return false;
+  }
+  fprintf(stderr, "[HAL] Replay: %zu records up to %u ms, %zu requests%s\n", records, (unsigned)lastRecord,
+          requests.size(), dropped ? " (oldest records were dropped, so the start is not from boot)" : "");
+  loaded = true;
+  return true;
+}
+
+bool active() { return loaded; }
+
+uint64_t micros() { return clockUs; }
+void advance(uint64_t us) { clockUs += us; }
+
+static uint32_t nowMs() { return (uint32_t)(clockUs / 1000); }
+
+size_t receive(int8_t rxPin, uint8_t* buf, size_t cap) {
+  auto queue = rxQueues.find(rxPin);
+  if (queue == rxQueues.end()) return 0;
+  size_t n = 0;
+  while (n < cap && !queue->second.empty() && queue->second.front().time <= nowMs()) {
+    Chunk& chunk = queue->second.front();
+    size_t take = std::min(cap - n, chunk.bytes.size());
+    memcpy(buf + n, chunk.bytes.data(), take);
+    n += take;
+    chunk.bytes.erase(0, take);
+    if (chunk.bytes.empty()) queue->second.pop_front();
+  }
+  return n;
+}
+
+void transmit(int8_t rxPin, const uint8_t* data, size_t length) {
+  TxCheck& check = txChecks[rxPin];
+  for (size_t i = 0; i < length; i++) {
+    if (!check.diverged && check.sent < check.expected.size() && (uint8_t)check.expected[check.sent] == data[i]) {
+      check.matched++;
+    } else {
+      check.diverged = true;
+    }
+    check.sent++;
+  }
+}
+
+bool nextRequest(Request& request) {
+  if (requests.empty() || requests.front().time > nowMs()) return false;
+  request = requests.front();
+  requests.pop_front();
+  return true;
+}
+
+void served(const Request& request, int status, size_t bytes, uint32_t cpuUs) {
+  served_++;
+  fprintf(requestLog, "{\"time\":%u,\"replayed_at\":%u,\"method\":%u,\"uri\":", (unsigned)request.time,
+          (unsigned)nowMs(), (unsigned)request.method);
+  writeJsonString(requestLog, request.uri);
+  fprintf(requestLog, ",\"truncated\":%s,\"status\":%d,\"bytes\":%zu,\"cpu_us\":%u}\n",
+          request.truncated ? "true" : "false", status, bytes, (unsigned)cpuUs);
+}
+
+bool tick() {
+  advance(LOOP_US);
+  return nowMs() <= lastRecord + config().replayTailMs;
+}
+
+void finish() {
+  fclose(requestLog);
+  requestLog = nullptr;
+
+  FILE* summary = fopen(outPath("summary.json").c_str(), "w");
+  if (!summary) return;
+  fprintf(summary, "{\"end_ms\":%u,\"last_record_ms\":%u,\"dropped_records\":%u,\"state_records\":%zu,"
+          "\"requests\":%zu,\"unserved_requests\":%zu,\"tx\":[",
+          (unsigned)nowMs(), (unsigned)lastRecord, (unsigned)dropped, stateRecords, served_, requests.size());
+  bool first = true;
+  for (const auto& entry : txChecks) {
+    const TxCheck& check = entry.second;
+    fprintf(summary, "%s{\"channel\":%d,\"expected\":%zu,\"sent\":%zu,\"matched\":%zu}", first ? "" : ",",
+            entry.first, check.expected.size(), check.sent, check.matched);
+    first = false;
+  }
+  // Dumps: GET each path once the trace has played out (e.g. /profile, /trace)
+  fprintf(summary, "],\"dumps\":[");
+  for (int i = 0; i < config().replayDumpCount; i++) {
+    Request request = {nowMs(), HTTP_GET, false, 0x0100007F, config().replayDumps[i], ""};
+    int status = 0;
+    std::string response;
+    bool ok = serveLocally(request, status, response);
+    std::string name = request.uri.substr(1);
+    for (char& c : name) {
+      if (c == '/' || c == '?' || c == '&' || c == '=') c = '_';
+    }
+    if (ok) {
+      FILE* dump = fopen(outPath(name).c_str(), "wb");
+      if (dump) {
+        fwrite(response.data(), 1, response.size(), dump);
+        fclose(dump);
+      }
+    }
+    fprintf(summary, "%s{\"uri\":", i ? "," : "");
+    writeJsonString(summary, request.uri);
+    fprintf(summary, ",\"status\":%d,\"file\":", ok ? status : 0);
+    writeJsonString(summary, ok ? name : "");
+    fprintf(summary, "}");
+  }
+  fprintf(summary, "]}\n");
+  fclose(summary);
+}
+
+}  // namespace replay
+}  // namespace native
+}  // namespace hal
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef HAL_NATIVE_REPLAY_H
+#define HAL_NATIVE_REPLAY_H
+
+#include <stdint.h>
+
+#include <string>
+
+// Trace replay (--replay FILE, see common/Trace/Trace.h).
+//
+// The firmware runs on a virtual clock instead of the host's: each loop()
+// is one millisecond, delay() and serial wire time advance it by their own
+// length and yield() by a little. Recorded link bytes are handed to the
+// port with the same RX pin, and recorded HTTP requests to the server, once
+// the clock reaches the time they were recorded at, so the state machines
+// see the field's inputs at the field's times on every run. Profiler zones
+// still measure host CPU time. What the firmware sends on a link is
+// compared with the recorded TX bytes. Results go to --replay-out.
+
+namespace hal {
+namespace native {
+namespace replay {
+
+struct Request {
+  uint32_t time;
+  uint8_t method;  // HTTPMethod
+  bool truncated;  // The body was cut when it was recorded
+  uint32_t clientAddress;
+  std::string uri;  // With the query string
+  std::string body;
+};
+
+const uint64_t YIELD_US = 100;
+
+bool load(const char* path);
+bool active();
+
+uint64_t micros();
+void advance(uint64_t us);
+
+// Recorded RX bytes for the port whose time has come
+size_t receive(int8_t rxPin, uint8_t* buf, size_t cap);
+// Bytes the firmware sent, checked against the recording
+void transmit(int8_t rxPin, const uint8_t* data, size_t length);
+
+// The next recorded request whose time has come
+bool nextRequest(Request& request);
+void served(const Request& request, int status, size_t bytes, uint32_t cpuUs);
+
+// Ends a loop() iteration. False once the trace is used up and the tail
+// has run out; finish() then writes the summary and the dumps.
+bool tick();
+void finish();
+
+}  // namespace replay
+
+// Runs a request through the first server's routes without a socket (HttpServer.cpp)
+bool serveLocally(const replay::Request& request, int& status, std::string& response);
+
+}  // namespace native
+}  // namespace hal
+
+#endif
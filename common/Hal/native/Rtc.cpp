@@ -0,0 +1,49 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace hal {
+
+static uint8_t memory[RTC_USER_MEMORY_SIZE];
+static int fd = -2;  // -2 not opened yet, -1 in memory only
+
+// Loaded from --data-dir on first use and written through, so a SIGKILL
+// loses nothing
+static void open() {
+  if (fd != -2) return;
+  fd = -1;
+  const char* dir = native::config().dataDir;
+  if (!dir) return;
+  std::string path = std::string(dir) + "/rtc.bin";
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "[HAL] RTC memory: cannot open %s\n", path.c_str());
+    return;
+  }
+  if (pread(fd, memory, sizeof(memory), 0) < 0) memset(memory, 0, sizeof(memory));
+}
+
+bool rtcRead(size_t offset, void* data, size_t length) {
+  if (offset % 4 != 0 || length % 4 != 0 || offset + length > RTC_USER_MEMORY_SIZE) return false;
+  open();
+  memcpy(data, memory + offset, length);
+  return true;
+}
+
+bool rtcWrite(size_t offset, const void* data, size_t length) {
+  if (offset % 4 != 0 || length % 4 != 0 || offset + length > RTC_USER_MEMORY_SIZE) return false;
+  open();
+  memcpy(memory + offset, data, length);
+  if (fd >= 0 && pwrite(fd, memory + offset, length, offset) != (ssize_t)length) return false;
+  return true;
+}
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,152 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeConfig.h"
+#include "Replay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace hal {
+
+static const size_t RX_BUFFER_SIZE = 512;
+static const size_t MAX_PORTS = 8;
+
+struct SerialPort::Impl {
+  int8_t rxPin;
+  int8_t txPin;
+  bool hardware;
+  uint32_t baud;
+  int fd;
+  uint8_t rx[RX_BUFFER_SIZE];
+  size_t rxHead;
+  size_t rxTail;
+
+  void fill() {
+    if (fd < 0 && !native::replay::active()) return;
+    if (rxHead == rxTail) rxHead = rxTail = 0;
+    if (rxTail == RX_BUFFER_SIZE) return;
+    if (native::replay::active()) {
+      rxTail += native::replay::receive(rxPin, rx + rxTail, RX_BUFFER_SIZE - rxTail);
+      return;
+    }
+    ssize_t n = ::read(fd, rx + rxTail, RX_BUFFER_SIZE - rxTail);
+    if (n > 0) rxTail += n;
+  }
+};
+
+// Every open port, so writes can reach all ports wired to the same TX pin
+static SerialPort::Impl* ports[MAX_PORTS];
+static size_t portCount = 0;
+
+static void makeRaw(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+}
+
+// Opens the host side of a port: "pty" creates a pseudo-terminal and prints
+// the device the other firmware should open, "fd:N" uses an inherited fd.
+static int openSpec(const char* spec, int8_t rxPin) {
+  int fd = -1;
+  if (strcmp(spec, "pty") == 0) {
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) return -1;
+    const char* name = ptsname(fd);
+    // Keep the far end open in raw mode so the line discipline can't mangle
+    // bytes and the master side doesn't see EIO before the peer connects
+    int peer = open(name, O_RDWR | O_NOCTTY);
+    if (peer >= 0) makeRaw(peer);
+    fprintf(stderr, "[HAL] Serial RX pin %d on %s\n", rxPin, name);
+  } else if (strncmp(spec, "fd:", 3) == 0) {
+    fd = atoi(spec + 3);
+  } else {
+    fd = open(spec, O_RDWR | O_NOCTTY);
+    if (fd >= 0 && isatty(fd)) makeRaw(fd);
+  }
+  if (fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+static void writeAll(int fd, const uint8_t* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if (n > 0) {
+      data += n;
+      len -= n;
+    } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      return;  // Peer gone: the bytes are lost, as on an unplugged wire
+    }
+  }
+}
+
+SerialPort::SerialPort(int8_t rxPin, int8_t txPin)
+    : impl(new Impl{rxPin, txPin, false, 0, -1, {}, 0, 0}) {}
+
+SerialPort::SerialPort(HardwareUart uart)
+    : impl(new Impl{(int8_t)(uart.swapPins ? 13 : 3), (int8_t)(uart.swapPins ? 15 : 1), true, 0, -1, {}, 0, 0}) {}
+
+void SerialPort::begin(uint32_t baud) {
+  impl->baud = baud;
+  if (impl->fd >= 0) return;
+  if (native::replay::active()) return;  // Fed from the trace instead
+
+  const char* spec = native::serialSpec(impl->rxPin);
+  if (spec == nullptr) {
+    fprintf(stderr, "[HAL] Serial RX pin %d not connected\n", impl->rxPin);
+  } else if ((impl->fd = openSpec(spec, impl->rxPin)) < 0) {
+    fprintf(stderr, "[HAL] Serial RX pin %d: cannot open %s\n", impl->rxPin, spec);
+  }
+  if (portCount < MAX_PORTS) ports[portCount++] = impl;
+}
+
+void SerialPort::setBaud(uint32_t baud) { impl->baud = baud; }
+uint32_t SerialPort::baud() const { return impl->baud; }
+bool SerialPort::isHardware() const { return impl->hardware; }
+int8_t SerialPort::rxPin() const { return impl->rxPin; }
+
+int SerialPort::available() {
+  impl->fill();
+  return impl->rxTail - impl->rxHead;
+}
+
+int SerialPort::read() {
+  if (impl->rxHead == impl->rxTail) impl->fill();
+  if (impl->rxHead == impl->rxTail) return -1;
+  return impl->rx[impl->rxHead++];
+}
+
+size_t SerialPort::write(uint8_t c) { return write(&c, 1); }
+
+size_t SerialPort::write(const uint8_t* data, size_t len) {
+  if (impl->txPin < 0) return 0;
+  if (native::replay::active()) {
+    native::replay::transmit(impl->rxPin, data, len);
+    if (impl->baud > 0) native::replay::advance((uint64_t)len * 10 * 1000000ull / impl->baud);
+    return len;
+  }
+  for (size_t i = 0; i < portCount; i++) {
+    if (ports[i]->txPin == impl->txPin && ports[i]->fd >= 0) {
+      writeAll(ports[i]->fd, data, len);
+    }
+  }
+  // Like SoftwareSerial, a write takes as long as the bits take on the wire
+  if (native::config().pacing && impl->baud > 0) {
+    uint64_t us = (uint64_t)len * 10 * 1000000ull / impl->baud;
+    usleep(us);
+  }
+  return len;
+}
+
+size_t SerialPort::print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+size_t SerialPort::print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+size_t SerialPort::println(const String& s) { return print(s) + print("\r\n"); }
+void SerialPort::flush() {}
+
+}  // namespace hal
+
+#endif
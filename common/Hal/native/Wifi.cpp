@@ -0,0 +1,113 @@
+#if !defined(ARDUINO)
+
+#include "../Hal.h"
+#include "NativeWifi.h"
+
+#include <arpa/inet.h>
+
+// The host has no radio: the access point is the loopback interface. No
+// phone ever associates with it, but tests can add stations through
+// NativeWifi.h and see them deauthenticated.
+namespace hal {
+
+String ipToString(uint32_t address) {
+  struct in_addr in;
+  in.s_addr = address;
+  return String(inet_ntoa(in));
+}
+
+namespace wifi {
+
+static const uint8_t MAX_STATIONS = 8;
+
+struct Station {
+  uint8_t mac[6];
+  uint32_t address;
+  bool inUse;
+};
+
+static uint32_t apAddress = 0;
+static uint8_t maxStations = MAX_STATIONS;
+static Station stations[MAX_STATIONS];
+static StationHandler connectedHandler = nullptr;
+static StationHandler disconnectedHandler = nullptr;
+
+static Station* findStation(const uint8_t mac[6]) {
+  for (Station& station : stations) {
+    if (station.inUse && memcmp(station.mac, mac, 6) == 0) return &station;
+  }
+  return nullptr;
+}
+
+bool startAccessPoint(const char* ssid, const char*, uint32_t address, uint32_t, uint8_t,
+                      uint8_t maxConnections) {
+  apAddress = address;
+  maxStations = maxConnections < MAX_STATIONS ? maxConnections : MAX_STATIONS;
+  fprintf(stderr, "[HAL] Access point '%s' simulated on loopback\n", ssid);
+  return true;
+}
+
+uint32_t accessPointIP() { return apAddress; }
+
+void onStationConnected(StationHandler handler) { connectedHandler = handler; }
+void onStationDisconnected(StationHandler handler) { disconnectedHandler = handler; }
+
+bool stationMac(uint32_t address, uint8_t mac[6]) {
+  for (const Station& station : stations) {
+    if (station.inUse && station.address == address) {
+      memcpy(mac, station.mac, 6);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool canDeauth() { return true; }
+
+// Drops the station without a disconnect event, as the caller already
+// forgets it when deauth() succeeds
+bool deauth(const uint8_t mac[6]) {
+  Station* station = findStation(mac);
+  if (station == nullptr) return false;
+  station->inUse = false;
+  return true;
+}
+
+}  // namespace wifi
+
+namespace native {
+namespace wifi {
+
+bool associate(const uint8_t mac[6], uint32_t address) {
+  using namespace hal::wifi;
+  uint8_t count = 0;
+  for (const Station& station : stations) count += station.inUse;
+  if (findStation(mac) != nullptr || count >= maxStations) return false;
+  for (Station& station : stations) {
+    if (!station.inUse) {
+      memcpy(station.mac, mac, 6);
+      station.address = address;
+      station.inUse = true;
+      break;
+    }
+  }
+  if (connectedHandler) connectedHandler(mac);
+  return true;
+}
+
+bool leave(const uint8_t mac[6]) {
+  using namespace hal::wifi;
+  Station* station = findStation(mac);
+  if (station == nullptr) return false;
+  station->inUse = false;
+  if (disconnectedHandler) disconnectedHandler(mac);
+  return true;
+}
+
+bool associated(const uint8_t mac[6]) { return hal::wifi::findStation(mac) != nullptr; }
+
+}  // namespace wifi
+}  // namespace native
+}  // namespace hal
+
+#endif
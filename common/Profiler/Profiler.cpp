@@ -0,0 +1,69 @@
+#include "Profiler.h"
+
+namespace Profiler {
+
+static Zone zones[MAX_ZONES];
+static const char* const* names = nullptr;
+static size_t count = 0;
+static uint32_t resetTime = 0;
+
+void begin(const char* const* zoneNames, size_t zoneCount) {
+  names = zoneNames;
+  count = zoneCount < MAX_ZONES ? zoneCount : MAX_ZONES;
+  reset();
+}
+
+void reset() {
+  memset(zones, 0, sizeof(zones));
+  resetTime = hal::millis();
+  hal::resetHeapPeak();
+}
+
+void record(uint8_t zone, uint32_t cycles) {
+  if (zone >= count) return;
+  Zone& z = zones[zone];
+  z.count++;
+  z.totalCycles += cycles;
+  if (cycles > z.maxCycles) z.maxCycles = cycles;
+  z.buckets[cycles == 0 ? 0 : 31 - __builtin_clz(cycles)]++;
+}
+
+void sampleHeap() {
+  hal::heapUsed();  // Updates the peak on the ESP
+}
+
+void writeJson(String& out) {
+  uint32_t cyclesPerUs = hal::cpuMHz();
+  char buf[96];
+
+  snprintf(buf, sizeof(buf), "{\"enabled\":%s,\"cpu_mhz\":%u,\"since_reset_ms\":%lu,",
+           PROFILER_ENABLED ? "true" : "false", (unsigned)cyclesPerUs, (unsigned long)(hal::millis() - resetTime));
+  out += buf;
+  snprintf(buf, sizeof(buf), "\"heap_used\":%u,\"heap_peak\":%u,\"zones\":[",
+           (unsigned)hal::heapUsed(), (unsigned)hal::heapPeak());
+  out += buf;
+
+  for (size_t i = 0; i < count; i++) {
+    const Zone& z = zones[i];
+    uint32_t meanCycles = z.count ? (uint32_t)(z.totalCycles / z.count) : 0;
+    snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"count\":%u,\"total_us\":%llu,",
+             i ? "," : "", names[i], (unsigned)z.count,
+             (unsigned long long)(z.totalCycles / cyclesPerUs));
+    out += buf;
+    snprintf(buf, sizeof(buf), "\"mean_us\":%u,\"max_us\":%u,\"log2_cycles\":[",
+             (unsigned)(meanCycles / cyclesPerUs), (unsigned)(z.maxCycles / cyclesPerUs));
+    out += buf;
+
+    // Histogram trimmed after the highest non-empty bucket
+    size_t last = BUCKETS;
+    while (last > 0 && z.buckets[last - 1] == 0) last--;
+    for (size_t b = 0; b < last; b++) {
+      snprintf(buf, sizeof(buf), "%s%u", b ? "," : "", (unsigned)z.buckets[b]);
+      out += buf;
+    }
+    out += "]}";
+  }
+  out += "]}";
+}
+
+}  // namespace Profiler
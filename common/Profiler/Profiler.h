@@ -0,0 +1,65 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Hal.h>
+
+// Scoped cycle-count profiler for the hot paths of both firmwares.
+//
+// Each firmware declares its zones as an enum plus a matching name table and
+// passes the table to Profiler::begin(). PROFILE_ZONE(id) times the rest of
+// the enclosing block with the CPU cycle counter (hal::cycleCount()) and adds
+// the result to the zone's count/total/max and a log2(cycles) histogram.
+// The heap peak (hal::heapPeak()) is sampled once per loop() through
+// sampleHeap(), keeping zone exits down to the cycle counter; reset()
+// restarts it along with the zones. All storage is static; nothing is
+// allocated while recording. Build with PROFILER_ENABLED=0 and PROFILE_ZONE() expands
+// to nothing.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+namespace Profiler {
+
+const size_t MAX_ZONES = 16;
+const size_t BUCKETS = 32;  // Bucket i counts samples of [2^i, 2^(i+1)) cycles
+
+struct Zone {
+  uint32_t count;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+  uint32_t buckets[BUCKETS];
+};
+
+void begin(const char* const* zoneNames, size_t zoneCount);
+void reset();
+
+inline uint32_t now() { return hal::cycleCount(); }
+void record(uint8_t zone, uint32_t cycles);
+void sampleHeap();
+
+// Appends {"enabled":..,"cpu_mhz":..,"heap_peak":..,"zones":[...]} to out
+void writeJson(String& out);
+
+class Scope {
+public:
+  explicit Scope(uint8_t zone) : zone(zone), start(now()) {}
+  ~Scope() { record(zone, now() - start); }
+
+private:
+  uint8_t zone;
+  uint32_t start;
+};
+
+}  // namespace Profiler
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(zone) Profiler::Scope PROFILE_CONCAT(profileScope_, __LINE__)(zone)
+#else
+#define PROFILE_ZONE(zone) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#include "RosterCodec.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+namespace RosterCodec {
+
+static const char DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+int Decoder::digitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+  return -1;
+}
+
+// Increments the trailing decimal digits of usn in place, keeping their width.
+// Fails if there are no trailing digits or they would overflow (999 -> 1000).
+bool Decoder::incrementSuffix(char* usn, size_t len) {
+  size_t i = len;
+  while (i > 0 && usn[i - 1] >= '0' && usn[i - 1] <= '9') {
+    i--;
+  }
+  if (i == len) return false;
+
+  for (size_t j = len; j > i; j--) {
+    if (usn[j - 1] != '9') {
+      usn[j - 1]++;
+      return true;
+    }
+    usn[j - 1] = '0';
+  }
+  // Carried out of the digit run: undo and report overflow
+  for (size_t j = i; j < len; j++) usn[j] = '9';
+  return false;
+}
+
+static bool refLess(const UsnRef& a, const UsnRef& b) {
+  size_t n = a.len < b.len ? a.len : b.len;
+  int c = memcmp(a.data, b.data, n);
+  return c != 0 ? c < 0 : a.len < b.len;
+}
+
+static size_t sharedPrefix(const UsnRef& a, const UsnRef& b) {
+  size_t n = a.len < b.len ? a.len : b.len;
+  size_t i = 0;
+  while (i < n && a.data[i] == b.data[i]) i++;
+  return i;
+}
+
+bool encode(UsnRef* usns, size_t count, char separator, Writer writer) {
+  for (size_t i = 0; i < count; i++) {
+    if (usns[i].len == 0 || usns[i].len > MAX_USN_LEN) return false;
+  }
+  std::sort(usns, usns + count, refLess);
+
+  char next[MAX_USN_LEN + 1];
+  size_t i = 0;
+  bool first = true;
+  while (i < count) {
+    const UsnRef& cur = usns[i];
+    size_t shared = first ? 0 : sharedPrefix(usns[i - 1], cur);
+
+    if (!first) writer(&separator, 1);
+    writer(&DIGITS[shared], 1);
+    writer(cur.data + shared, cur.len - shared);
+    first = false;
+    i++;
+
+    // Numeric-suffix fast path: collapse consecutive roll numbers into "*N"
+    memcpy(next, cur.data, cur.len);
+    size_t run = 0;
+    while (i < count && Decoder::incrementSuffix(next, cur.len) &&
+           usns[i].len == cur.len && memcmp(usns[i].data, next, cur.len) == 0) {
+      run++;
+      i++;
+    }
+    if (run > 0) {
+      char token[24];
+      int n = snprintf(token, sizeof(token), "%c%c%u", separator, RUN_CHAR, (unsigned)run);
+      writer(token, n);
+    }
+  }
+  return true;
+}
+
+bool isFrontCodedTag(const char* field, size_t len) {
+  return len == sizeof(FRONT_CODED_TAG) - 1 &&
+         memcmp(field, FRONT_CODED_TAG, len) == 0;
+}
+
+bool isSectionTag(const char* field, size_t len, const char*& id, size_t& idLen, uint16_t& window) {
+  const size_t tagLen = sizeof(SECTION_TAG) - 1;
+  if (len <= tagLen || memcmp(field, SECTION_TAG, tagLen) != 0) return false;
+  id = field + tagLen;
+  idLen = len - tagLen;
+  window = 0;
+
+  const char* colon = static_cast<const char*>(memchr(id, WINDOW_CHAR, idLen));
+  if (colon == nullptr) return true;
+  const char* digits = colon + 1;
+  size_t digitCount = id + idLen - digits;
+  unsigned long seconds = 0;
+  if (digitCount == 0 || digitCount > 5) return true;
+  for (size_t i = 0; i < digitCount; i++) {
+    if (digits[i] < '0' || digits[i] > '9') return true;
+    seconds = seconds * 10 + (digits[i] - '0');
+  }
+  if (seconds == 0 || seconds > MAX_SECTION_WINDOW) return true;
+  idLen = colon - id;
+  window = seconds;
+  return true;
+}
+
+bool isSectionTag(const char* field, size_t len, const char*& id, size_t& idLen) {
+  uint16_t window;
+  return isSectionTag(field, len, id, idLen, window);
+}
+
+bool validSectionId(const char* id, size_t len) {
+  if (len == 0 || len > MAX_SECTION_ID) return false;
+  for (size_t i = 0; i < len; i++) {
+    char c = id[i];
+    bool ok = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '_';
+    if (!ok) return false;
+  }
+  return true;
+}
+
+}  // namespace RosterCodec
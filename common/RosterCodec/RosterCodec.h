@@ -0,0 +1,115 @@
+#ifndef ROSTER_CODEC_H
+#define ROSTER_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Front-coded roster encoding shared by master and slave.
+//
+// USNs are sorted and each one is sent as a single base-36 character giving
+// the length of the prefix shared with the previous USN, followed by the
+// remaining suffix:  1RV17CS001|1RV17CS017  ->  01RV17CS001|817
+// A token "*N" stands for N more USNs, each one the previous USN with its
+// trailing digits incremented (1RV17CS001..1RV17CS060 -> 01RV17CS001|*59).
+// Tokens never contain '<', '>' or '|', so the existing frame markers and
+// separator still apply. The first field after the address is FRONT_CODED_TAG.
+//
+// One frame can carry several section rosters for the same slave: a field
+// SECTION_TAG + id starts a section, and the fields up to the next one are
+// its roster (plain, or FRONT_CODED_TAG first). Fields before any section
+// tag belong to the unnamed section, so untagged frames read as before.
+// The tag may end in ':' and a number of seconds, that section's ACTIVE
+// window (~SLAB-B1:10800); without one the slave's own window applies.
+// A slave's reply for a section carries the tag after the address, without
+// the window.
+
+namespace RosterCodec {
+
+const char FRONT_CODED_TAG[] = "~F";
+const char RUN_CHAR = '*';
+const size_t MAX_USN_LEN = 35;  // Largest prefix length a base-36 digit can hold
+
+const char SECTION_TAG[] = "~S";
+const size_t MAX_SECTIONS = 8;     // Per slave at a time
+const size_t MAX_SECTION_ID = 15;  // Letters, digits, '-' and '_'
+const char WINDOW_CHAR = ':';
+const uint16_t MAX_SECTION_WINDOW = 4 * 3600;  // Seconds
+
+struct UsnRef {
+  const char* data;
+  size_t len;
+};
+
+typedef void (*Writer)(const char* data, size_t length);
+
+// Sorts usns in place and hands the token stream (without the tag) to
+// writer piece by piece, tokens separated by separator. Returns false,
+// before writing anything, if a USN is longer than MAX_USN_LEN, in which
+// case the caller should fall back to the plain format.
+bool encode(UsnRef* usns, size_t count, char separator, Writer writer);
+
+bool isFrontCodedTag(const char* field, size_t len);
+
+// A SECTION_TAG field: true with the section ID's position and length,
+// and its window in seconds (0 if it has none). A window that is not a
+// number from 1 to MAX_SECTION_WINDOW is left in the ID, which
+// validSectionId() then rejects.
+bool isSectionTag(const char* field, size_t len, const char*& id, size_t& idLen, uint16_t& window);
+bool isSectionTag(const char* field, size_t len, const char*& id, size_t& idLen);
+bool validSectionId(const char* id, size_t len);
+
+// Streaming decoder: feed it one token at a time and it calls
+// emit(const char* usn, size_t len) for every USN the token expands to.
+class Decoder {
+public:
+  Decoder() : prevLen(0), hasPrev(false) {}
+
+  template <typename Emit>
+  bool push(const char* token, size_t len, Emit emit) {
+    if (len == 0) return false;
+
+    if (token[0] == RUN_CHAR) {
+      if (!hasPrev || len < 2) return false;
+      unsigned long count = 0;
+      for (size_t i = 1; i < len; i++) {
+        if (token[i] < '0' || token[i] > '9') return false;
+        count = count * 10 + (token[i] - '0');
+        if (count > 0xFFFF) return false;
+      }
+      for (unsigned long i = 0; i < count; i++) {
+        if (!incrementSuffix(prev, prevLen)) return false;
+        emit(prev, prevLen);
+      }
+      return true;
+    }
+
+    int shared = digitValue(token[0]);
+    if (shared < 0 || (size_t)shared > prevLen) return false;
+    if (shared > 0 && !hasPrev) return false;
+    size_t suffixLen = len - 1;
+    if (shared + suffixLen > MAX_USN_LEN) return false;
+
+    for (size_t i = 0; i < suffixLen; i++) {
+      prev[shared + i] = token[1 + i];
+    }
+    prevLen = shared + suffixLen;
+    prev[prevLen] = '\0';
+    hasPrev = true;
+    emit(prev, prevLen);
+    return true;
+  }
+
+private:
+  char prev[MAX_USN_LEN + 1];
+  size_t prevLen;
+  bool hasPrev;
+
+  static int digitValue(char c);
+  static bool incrementSuffix(char* usn, size_t len);
+
+  friend bool encode(UsnRef*, size_t, char, Writer);
+};
+
+}  // namespace RosterCodec
+
+#endif
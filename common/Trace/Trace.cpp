@@ -0,0 +1,162 @@
+#include "Trace.h"
+
+#include <algorithm>
+
+namespace Trace {
+
+// The file header sits right before the ring, so a linearised ring is
+// saved with one write
+static struct {
+  FileHeader header;
+  uint8_t ring[TRACE_RING_SIZE];
+} store;
+
+static size_t head = 0;  // Oldest record
+static size_t used = 0;
+static size_t last = 0;  // Newest record, while lastValid
+static bool lastValid = false;
+static uint32_t dropped = 0;
+
+static void copyIn(size_t at, const void* data, size_t length) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) store.ring[(at + i) % TRACE_RING_SIZE] = bytes[i];
+}
+
+static void copyOut(size_t at, void* data, size_t length) {
+  uint8_t* bytes = static_cast<uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) bytes[i] = store.ring[(at + i) % TRACE_RING_SIZE];
+}
+
+// Drops the oldest records until bytes more fit
+static bool makeRoom(size_t bytes) {
+  if (bytes > TRACE_RING_SIZE) return false;
+  while (TRACE_RING_SIZE - used < bytes) {
+    RecordHeader oldest;
+    copyOut(head, &oldest, sizeof(oldest));
+    size_t size = sizeof(oldest) + oldest.length;
+    if (lastValid && last == head) lastValid = false;
+    head = (head + size) % TRACE_RING_SIZE;
+    used -= size;
+    dropped++;
+  }
+  return true;
+}
+
+static void append(uint8_t type, uint8_t channel, const void* a, size_t aLength, const void* b, size_t bLength) {
+  RecordHeader record = {hal::millis(), type, channel, (uint16_t)(aLength + bLength)};
+  if (!makeRoom(sizeof(record) + aLength + bLength)) return;
+  size_t at = (head + used) % TRACE_RING_SIZE;
+  copyIn(at, &record, sizeof(record));
+  copyIn(at + sizeof(record), a, aLength);
+  copyIn(at + sizeof(record) + aLength, b, bLength);
+  used += sizeof(record) + aLength + bLength;
+  last = at;
+  lastValid = true;
+}
+
+#if TRACE_ENABLED
+void uart(Type type, uint8_t channel, const uint8_t* data, size_t length) {
+  uint32_t now = hal::millis();
+  while (length > 0) {
+    // Extend the newest record while it is the same stream in the same ms
+    RecordHeader newest;
+    if (lastValid) copyOut(last, &newest, sizeof(newest));
+    if (lastValid && newest.type == type && newest.channel == channel && newest.time == now &&
+        sizeof(newest) + newest.length < MAX_RECORD) {
+      size_t n = std::min(length, MAX_RECORD - sizeof(newest) - newest.length);
+      makeRoom(n);
+      if (!lastValid) continue;  // Room was made by dropping it; start a new one
+      copyIn((head + used) % TRACE_RING_SIZE, data, n);
+      used += n;
+      newest.length += n;
+      copyIn(last, &newest, sizeof(newest));
+      data += n;
+      length -= n;
+    } else {
+      size_t n = std::min(length, MAX_RECORD - sizeof(RecordHeader));
+      append(type, channel, data, n, nullptr, 0);
+      data += n;
+      length -= n;
+    }
+  }
+}
+
+static void appendEscaped(String& out, const String& text) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  for (size_t i = 0; i < text.length(); i++) {
+    char c = text[i];
+    if (c <= ' ' || c == '%' || c == '&' || c == '=' || c == '+' || c == '#' || (uint8_t)c >= 0x7F) {
+      out += '%';
+      out += HEX_DIGITS[(uint8_t)c >> 4];
+      out += HEX_DIGITS[c & 0x0F];
+    } else {
+      out += c;
+    }
+  }
+}
+
+void request(hal::HttpServer& server) {
+  String uri = server.uri();
+  char separator = '?';
+  for (int i = 0; i < server.args(); i++) {
+    String name = server.argName(i);
+    if (name == "plain") continue;  // The body, kept separately
+    uri += separator;
+    appendEscaped(uri, name);
+    uri += '=';
+    appendEscaped(uri, server.arg(i));
+    separator = '&';
+  }
+  size_t uriLength = std::min((size_t)uri.length(), MAX_URI);
+
+  String body = server.arg("plain");
+  size_t bodyLength = std::min((size_t)body.length(), MAX_RECORD - sizeof(RecordHeader) - 5 - uriLength);
+  uint8_t channel = (uint8_t)server.method();
+  if (bodyLength < body.length()) channel |= BODY_TRUNCATED;
+
+  uint8_t prefix[5 + MAX_URI];
+  uint32_t ip = server.clientIP();
+  memcpy(prefix, &ip, 4);
+  prefix[4] = uriLength;
+  memcpy(prefix + 5, uri.c_str(), uriLength);
+  append(HTTP, channel, prefix, 5 + uriLength, body.c_str(), bodyLength);
+}
+
+void state(uint8_t value) { append(STATE, value, nullptr, 0, nullptr, 0); }
+#endif
+
+void clear() {
+  head = 0;
+  used = 0;
+  lastValid = false;
+  dropped = 0;
+}
+
+size_t bytesUsed() { return used; }
+uint32_t droppedRecords() { return dropped; }
+
+static void fillHeader() {
+  memcpy(store.header.magic, MAGIC, sizeof(MAGIC));
+  store.header.ringSize = TRACE_RING_SIZE;
+  store.header.droppedRecords = dropped;
+  store.header.savedAt = hal::millis();
+}
+
+void write(Writer writer) {
+  fillHeader();
+  writer(reinterpret_cast<const char*>(&store.header), sizeof(store.header));
+  size_t first = std::min(used, (size_t)(TRACE_RING_SIZE - head));
+  writer(reinterpret_cast<const char*>(store.ring + head), first);
+  if (used > first) writer(reinterpret_cast<const char*>(store.ring), used - first);
+}
+
+bool save(const char* path) {
+  // Rotate the oldest record to the front; nothing is allocated
+  std::rotate(store.ring, store.ring + head, store.ring + TRACE_RING_SIZE);
+  last = (last + TRACE_RING_SIZE - head) % TRACE_RING_SIZE;
+  head = 0;
+  fillHeader();
+  return hal::files::write(path, reinterpret_cast<const char*>(&store), sizeof(store.header) + used);
+}
+
+}  // namespace Trace
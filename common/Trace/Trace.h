@@ -0,0 +1,82 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Hal.h>
+
+// Compact binary traffic recorder shared by both firmwares.
+//
+// Link bytes in both directions (recorded by UartLink), HTTP requests
+// (Trace::request(), called from the server's onRequest hook) and state
+// transitions go into one fixed RAM ring as timestamped records; when the
+// ring is full the oldest records are dropped. GET /trace downloads it and
+// save() copies it to flash, which the firmwares only do at the end of each
+// session when built with TRACE_FLUSH=1. The native build replays a trace
+// with --replay (see native/Replay.cpp and bench/trace_replay.py).
+//
+// File: FileHeader, then the records oldest first. Record: RecordHeader,
+// then length payload bytes. All integers little-endian.
+//   UART_RX, UART_TX  channel = RX pin of the link's port; payload = bytes
+//                     (consecutive bytes in the same ms share a record)
+//   HTTP              channel = HTTPMethod, | BODY_TRUNCATED if the body was
+//                     cut to fit MAX_RECORD; payload = client IP (4), URI
+//                     length (1), URI with the query string rebuilt, body
+//   STATE             channel = the firmware's state number; no payload
+//
+// Build with TRACE_ENABLED=0 and the recording calls compile to nothing.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 4096
+#endif
+
+namespace Trace {
+
+enum Type : uint8_t { UART_RX = 1, UART_TX = 2, HTTP = 3, STATE = 4 };
+
+const char MAGIC[4] = {'T', 'R', 'C', '1'};
+const uint8_t BODY_TRUNCATED = 0x80;
+const size_t MAX_URI = 255;
+// Records are kept to half the ring, so one always fits after dropping others
+const size_t MAX_RECORD = TRACE_RING_SIZE / 2;
+
+struct __attribute__((packed)) FileHeader {
+  char magic[4];
+  uint32_t ringSize;
+  uint32_t droppedRecords;  // Overwritten before this copy was taken
+  uint32_t savedAt;         // hal::millis() when it was taken
+};
+
+struct __attribute__((packed)) RecordHeader {
+  uint32_t time;  // hal::millis()
+  uint8_t type;
+  uint8_t channel;
+  uint16_t length;
+};
+
+#if TRACE_ENABLED
+void uart(Type type, uint8_t channel, const uint8_t* data, size_t length);
+void request(hal::HttpServer& server);
+void state(uint8_t value);
+#else
+inline void uart(Type, uint8_t, const uint8_t*, size_t) {}
+inline void request(hal::HttpServer&) {}
+inline void state(uint8_t) {}
+#endif
+
+void clear();
+size_t bytesUsed();
+uint32_t droppedRecords();
+
+// The whole trace as a file (header and records), in pieces
+typedef void (*Writer)(const char* data, size_t length);
+void write(Writer writer);
+
+// Copies the trace to a flash file (see HalFiles.h)
+bool save(const char* path);
+
+}  // namespace Trace
+
+#endif
@@ -0,0 +1,109 @@
+#include "UartLink.h"
+
+const uint32_t UartLink::RATES[] = {19200, 38400, 57600, 115200};
+const size_t UartLink::RATE_COUNT = sizeof(UartLink::RATES) / sizeof(UartLink::RATES[0]);
+
+// 'U' and '*' give alternating bit patterns; the rest catches dropped or
+// shifted bytes. It is longer than the 64-byte SoftwareSerial RX buffer so a
+// rate the receiving loop can't keep up with fails here rather than mid-roster.
+// Must never contain '<', '>' or '|'.
+const char UartLink::TEST_PATTERN[] =
+    "UUUU****0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+    "UUUU****0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+void UartLink::drain() {
+  while (available() > 0) read();
+}
+
+void UartLink::sendFrame(const char* body) {
+  const uint8_t start = START_MARKER;
+  const uint8_t end = END_MARKER;
+  Trace::uart(Trace::UART_TX, port.rxPin(), &start, 1);
+  Trace::uart(Trace::UART_TX, port.rxPin(), (const uint8_t*)body, strlen(body));
+  Trace::uart(Trace::UART_TX, port.rxPin(), &end, 1);
+  port.write(START_MARKER);
+  port.print(body);
+  port.write(END_MARKER);
+  port.flush();
+}
+
+bool UartLink::readFrame(char* buf, size_t cap, unsigned long deadline) {
+  size_t len = 0;
+  bool started = false;
+  while ((long)(deadline - hal::millis()) > 0) {
+    if (available() <= 0) {
+      hal::yield();
+      continue;
+    }
+    char c = read();
+    if (c == START_MARKER) {
+      started = true;
+      len = 0;
+    } else if (c == END_MARKER && started) {
+      buf[len] = '\0';
+      return true;
+    } else if (started) {
+      if (len + 1 >= cap) {
+        started = false;  // Too long for a control frame, skip it
+      } else {
+        buf[len++] = c;
+      }
+    }
+  }
+  return false;
+}
+
+void BroadcastSlice::begin() {
+  state = HEADER;
+  field = 0;
+  remaining = 0;
+  text = "";
+  listed = false;
+  offset = 0;
+  length = 0;
+  received = 0;
+  data = "";
+}
+
+void BroadcastSlice::push(char c) {
+  if (state == PAYLOAD) {
+    if (listed && received >= offset && received < offset + length) data += c;
+    received++;
+  } else if (state != INVALID) {
+    if (c == '|') {
+      endField();
+    } else if (text.length() < MAX_FIELD) {
+      text += c;
+    } else {
+      state = INVALID;
+    }
+  }
+}
+
+void BroadcastSlice::endField() {
+  if (state == HEADER) {
+    if (field == 0) {
+      if (text.length() != 1 || text[0] != UartLink::BROADCAST_CHAR) state = INVALID;
+      field = 1;
+    } else {
+      remaining = text.toInt();
+      state = remaining > 0 ? DIRECTORY : PAYLOAD;
+    }
+  } else {
+    // ADDR:offset:length
+    int first = text.indexOf(':');
+    int second = first < 0 ? -1 : text.indexOf(':', first + 1);
+    if (second < 0) {
+      state = INVALID;
+    } else {
+      if (text.substring(0, first) == address) {
+        listed = true;
+        offset = text.substring(first + 1, second).toInt();
+        length = text.substring(second + 1).toInt();
+        data.reserve(length);
+      }
+      if (--remaining == 0) state = PAYLOAD;
+    }
+  }
+  text = "";
+}
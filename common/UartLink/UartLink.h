@@ -0,0 +1,118 @@
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#include <Hal.h>
+#include <Trace.h>
+
+// Master/slave serial link on top of a hal::SerialPort, which can be a
+// SoftwareSerial port or the ESP8266 hardware UART. The hardware UART is
+// swapped onto GPIO13 (RX) / GPIO15 (TX) so GPIO1/3 stay free; debug output
+// then has to go to Serial1.
+//
+// Link rate negotiation (all frames use the normal <...> markers):
+//   master -> <!B|rate>            propose rate (sent at the current rate)
+//   slave  -> <!A|ADDR|rate>       accept, then switch to rate
+//   master -> <!T|pattern>         test pattern at the new rate
+//   slave  -> <!E|ADDR|pattern>    echo
+//   master -> <!C|rate>            commit
+//   master -> <!R>                 release: idle slaves drop back to base rate
+// A slave that switched but sees no commit within COMMIT_TIMEOUT_MS reverts
+// on its own, so a failed step always ends with both sides at the old rate.
+//
+// Roster dispatch. Every slave listens on the master's one TX line, so the
+// master sends all rosters in a single broadcast frame:
+//   <*|N|ADDR1:offset:length|...|ADDRN:offset:length|payload>
+// Each slave's roster (the fields that would follow ADDR| in a unicast
+// <ADDR|...> frame) is the payload bytes at offset, counted from the first
+// byte after the directory. A slave keeps only its own slice while the frame
+// streams past (BroadcastSlice) and answers <!K|ADDR>. An address that has
+// not acknowledged after ACK_TIMEOUT_MS gets its roster again, unicast.
+
+class UartLink {
+public:
+  static const uint32_t BASE_BAUD = 9600;
+  static const uint32_t RATES[];     // Candidate rates, ascending
+  static const size_t RATE_COUNT;
+  static const char TEST_PATTERN[];
+  static const unsigned long COMMIT_TIMEOUT_MS = 500;
+
+  static const char CONTROL_CHAR = '!';
+  static const char BROADCAST_CHAR = '*';
+  static const unsigned long ACK_TIMEOUT_MS = 1000;
+  static const char START_MARKER = '<';
+  static const char END_MARKER = '>';
+
+  explicit UartLink(hal::SerialPort& port) : port(port) {}
+
+  void begin(uint32_t baud) { port.begin(baud); }
+  void setBaud(uint32_t baud) { port.setBaud(baud); }
+  uint32_t baud() const { return port.baud(); }
+  bool isHardware() const { return port.isHardware(); }
+
+  // Everything read or written is recorded (see Trace.h), by RX pin
+  int available() { return port.available(); }
+  int read() {
+    int c = port.read();
+    if (c >= 0) {
+      uint8_t byte = c;
+      Trace::uart(Trace::UART_RX, port.rxPin(), &byte, 1);
+    }
+    return c;
+  }
+  size_t print(const String& s) {
+    Trace::uart(Trace::UART_TX, port.rxPin(), (const uint8_t*)s.c_str(), s.length());
+    return port.print(s);
+  }
+  size_t println(const String& s) { return print(s) + print("\r\n"); }
+  size_t write(const char* data, size_t length) {
+    Trace::uart(Trace::UART_TX, port.rxPin(), (const uint8_t*)data, length);
+    return port.write((const uint8_t*)data, length);
+  }
+  void flush() { port.flush(); }
+
+  // Discards anything still sitting in the RX buffer
+  void drain();
+
+  // Writes <body>
+  void sendFrame(const char* body);
+
+  // Blocks until a complete frame arrives or hal::millis() passes deadline.
+  // The frame body (without markers) is NUL-terminated in buf.
+  bool readFrame(char* buf, size_t cap, unsigned long deadline);
+
+private:
+  hal::SerialPort& port;
+};
+
+// Reads a broadcast frame body byte by byte, from its BROADCAST_CHAR on,
+// and keeps only one address's slice of the payload.
+class BroadcastSlice {
+public:
+  explicit BroadcastSlice(const char* address) : address(address) { begin(); }
+
+  void begin();
+  void push(char c);
+
+  // The directory listed the address and all of its slice has arrived
+  bool complete() const { return state == PAYLOAD && listed && received >= offset + length; }
+  const String& slice() const { return data; }
+
+private:
+  static const size_t MAX_FIELD = 48;
+  enum State { HEADER, DIRECTORY, PAYLOAD, INVALID };
+
+  const char* address;
+  State state;
+  uint8_t field;       // Header field being read: 0 is the '*', 1 the count
+  uint16_t remaining;  // Directory entries still to come
+  String text;         // Current header or directory field
+  bool listed;
+  size_t offset;
+  size_t length;
+  size_t received;     // Payload bytes seen so far
+  String data;
+
+  void endField();
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "EventHub.h"
+
+EventHub::EventHub(hal::HttpServer& server)
+    : server(server), open(), count(0), nextId(1), lastWrite(0) {}
+
+int EventHub::subscribe() {
+  int stream = server.openEventStream();
+  if (stream < 0) return -1;
+  if (!open[stream]) {  // The HAL may hand back a slot whose client already left
+    open[stream] = true;
+    count++;
+  }
+  // Tell EventSource how long to wait before reconnecting
+  static const char retry[] = "retry: 3000\n\n";
+  write(stream, retry, sizeof(retry) - 1);
+  return stream;
+}
+
+size_t EventHub::format(char* frame, const char* event, const char* data) {
+  int n = snprintf(frame, MAX_EVENT_SIZE, "id: %lu\nevent: %s\ndata: %s\n\n",
+                   (unsigned long)nextId, event, data);
+  if (n <= 0 || (size_t)n >= MAX_EVENT_SIZE) return 0;  // A cut-off event would corrupt the stream
+  nextId++;
+  return n;
+}
+
+void EventHub::write(int stream, const char* frame, size_t length) {
+  if (!server.writeEventStream(stream, frame, length) && open[stream]) {
+    open[stream] = false;
+    count--;
+  }
+}
+
+void EventHub::send(int stream, const char* event, const char* data) {
+  if (stream < 0 || stream >= hal::HttpServer::MAX_EVENT_STREAMS || !open[stream]) return;
+  char frame[MAX_EVENT_SIZE];
+  size_t length = format(frame, event, data);
+  if (length > 0) write(stream, frame, length);
+}
+
+void EventHub::publish(const char* event, const char* data) {
+  if (count == 0) return;
+  char frame[MAX_EVENT_SIZE];
+  size_t length = format(frame, event, data);
+  if (length == 0) return;
+  for (int i = 0; i < hal::HttpServer::MAX_EVENT_STREAMS; i++) {
+    if (open[i]) write(i, frame, length);
+  }
+  lastWrite = hal::millis();
+}
+
+void EventHub::poll() {
+  if (count == 0 || hal::millis() - lastWrite < KEEPALIVE_MS) return;
+  static const char keepalive[] = ":\n\n";
+  for (int i = 0; i < hal::HttpServer::MAX_EVENT_STREAMS; i++) {
+    if (open[i]) write(i, keepalive, sizeof(keepalive) - 1);
+  }
+  lastWrite = hal::millis();
+}
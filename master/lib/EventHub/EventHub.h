@@ -0,0 +1,53 @@
+#ifndef EVENT_HUB_H
+#define EVENT_HUB_H
+
+#include <Hal.h>
+
+// Fan-out of server-sent events to the clients subscribed at GET /events.
+//
+// Instead of every dashboard polling /status, the master publishes a small
+// JSON delta when something changes (state transition, slave reply, upload)
+// and it goes out once to every open stream as
+//
+//   id: <n>
+//   event: <name>
+//   data: <json>
+//
+// Subscribers that can't take a write are dropped rather than stalling the
+// loop. A comment line after KEEPALIVE_MS of silence keeps idle connections
+// open and notices clients that vanished without closing.
+
+class EventHub {
+public:
+  static const uint32_t KEEPALIVE_MS = 15000;
+  static const size_t MAX_EVENT_SIZE = 384;  // Whole frame, including the id/event lines
+
+  explicit EventHub(hal::HttpServer& server);
+
+  // Call from the GET /events handler. Returns the new stream, or -1 when
+  // every slot is taken.
+  int subscribe();
+
+  // To one stream (e.g. the snapshot a new subscriber starts from)
+  void send(int stream, const char* event, const char* data);
+  // To every subscriber
+  void publish(const char* event, const char* data);
+
+  bool hasSubscribers() const { return count > 0; }
+  size_t subscribers() const { return count; }
+
+  // Keepalive; call from loop()
+  void poll();
+
+private:
+  size_t format(char* frame, const char* event, const char* data);
+  void write(int stream, const char* frame, size_t length);
+
+  hal::HttpServer& server;
+  bool open[hal::HttpServer::MAX_EVENT_STREAMS];
+  size_t count;
+  uint32_t nextId;
+  uint32_t lastWrite;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "Metrics.h"
+
+#include <stdarg.h>
+
+namespace Metrics {
+
+static const uint32_t UPLOAD_BOUNDS_MS[] = {50, 100, 250, 500, 1000, 2500, 5000, 10000};
+static const uint32_t SESSION_BOUNDS_MS[] = {30000, 60000, 90000, 120000, 180000, 300000, 900000, 2700000};
+
+Link links[MAX_LINKS];
+uint32_t txBytes = 0;
+uint32_t txFrames = 0;
+uint32_t rosterResends = 0;
+uint32_t sessions = 0;
+uint32_t waitTimeouts = 0;
+uint32_t partialSends = 0;
+uint32_t uploads = 0;
+uint32_t uploadFailures = 0;
+Histogram uploadLatency = {UPLOAD_BOUNDS_MS, 8, {}, 0, 0};
+Histogram sessionDuration = {SESSION_BOUNDS_MS, 8, {}, 0, 0};
+
+static const char* const* names = nullptr;
+static size_t linkCount = 0;
+
+void Histogram::observe(uint32_t ms) {
+  size_t i = 0;
+  while (i < boundCount && ms > bounds[i]) i++;
+  buckets[i]++;
+  count++;
+  sumMs += ms;
+}
+
+void begin(const char* const* linkNames, size_t count) {
+  names = linkNames;
+  linkCount = count < MAX_LINKS ? count : MAX_LINKS;
+}
+
+// Batches formatted lines into one buffer and hands it to the writer when full
+class Output {
+public:
+  explicit Output(Writer writer) : writer(writer), length(0) {}
+  ~Output() { flush(); }
+
+  void printf(const char* format, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n <= 0) return;
+    if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+    if (length + n > sizeof(buffer)) flush();
+    memcpy(buffer + length, line, n);
+    length += n;
+  }
+
+  void flush() {
+    if (length > 0) writer(buffer, length);
+    length = 0;
+  }
+
+private:
+  Writer writer;
+  char buffer[512];
+  size_t length;
+};
+
+static void header(Output& out, const char* name, const char* help, const char* type) {
+  out.printf("# HELP %s %s\n", name, help);
+  out.printf("# TYPE %s %s\n", name, type);
+}
+
+static void counter(Output& out, const char* name, const char* help, uint32_t value) {
+  header(out, name, help, "counter");
+  out.printf("%s %u\n", name, (unsigned)value);
+}
+
+static void gauge(Output& out, const char* name, const char* help, uint32_t value) {
+  header(out, name, help, "gauge");
+  out.printf("%s %u\n", name, (unsigned)value);
+}
+
+static void linkCounter(Output& out, const char* name, const char* help, uint32_t Link::*field) {
+  header(out, name, help, "counter");
+  for (size_t i = 0; i < linkCount; i++) {
+    out.printf("%s{link=\"%s\"} %u\n", name, names[i], (unsigned)(links[i].*field));
+  }
+}
+
+// Prometheus wants seconds; the bounds are whole milliseconds
+static void histogram(Output& out, const char* name, const char* help, const Histogram& h) {
+  header(out, name, help, "histogram");
+  uint32_t cumulative = 0;
+  for (size_t i = 0; i < h.boundCount; i++) {
+    cumulative += h.buckets[i];
+    out.printf("%s_bucket{le=\"%u.%03u\"} %u\n", name, (unsigned)(h.bounds[i] / 1000),
+               (unsigned)(h.bounds[i] % 1000), (unsigned)cumulative);
+  }
+  out.printf("%s_bucket{le=\"+Inf\"} %u\n", name, (unsigned)h.count);
+  out.printf("%s_sum %lu.%03u\n", name, (unsigned long)(h.sumMs / 1000), (unsigned)(h.sumMs % 1000));
+  out.printf("%s_count %u\n", name, (unsigned)h.count);
+}
+
+void write(const Gauges& gauges, Writer writer) {
+  Output out(writer);
+
+  gauge(out, "master_state", "0 HALT, 1 ACTIVE, 2 WAIT", gauges.state);
+  gauge(out, "master_pending_addresses", "Addresses the master is still waiting on", gauges.pendingAddresses);
+  gauge(out, "master_session_arena_bytes", "Session arena in use", gauges.sessionArenaBytes);
+  gauge(out, "master_uptime_seconds", "Seconds since boot", hal::millis() / 1000);
+  gauge(out, "master_heap_used_bytes", "Heap in use since boot", hal::heapUsed());
+
+  linkCounter(out, "master_uart_rx_bytes_total", "Bytes received per link", &Link::rxBytes);
+  linkCounter(out, "master_uart_rx_frames_total", "Reply frames received per link", &Link::rxFrames);
+  linkCounter(out, "master_uart_framing_errors_total", "Frame markers out of place per link", &Link::framingErrors);
+  linkCounter(out, "master_uart_overflow_resets_total", "Frames dropped at the buffer limit per link",
+              &Link::overflowResets);
+  counter(out, "master_uart_tx_bytes_total", "Roster bytes sent on the shared TX line", txBytes);
+  counter(out, "master_uart_tx_frames_total", "Roster frames sent on the shared TX line", txFrames);
+  counter(out, "master_roster_resends_total", "Rosters sent again unicast after no ACK", rosterResends);
+
+  counter(out, "master_sessions_total", "Sessions started by POST /start or the timetable", sessions);
+  counter(out, "master_wait_timeouts_total", "Sessions that hit the WAIT timeout", waitTimeouts);
+  counter(out, "master_partial_uploads_total", "Results uploaded after a WAIT timeout", partialSends);
+  counter(out, "master_uploads_total", "Result POSTs attempted", uploads);
+  counter(out, "master_upload_failures_total", "Result POSTs that failed or were not 2xx", uploadFailures);
+  histogram(out, "master_upload_duration_seconds", "Result POST latency", uploadLatency);
+  histogram(out, "master_session_duration_seconds", "POST /start to HALT", sessionDuration);
+}
+
+}  // namespace Metrics
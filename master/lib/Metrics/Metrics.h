@@ -0,0 +1,65 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Hal.h>
+
+// Always-on operational counters for the master, served at GET /metrics in
+// Prometheus text format.
+//
+// Everything is a fixed-size static: one slot per UART link (indexed like
+// the master's links) plus a handful of session counters and two fixed-bucket
+// histograms. Only the main loop writes them, so plain increments need no
+// locking. write() formats through a small stack buffer handed to a callback
+// piece by piece, so serving /metrics never allocates.
+
+namespace Metrics {
+
+const size_t MAX_LINKS = 2;
+
+struct Link {
+  uint32_t rxBytes;
+  uint32_t rxFrames;        // Complete <...> replies
+  uint32_t framingErrors;   // START inside a frame, or END outside one
+  uint32_t overflowResets;  // Frames dropped at the receive buffer limit
+};
+
+// Cumulative histogram over fixed upper bounds (milliseconds)
+struct Histogram {
+  static const size_t MAX_BOUNDS = 8;
+
+  const uint32_t* bounds;
+  uint8_t boundCount;
+  uint32_t buckets[MAX_BOUNDS + 1];  // Last one is +Inf
+  uint32_t count;
+  uint64_t sumMs;
+
+  void observe(uint32_t ms);
+};
+
+// Point-in-time values owned by the firmware, sampled when /metrics is served
+struct Gauges {
+  uint8_t state;  // 0 HALT, 1 ACTIVE, 2 WAIT
+  uint8_t pendingAddresses;
+  uint16_t sessionArenaBytes;
+};
+
+extern Link links[MAX_LINKS];
+extern uint32_t txBytes;   // Rosters on the shared TX line
+extern uint32_t txFrames;
+extern uint32_t rosterResends;  // Unicast rosters to slaves that missed the broadcast
+extern uint32_t sessions;
+extern uint32_t waitTimeouts;
+extern uint32_t partialSends;  // Uploads made after a WAIT timeout
+extern uint32_t uploads;
+extern uint32_t uploadFailures;
+extern Histogram uploadLatency;
+extern Histogram sessionDuration;
+
+void begin(const char* const* linkNames, size_t linkCount);
+
+typedef void (*Writer)(const char* data, size_t length);
+void write(const Gauges& gauges, Writer writer);
+
+}  // namespace Metrics
+
+#endif
@@ -0,0 +1,76 @@
+#include "RosterWriter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace RosterWriter {
+
+static size_t tokenBytes = 0;
+
+static void countTokens(const char*, size_t length) { tokenBytes += length; }
+
+bool writeList(SessionTable& table, const SessionTable::UsnList& list, char separator, bool frontCode,
+               Writer writer) {
+  size_t mark = table.mark();
+  RosterCodec::UsnRef* refs = nullptr;
+  bool frontCoded = false;
+  if (frontCode && list.count > 0) {
+    refs = static_cast<RosterCodec::UsnRef*>(table.allocate(list.count * sizeof(RosterCodec::UsnRef)));
+  }
+  if (refs != nullptr) {
+    SessionTable::Iterator it(table, list);
+    const char* usn;
+    size_t usnLen;
+    for (size_t i = 0; it.next(usn, usnLen); i++) refs[i] = {usn, usnLen};
+    // Each record carries a length byte and terminator on top of the USN
+    size_t plainLength = list.bytes - list.count;
+    tokenBytes = 0;
+    frontCoded = RosterCodec::encode(refs, list.count, separator, countTokens) &&
+                 tokenBytes + sizeof(RosterCodec::FRONT_CODED_TAG) + 1 < plainLength;
+  }
+
+  if (frontCoded) {
+    writer(&separator, 1);
+    writer(RosterCodec::FRONT_CODED_TAG, sizeof(RosterCodec::FRONT_CODED_TAG) - 1);
+    writer(&separator, 1);
+    RosterCodec::encode(refs, list.count, separator, writer);
+  } else {
+    SessionTable::Iterator it(table, list);
+    const char* usn;
+    size_t usnLen;
+    while (it.next(usn, usnLen)) {
+      writer(&separator, 1);
+      writer(usn, usnLen);
+    }
+  }
+  table.rewind(mark);
+  return frontCoded;
+}
+
+bool writeAddress(SessionTable& table, const char* address, char separator, bool frontCode, Writer writer,
+                  size_t& plainLength) {
+  bool frontCoded = false;
+  for (int named = 0; named < 2; named++) {
+    for (size_t i = 0; i < table.size(); i++) {
+      const SessionTable::Entry& entry = table[i];
+      if (strcmp(entry.address, address) != 0 || (entry.section[0] != '\0') != (named == 1)) continue;
+      if (named) {
+        writer(&separator, 1);
+        writer(RosterCodec::SECTION_TAG, sizeof(RosterCodec::SECTION_TAG) - 1);
+        writer(entry.section, strlen(entry.section));
+        plainLength += strlen(entry.section) + sizeof(RosterCodec::SECTION_TAG);
+        if (entry.window) {
+          char window[8];
+          int n = snprintf(window, sizeof(window), "%c%u", RosterCodec::WINDOW_CHAR, (unsigned)entry.window);
+          writer(window, n);
+          plainLength += n;
+        }
+      }
+      plainLength += entry.task.bytes - entry.task.count;
+      if (writeList(table, entry.task, separator, frontCode, writer)) frontCoded = true;
+    }
+  }
+  return frontCoded;
+}
+
+}  // namespace RosterWriter
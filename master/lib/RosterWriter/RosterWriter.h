@@ -0,0 +1,35 @@
+#ifndef ROSTER_WRITER_H
+#define ROSTER_WRITER_H
+
+#include <RosterCodec.h>
+#include <SessionTable.h>
+
+// Writes session rosters as roster frame fields (see RosterCodec.h) without
+// touching the heap.
+//
+// A list goes front-coded when that comes out shorter than the plain USNs:
+// the tokens are counted first, then written. Only their sort references
+// take arena scratch (SessionTable::sessionBytes() budgets for it), handed
+// back before the write returns, so sending or resending a roster never
+// eats into the room kept for replies. Fields are handed to a callback
+// piece by piece: the link when sending, or a counter when a broadcast
+// measures its slices before writing the directory.
+
+namespace RosterWriter {
+
+typedef RosterCodec::Writer Writer;
+
+// Writes one list, each field after separator. True if front-coded.
+bool writeList(SessionTable& table, const SessionTable::UsnList& list, char separator, bool frontCode,
+               Writer writer);
+
+// Writes what follows ADDRESS| in a roster frame: the unnamed section's
+// roster first (it has no tag), then each named section's tag and roster.
+// Adds the plain encoding's length to plainLength; true if any roster was
+// front-coded.
+bool writeAddress(SessionTable& table, const char* address, char separator, bool frontCode, Writer writer,
+                  size_t& plainLength);
+
+}  // namespace RosterWriter
+
+#endif
@@ -0,0 +1,344 @@
+#include "SessionLog.h"
+
+#include <Checkpoint.h>
+
+#include <algorithm>
+#include <stdio.h>
+
+static const char RECORDS_FILE[] = "/history";
+static const char ROSTERS_FILE[] = "/history-rosters";
+static const char INDEX_FILE[] = "/history-index";
+
+// Tells which roster USNs are in the reply. Replies list the present USNs
+// in roster order, so the two lists are merged; anything out of order
+// falls back to a search of the whole reply.
+class Presence {
+public:
+  Presence(const SessionTable& table, const SessionTable::Entry& entry)
+      : table(table), entry(entry), reply(table, entry.response), next(nullptr), nextLength(0), more(false) {
+    if (entry.responded) more = reply.next(next, nextLength);
+  }
+
+  bool check(const char* usn, size_t length) {
+    if (more && nextLength == length && memcmp(next, usn, length) == 0) {
+      more = reply.next(next, nextLength);
+      return true;
+    }
+    if (!entry.responded) return false;
+    SessionTable::Iterator search(table, entry.response);
+    const char* candidate;
+    size_t candidateLength;
+    while (search.next(candidate, candidateLength)) {
+      if (candidateLength == length && memcmp(candidate, usn, length) == 0) return true;
+    }
+    return false;
+  }
+
+private:
+  const SessionTable& table;
+  const SessionTable::Entry& entry;
+  SessionTable::Iterator reply;
+  const char* next;
+  size_t nextLength;
+  bool more;
+};
+
+// Appends to a file through a small buffer
+class Appender {
+public:
+  explicit Appender(const char* path) : path(path), used(0), written(0), ok(true) {}
+
+  void put(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (length > 0) {
+      if (used == sizeof(buffer)) flush();
+      size_t n = std::min(length, sizeof(buffer) - used);
+      memcpy(buffer + used, bytes, n);
+      used += n;
+      bytes += n;
+      length -= n;
+    }
+  }
+
+  bool flush() {
+    if (used > 0) {
+      ok = ok && hal::files::append(path, reinterpret_cast<const char*>(buffer), used);
+      written += used;
+      used = 0;
+    }
+    return ok;
+  }
+
+  size_t bytes() const { return written + used; }
+
+private:
+  const char* path;
+  uint8_t buffer[128];
+  size_t used;
+  size_t written;
+  bool ok;
+};
+
+// ==================== WRITING ====================
+// LittleFS commits each append whole, so a reset leaves at most a record
+// or roster that nothing points at yet
+
+void SessionLog::begin() {
+  count = 0;
+  lastTime = 0;
+  recordBytes = 0;
+  rosterBytes = 0;
+  cached = 0;
+  cacheNext = 0;
+
+  hal::files::Reader file;
+  if (file.open(INDEX_FILE)) {
+    count = std::min(file.size() / sizeof(IndexEntry), (size_t)MAX_RECORDS);
+    IndexEntry last;
+    if (count > 0 && file.read((count - 1) * sizeof(IndexEntry), &last, sizeof(last)) == sizeof(last)) {
+      lastTime = last.time;
+    }
+  }
+  if (file.open(RECORDS_FILE)) recordBytes = file.size();
+  if (file.open(ROSTERS_FILE)) {
+    rosterBytes = file.size();
+    RosterHeader header;
+    for (size_t at = 0; file.read(at, &header, sizeof(header)) == sizeof(header);
+         at += sizeof(header) + header.bytes) {
+      remember(header.hash, at);
+    }
+  }
+}
+
+bool SessionLog::append(const SessionTable& table, const SessionTable::Entry& entry, uint32_t time,
+                        const char* period) {
+  if (count >= MAX_RECORDS) return false;
+  uint32_t roster;
+  if (!storeRoster(table.data(entry.task), entry.task, roster)) {
+    begin();  // Back in step with what reached flash
+    return false;
+  }
+
+  const char* usn;
+  size_t length;
+  Record record;
+  record.time = time;
+  record.roster = roster;
+  record.usns = entry.task.count;
+  record.present = 0;
+  {
+    Presence presence(table, entry);
+    SessionTable::Iterator task(table, entry.task);
+    while (task.next(usn, length)) {
+      if (presence.check(usn, length)) record.present++;
+    }
+  }
+  record.flags = entry.responded ? REPLIED : 0;
+  record.addressLength = std::min(strlen(entry.address), (size_t)255);
+  record.sectionLength = std::min(strlen(entry.section), (size_t)255);
+  record.periodLength = std::min(strlen(period), (size_t)255);
+
+  Appender out(RECORDS_FILE);
+  out.put(&record, sizeof(record));
+  out.put(entry.address, record.addressLength);
+  out.put(entry.section, record.sectionLength);
+  out.put(period, record.periodLength);
+  Presence presence(table, entry);
+  SessionTable::Iterator task(table, entry.task);
+  uint8_t bits = 0;
+  size_t bit = 0;
+  while (task.next(usn, length)) {
+    if (presence.check(usn, length)) bits |= 1 << (bit % 8);
+    if (++bit % 8 == 0) {
+      out.put(&bits, 1);
+      bits = 0;
+    }
+  }
+  if (bit % 8) out.put(&bits, 1);
+
+  IndexEntry index = {std::max(time, lastTime), (uint32_t)recordBytes,
+                      Checkpoint::hash(entry.address, strlen(entry.address))};
+  if (!out.flush() || !hal::files::append(INDEX_FILE, reinterpret_cast<const char*>(&index), sizeof(index))) {
+    begin();
+    return false;
+  }
+  recordBytes += out.bytes();
+  lastTime = index.time;
+  count++;
+  return true;
+}
+
+bool SessionLog::storeRoster(const uint8_t* data, const SessionTable::UsnList& list, uint32_t& offset) {
+  uint32_t hash = Checkpoint::hash(data, list.bytes);
+  for (size_t i = 0; i < cached; i++) {
+    if (cache[i].hash == hash && sameRoster(cache[i].offset, data, list)) {
+      offset = cache[i].offset;
+      return true;
+    }
+  }
+  RosterHeader header = {hash, list.count, list.bytes};
+  Appender out(ROSTERS_FILE);
+  out.put(&header, sizeof(header));
+  out.put(data, list.bytes);
+  if (!out.flush()) return false;
+  offset = rosterBytes;
+  rosterBytes += out.bytes();
+  remember(hash, offset);
+  return true;
+}
+
+bool SessionLog::sameRoster(uint32_t offset, const uint8_t* data, const SessionTable::UsnList& list) {
+  hal::files::Reader file;
+  RosterHeader header;
+  if (!file.open(ROSTERS_FILE) || file.read(offset, &header, sizeof(header)) != sizeof(header) ||
+      header.usns != list.count || header.bytes != list.bytes) {
+    return false;
+  }
+  uint8_t buffer[64];
+  for (size_t at = 0; at < list.bytes; at += sizeof(buffer)) {
+    size_t n = std::min(sizeof(buffer), (size_t)list.bytes - at);
+    if (file.read(offset + sizeof(header) + at, buffer, n) != n || memcmp(buffer, data + at, n) != 0) return false;
+  }
+  return true;
+}
+
+void SessionLog::remember(uint32_t hash, uint32_t offset) {
+  cache[cacheNext] = {hash, offset};
+  cacheNext = (cacheNext + 1) % ROSTER_CACHE;
+  if (cached < ROSTER_CACHE) cached++;
+}
+
+bool SessionLog::clear() {
+  bool ok = true;
+  for (const char* path : {RECORDS_FILE, ROSTERS_FILE, INDEX_FILE}) {
+    if (hal::files::exists(path) && !hal::files::remove(path)) ok = false;
+  }
+  begin();
+  return ok;
+}
+
+// ==================== QUERIES ====================
+
+void SessionLog::Cursor::Stream::start(hal::files::Reader& reader, size_t at) {
+  file = &reader;
+  offset = at;
+  position = 0;
+  filled = 0;
+}
+
+bool SessionLog::Cursor::Stream::read(void* out, size_t length) {
+  uint8_t* bytes = static_cast<uint8_t*>(out);
+  while (length > 0) {
+    if (position == filled) {
+      offset += filled;
+      position = 0;
+      filled = file->read(offset, buffer, sizeof(buffer));
+      if (filled == 0) return false;
+    }
+    size_t n = std::min(length, filled - position);
+    memcpy(bytes, buffer + position, n);
+    bytes += n;
+    position += n;
+    length -= n;
+  }
+  return true;
+}
+
+bool SessionLog::Cursor::begin(const SessionLog& log, const char* address, uint32_t since) {
+  end();
+  snprintf(this->address, sizeof(this->address), "%s", address);
+  addressHash = Checkpoint::hash(address, strlen(address));
+  total = 0;
+  entry = 0;
+  chunkStart = 0;
+  chunkCount = 0;
+  remaining = 0;
+  if (log.count == 0) return true;
+  if (!index.open(INDEX_FILE) || !records.open(RECORDS_FILE) || !rosters.open(ROSTERS_FILE)) {
+    end();
+    return false;
+  }
+  total = std::min(log.count, index.size() / sizeof(IndexEntry));
+
+  // First entry at or after since
+  size_t low = 0;
+  size_t high = total;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    IndexEntry probe;
+    if (index.read(middle * sizeof(IndexEntry), &probe, sizeof(probe)) != sizeof(probe)) return false;
+    if (probe.time < since) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  entry = low;
+  return true;
+}
+
+bool SessionLog::Cursor::loadChunk() {
+  chunkStart = entry;
+  size_t n = std::min((size_t)CHUNK, total - entry);
+  chunkCount = index.read(entry * sizeof(IndexEntry), chunk, n * sizeof(IndexEntry)) / sizeof(IndexEntry);
+  return chunkCount > 0;
+}
+
+bool SessionLog::Cursor::next(Session& session) {
+  remaining = 0;
+  while (entry < total) {
+    if (entry >= chunkStart + chunkCount && !loadChunk()) break;
+    const IndexEntry& at = chunk[entry - chunkStart];
+    entry++;
+    if (address[0] != '\0' && at.addressHash != addressHash) continue;
+
+    Record header;
+    record.start(records, at.offset);
+    if (!record.read(&header, sizeof(header))) break;
+    char* names[3] = {session.address, session.section, session.period};
+    uint8_t lengths[3] = {header.addressLength, header.sectionLength, header.periodLength};
+    bool ok = true;
+    for (int i = 0; i < 3 && ok; i++) {
+      ok = record.read(usn, lengths[i]);
+      size_t kept = std::min((size_t)lengths[i], (size_t)MAX_NAME);
+      memcpy(names[i], usn, kept);
+      names[i][kept] = '\0';
+    }
+    if (!ok) break;
+    if (address[0] != '\0' && strcmp(session.address, address) != 0) continue;  // Hash collision
+
+    session.time = header.time;
+    session.usns = header.usns;
+    session.present = header.present;
+    session.replied = header.flags & REPLIED;
+    roster.start(rosters, header.roster + sizeof(RosterHeader));
+    remaining = header.usns;
+    bit = 0;
+    return true;
+  }
+  entry = total;
+  return false;
+}
+
+bool SessionLog::Cursor::nextUsn(const char*& usnOut, size_t& length, bool& present) {
+  if (remaining == 0) return false;
+  uint8_t usnLength;
+  if (!roster.read(&usnLength, 1) || !roster.read(usn, usnLength + 1) ||
+      (bit % 8 == 0 && !record.read(&bits, 1))) {
+    remaining = 0;
+    return false;
+  }
+  usn[usnLength] = '\0';
+  present = bits & (1 << (bit % 8));
+  bit++;
+  remaining--;
+  usnOut = usn;
+  length = usnLength;
+  return true;
+}
+
+void SessionLog::Cursor::end() {
+  index.close();
+  records.close();
+  rosters.close();
+}
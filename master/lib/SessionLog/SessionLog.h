@@ -0,0 +1,143 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <Hal.h>
+#include <SessionTable.h>
+
+// History of finished sessions in flash (see HalFiles.h), so results can be
+// fetched again with GET /results long after the session's upload.
+//
+// Each session entry (address and section) is appended as a record: when
+// the session started, the timetable period it ran for and a presence
+// bitmap against its roster. Rosters repeat from week to week, so each
+// distinct one is stored once and records point at it. Three append-only
+// files:
+//
+//   /history          Record, address, section and period names, then the
+//                     bitmap (bit i = roster USN i, LSB first)
+//   /history-rosters  RosterHeader, then the USNs as SessionTable packs them
+//                     ([len][chars]['\0'])
+//   /history-index    an IndexEntry per record
+//
+// Index times never go backwards (a clock set back, or not set at all,
+// takes the previous time), so a query binary-searches the index for its
+// start and then reads it forward a chunk at a time, opening only the
+// records whose address hash matches. A query's memory is the Cursor's
+// fixed buffers, however long the history.
+
+class SessionLog {
+public:
+  static const size_t MAX_RECORDS = 4096;  // A semester of periods in every room, several times over
+  static const size_t MAX_NAME = 31;       // Longer names are cut in query results
+  static const size_t ROSTER_CACHE = 16;   // Rosters recognised without reading flash
+  static const uint8_t REPLIED = 0x01;     // Record flag: the slave sent its reply
+
+  struct __attribute__((packed)) Record {
+    uint32_t time;    // Session start, local seconds since 1970 (0 = clock not set)
+    uint32_t roster;  // RosterHeader offset in /history-rosters
+    uint16_t usns;    // Roster size, bits in the bitmap
+    uint16_t present;
+    uint8_t flags;
+    uint8_t addressLength;
+    uint8_t sectionLength;
+    uint8_t periodLength;
+  };
+
+  struct __attribute__((packed)) RosterHeader {
+    uint32_t hash;  // Of the packed USNs
+    uint16_t usns;
+    uint16_t bytes;
+  };
+
+  struct __attribute__((packed)) IndexEntry {
+    uint32_t time;  // Record time, clamped so the index is sorted
+    uint32_t offset;
+    uint32_t addressHash;
+  };
+
+  struct Session {
+    uint32_t time;
+    uint16_t usns;
+    uint16_t present;
+    bool replied;
+    char address[MAX_NAME + 1];
+    char section[MAX_NAME + 1];
+    char period[MAX_NAME + 1];
+  };
+
+  // Walks the sessions of one address ("" for all) from a time on. next()
+  // moves to the following session, nextUsn() through its roster.
+  class Cursor {
+  public:
+    bool begin(const SessionLog& log, const char* address, uint32_t since);
+    bool next(Session& session);
+    bool nextUsn(const char*& usn, size_t& length, bool& present);
+    void end();
+
+  private:
+    static const size_t CHUNK = 32;  // Index entries read at once
+
+    // Sequential reads through a small buffer
+    struct Stream {
+      hal::files::Reader* file;
+      size_t offset;
+      size_t position;
+      size_t filled;
+      uint8_t buffer[64];
+      void start(hal::files::Reader& reader, size_t at);
+      bool read(void* out, size_t length);
+    };
+
+    bool loadChunk();
+
+    hal::files::Reader index, records, rosters;
+    char address[MAX_NAME + 1];
+    uint32_t addressHash;
+    size_t total;  // Index entries when the query began
+    size_t entry;  // Next index entry
+    IndexEntry chunk[CHUNK];
+    size_t chunkStart;
+    size_t chunkCount;
+    Stream record;  // Through the name fields, then the bitmap
+    Stream roster;
+    uint16_t remaining;  // USNs left in the current session
+    uint16_t bit;
+    uint8_t bits;
+    char usn[SessionTable::MAX_USN_LEN + 2];
+  };
+
+  SessionLog() : count(0), lastTime(0), recordBytes(0), rosterBytes(0), cached(0), cacheNext(0) {}
+
+  // Picks up the files already in flash
+  void begin();
+
+  // Appends one entry of a finished session. False when the history is full
+  // or the write failed.
+  bool append(const SessionTable& table, const SessionTable::Entry& entry, uint32_t time, const char* period);
+
+  // Removes the whole history
+  bool clear();
+
+  size_t size() const { return count; }
+  size_t bytesUsed() const { return recordBytes + rosterBytes + count * sizeof(IndexEntry); }
+
+private:
+  struct CachedRoster {
+    uint32_t hash;
+    uint32_t offset;
+  };
+
+  bool storeRoster(const uint8_t* data, const SessionTable::UsnList& list, uint32_t& offset);
+  bool sameRoster(uint32_t offset, const uint8_t* data, const SessionTable::UsnList& list);
+  void remember(uint32_t hash, uint32_t offset);
+
+  size_t count;
+  uint32_t lastTime;
+  size_t recordBytes;
+  size_t rosterBytes;
+  CachedRoster cache[ROSTER_CACHE];
+  size_t cached;
+  size_t cacheNext;
+};
+
+#endif
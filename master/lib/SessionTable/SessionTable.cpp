@@ -0,0 +1,126 @@
+#include "SessionTable.h"
+
+#include <string.h>
+
+void SessionTable::reset() {
+  count = 0;
+  top = 0;
+  openList = nullptr;
+}
+
+int SessionTable::addAddress(const char* address, size_t len, const char* section, size_t sectionLen) {
+  size_t bytes = len + 1 + (sectionLen ? sectionLen + 1 : 0);
+  if (count >= MAX_ADDRESSES || top + bytes > ARENA_SIZE) return -1;
+
+  char* copy = reinterpret_cast<char*>(arena + top);
+  memcpy(copy, address, len);
+  copy[len] = '\0';
+  const char* sectionCopy = "";
+  if (sectionLen) {
+    char* target = copy + len + 1;
+    memcpy(target, section, sectionLen);
+    target[sectionLen] = '\0';
+    sectionCopy = target;
+  }
+  top += bytes;
+  if (top > peak) peak = top;
+
+  Entry& entry = entries[count];
+  entry.address = copy;
+  entry.section = sectionCopy;
+  entry.window = 0;
+  entry.task = {0, 0, 0};
+  entry.response = {0, 0, 0};
+  entry.pending = false;
+  entry.responded = false;
+  entry.acked = false;
+  openList = nullptr;
+  return count++;
+}
+
+int SessionTable::find(const char* address, size_t len) const {
+  for (size_t i = 0; i < count; i++) {
+    if (strncmp(entries[i].address, address, len) == 0 && entries[i].address[len] == '\0') {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int SessionTable::find(const char* address) const {
+  return find(address, strlen(address));
+}
+
+int SessionTable::find(const char* address, size_t len, const char* section, size_t sectionLen) const {
+  for (size_t i = 0; i < count; i++) {
+    const Entry& entry = entries[i];
+    if (strncmp(entry.address, address, len) == 0 && entry.address[len] == '\0' &&
+        strncmp(entry.section, section, sectionLen) == 0 && entry.section[sectionLen] == '\0') {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool SessionTable::beginList(UsnList& list) {
+  list.offset = top;
+  list.bytes = 0;
+  list.count = 0;
+  openList = &list;
+  return true;
+}
+
+bool SessionTable::appendUSN(UsnList& list, const char* usn, size_t len) {
+  if (openList != &list || len > MAX_USN_LEN || top + len + 2 > ARENA_SIZE) return false;
+
+  arena[top] = static_cast<uint8_t>(len);
+  memcpy(arena + top + 1, usn, len);
+  arena[top + 1 + len] = '\0';
+  top += len + 2;
+  if (top > peak) peak = top;
+
+  list.bytes += len + 2;
+  list.count++;
+  return true;
+}
+
+void* SessionTable::allocate(size_t bytes) {
+  size_t aligned = (top + 3) & ~static_cast<size_t>(3);
+  if (aligned + bytes > ARENA_SIZE) return nullptr;
+  top = aligned + bytes;
+  if (top > peak) peak = top;
+  openList = nullptr;
+  return arena + aligned;
+}
+
+void SessionTable::rewind(size_t m) {
+  if (m >= top) return;
+  top = m;
+  openList = nullptr;
+}
+
+size_t SessionTable::sessionBytes(size_t scratchPerUsn) const {
+  size_t usnBytes = 0;
+  size_t largest = 0;
+  for (size_t i = 0; i < count; i++) {
+    usnBytes += entries[i].task.bytes;
+    if (entries[i].task.count > largest) largest = entries[i].task.count;
+  }
+  return sessionBytes(top - usnBytes, usnBytes, largest, scratchPerUsn);
+}
+
+size_t SessionTable::pendingCount() const {
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].pending) n++;
+  }
+  return n;
+}
+
+size_t SessionTable::respondedCount() const {
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].responded) n++;
+  }
+  return n;
+}
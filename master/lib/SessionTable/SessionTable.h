@@ -0,0 +1,114 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-session task/response storage for the master.
+//
+// Everything lives in one static bump arena: a flat table of addresses and,
+// for each address, a packed list of USN records ([len][chars]['\0']) for the
+// task roster and one for the slave's reply. Nothing is freed individually;
+// reset() rewinds the arena in O(1) when the session returns to HALT, so a
+// day of sessions never touches (or fragments) the heap. Scratch space on top
+// can be handed back early with mark() and rewind(). An address running
+// several sections has an entry per section.
+
+class SessionTable {
+public:
+  static const size_t ARENA_SIZE = 8192;
+  static const size_t MAX_ADDRESSES = 16;
+  static const size_t MAX_USN_LEN = 255;
+
+  struct UsnList {
+    uint16_t offset;  // Arena offset of the first record
+    uint16_t bytes;   // Total size of all records
+    uint16_t count;
+  };
+
+  struct Entry {
+    const char* address;
+    const char* section;  // "" unless the task names one (see RosterCodec.h)
+    uint16_t window;      // Seconds the section stays ACTIVE, 0 for the slave's own
+    UsnList task;
+    UsnList response;
+    bool pending;    // Waiting for this address to reply
+    bool acked;      // The slave confirmed it has the roster
+    bool responded;  // response holds the slave's reply
+  };
+
+  // Walks the records of a UsnList
+  class Iterator {
+  public:
+    Iterator(const SessionTable& table, const UsnList& list)
+        : cursor(table.arena + list.offset), remaining(list.count) {}
+
+    bool next(const char*& usn, size_t& len) {
+      if (remaining == 0) return false;
+      len = cursor[0];
+      usn = reinterpret_cast<const char*>(cursor + 1);
+      cursor += len + 2;
+      remaining--;
+      return true;
+    }
+
+  private:
+    const uint8_t* cursor;
+    uint16_t remaining;
+  };
+
+  SessionTable() : peak(0) { reset(); }
+
+  // Most arena a session can take at once: nameBytes of addresses and
+  // sections (each with its terminator), usnBytes of task records, replies
+  // repeating every task record, and scratch of scratchPerUsn bytes for each
+  // USN of the largest list while a roster is encoded
+  static size_t sessionBytes(size_t nameBytes, size_t usnBytes, size_t largestList, size_t scratchPerUsn) {
+    return nameBytes + 2 * usnBytes + largestList * scratchPerUsn + 3;  // 3 for allocate()'s alignment
+  }
+  // The same for the session as loaded so far
+  size_t sessionBytes(size_t scratchPerUsn) const;
+
+  void reset();
+
+  // Adds an address (or a section of one) with an empty task list. Returns
+  // its index, or -1 if the address table or arena is full.
+  int addAddress(const char* address, size_t len, const char* section = "", size_t sectionLen = 0);
+  // First entry for the address, whatever its section
+  int find(const char* address, size_t len) const;
+  int find(const char* address) const;
+  int find(const char* address, size_t len, const char* section, size_t sectionLen) const;
+
+  // USNs can only be appended to the list that was opened last, so each
+  // list stays contiguous in the arena.
+  bool beginList(UsnList& list);
+  bool appendUSN(UsnList& list, const char* usn, size_t len);
+
+  // The packed records of a list, list.bytes long
+  const uint8_t* data(const UsnList& list) const { return arena + list.offset; }
+
+  // Raw, suitably aligned scratch space from the same arena (released by reset()).
+  void* allocate(size_t bytes);
+  // Releases everything allocated or appended since mark() returned m
+  size_t mark() const { return top; }
+  void rewind(size_t m);
+
+  size_t size() const { return count; }
+  Entry& operator[](size_t i) { return entries[i]; }
+  const Entry& operator[](size_t i) const { return entries[i]; }
+
+  size_t pendingCount() const;
+  size_t respondedCount() const;
+  size_t bytesUsed() const { return top; }
+  size_t highWater() const { return peak; }
+
+private:
+  alignas(4) uint8_t arena[ARENA_SIZE];
+  Entry entries[MAX_ADDRESSES];
+  size_t count;
+  size_t top;
+  size_t peak;
+  const UsnList* openList;
+};
+
+#endif
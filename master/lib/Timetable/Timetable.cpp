@@ -0,0 +1,135 @@
+#include "Timetable.h"
+
+#include <stdlib.h>
+
+static const char PERIODS_FILE[] = "/timetable";  // "<days> <start> <roster>" per line
+static const char STATE_FILE[] = "/timetable-done";
+static const uint32_t MINUTES_PER_DAY = 24 * 60;
+static const uint32_t REBASE_MS = 24 * 60 * 60 * 1000UL;  // Well inside millis() wrapping
+
+void Timetable::begin() {
+  String text;
+  count = 0;
+  if (hal::files::read(PERIODS_FILE, text)) {
+    const char* line = text.c_str();
+    while (*line && count < MAX_PERIODS) {
+      Period& period = periods[count];
+      char* end;
+      period.days = strtoul(line, &end, 10);
+      period.start = strtoul(end, &end, 10);
+      while (*end == ' ') end++;
+      size_t length = strcspn(end, "\n");
+      if (length > 0 && length <= MAX_NAME) {
+        memcpy(period.roster, end, length);
+        period.roster[length] = '\0';
+        if (validName(period.roster) && period.start < MINUTES_PER_DAY) count++;
+      }
+      line = end + length;
+      if (*line == '\n') line++;
+    }
+  }
+  if (hal::files::read(STATE_FILE, text)) lastDone = strtoul(text.c_str(), nullptr, 10);
+  plan();
+}
+
+void Timetable::setClock(uint32_t seconds) {
+  clockBase = (uint64_t)seconds * 1000;
+  clockMillis = hal::millis();
+  clockValid = true;
+  plan();
+}
+
+uint64_t Timetable::now() const {
+  return clockBase + (uint32_t)(hal::millis() - clockMillis);
+}
+
+bool Timetable::setPeriods(const Period* newPeriods, size_t newCount) {
+  if (newCount > MAX_PERIODS) return false;
+  String text;
+  text.reserve(newCount * 28);
+  for (size_t i = 0; i < newCount; i++) {
+    const Period& period = newPeriods[i];
+    if (!validName(period.roster) || period.start >= MINUTES_PER_DAY) return false;
+    char line[40];
+    snprintf(line, sizeof(line), "%u %u %s\n", (unsigned)period.days, (unsigned)period.start, period.roster);
+    text += line;
+  }
+  if (!hal::files::write(PERIODS_FILE, text.c_str(), text.length())) return false;
+  memcpy(periods, newPeriods, newCount * sizeof(Period));
+  count = newCount;
+  plan();
+  return true;
+}
+
+int Timetable::due(uint32_t ms) {
+  if (clockValid && ms - clockMillis > REBASE_MS) {
+    clockBase = now();
+    clockMillis = ms;
+  }
+  if (nextIndex < 0 || (int32_t)(ms - dueMillis) < 0) return -1;
+  if (ms - dueMillis > LATE_LIMIT_MS) {
+    missed++;
+    lastDone = nextMinute;
+    saveState();
+    plan();
+    return -1;
+  }
+  return nextIndex;
+}
+
+void Timetable::dispatched(uint32_t ms) {
+  if (nextIndex < 0) return;
+  lastDispatch.minute = nextMinute;
+  lastDispatch.lateMs = ms - dueMillis;
+  strcpy(lastDispatch.roster, periods[nextIndex].roster);
+  lastDone = nextMinute;
+  saveState();
+  plan();
+}
+
+// Earliest occurrence after lastDone that is not yet past the late limit.
+// Looking eight days ahead always finds one if any period has a weekday.
+void Timetable::plan() {
+  nextIndex = -1;
+  if (!clockValid || count == 0) return;
+
+  uint64_t nowMs = now();
+  uint32_t from = nowMs > LATE_LIMIT_MS ? (nowMs - LATE_LIMIT_MS) / 60000 + 1 : 0;
+  if (from <= lastDone) from = lastDone + 1;
+
+  uint32_t firstDay = from / MINUTES_PER_DAY;
+  for (uint32_t day = firstDay; day <= firstDay + 7 && nextIndex < 0; day++) {
+    uint8_t weekday = (day + 4) % 7;  // 1970-01-01 was a Thursday
+    for (size_t i = 0; i < count; i++) {
+      if (!(periods[i].days & (1 << weekday))) continue;
+      uint32_t minute = day * MINUTES_PER_DAY + periods[i].start;
+      if (minute < from) continue;
+      if (nextIndex < 0 || minute < nextMinute) {
+        nextIndex = i;
+        nextMinute = minute;
+      }
+    }
+  }
+  if (nextIndex >= 0) {
+    // May be slightly in the past (within the late limit): then it is due now
+    dueMillis = clockMillis + (uint32_t)((uint64_t)nextMinute * 60000 - clockBase);
+  }
+}
+
+void Timetable::saveState() {
+  char text[12];
+  int length = snprintf(text, sizeof(text), "%u", (unsigned)lastDone);
+  hal::files::write(STATE_FILE, text, length);
+}
+
+bool Timetable::validName(const char* name) {
+  size_t length = strlen(name);
+  if (length == 0 || length > MAX_NAME) return false;
+  for (size_t i = 0; i < length; i++) {
+    char c = name[i];
+    if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+  }
+  return true;
+}
+
+String Timetable::rosterPath(const char* name) { return String("/r-") + name; }
@@ -0,0 +1,82 @@
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include <Hal.h>
+
+// Weekly timetable of scheduled sessions, kept in flash (see HalFiles.h).
+//
+// A period is a set of weekdays, a start minute and the name of a roster
+// uploaded separately. There is no NTP: the client sets the wall clock
+// (local time, seconds since 1970) and hal::millis() carries it forward.
+// The next occurrence is worked out only when the clock, the periods or a
+// dispatch change it, so the loop compares a single millis() deadline.
+// Occurrences go out at most once and in time order; one that cannot be
+// started within LATE_LIMIT_MS (a session still running) is skipped.
+
+class Timetable {
+public:
+  static const size_t MAX_PERIODS = 64;
+  static const size_t MAX_NAME = 15;  // Roster names: letters, digits, '-' and '_'
+  static const uint32_t LATE_LIMIT_MS = 5 * 60 * 1000UL;
+
+  struct Period {
+    uint8_t days;    // Bit per weekday, bit 0 = Sunday
+    uint16_t start;  // Minute of the day
+    char roster[MAX_NAME + 1];
+  };
+
+  struct Dispatch {
+    uint32_t minute;  // Occurrence, minutes since 1970 (0 = none yet)
+    uint32_t lateMs;  // How long after its start time it went out
+    char roster[MAX_NAME + 1];
+  };
+
+  Timetable() : clockValid(false), count(0), lastDone(0), nextIndex(-1), missed(0), lastDispatch() {}
+
+  // Loads the stored periods and the last occurrence dispatched
+  void begin();
+
+  void setClock(uint32_t seconds);
+  bool clockSet() const { return clockValid; }
+  uint64_t now() const;  // ms since 1970, local time
+
+  // Replaces (and stores) the periods. Names must be valid.
+  bool setPeriods(const Period* periods, size_t count);
+  size_t size() const { return count; }
+  const Period& operator[](size_t i) const { return periods[i]; }
+
+  // Index of the period due at this millis(), or -1. Stays due until
+  // dispatched(), or until it is past LATE_LIMIT_MS and gets skipped.
+  int due(uint32_t ms);
+  // Records the due occurrence as started at this millis() and plans the next
+  void dispatched(uint32_t ms);
+  const Dispatch& last() const { return lastDispatch; }
+
+  // Next occurrence planned: its period index (or -1) and start in minutes since 1970
+  int next(uint32_t& minute) const {
+    minute = nextMinute;
+    return nextIndex;
+  }
+  uint32_t missedCount() const { return missed; }
+
+  static bool validName(const char* name);
+  static String rosterPath(const char* name);  // "/r-<name>"
+
+private:
+  void plan();
+  void saveState();
+
+  bool clockValid;
+  uint64_t clockBase;    // ms since 1970 at clockMillis
+  uint32_t clockMillis;
+  Period periods[MAX_PERIODS];
+  size_t count;
+  uint32_t lastDone;     // Minute of the last occurrence dispatched or skipped
+  int nextIndex;
+  uint32_t nextMinute;
+  uint32_t dueMillis;
+  uint32_t missed;
+  Dispatch lastDispatch;
+};
+
+#endif
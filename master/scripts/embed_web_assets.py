@@ -0,0 +1,80 @@
+"""Gzip the master's static web UI into a PROGMEM header.
+
+Runs before every build as a PlatformIO extra script (see platformio.ini) and
+can also be run by hand:
+
+  python scripts/embed_web_assets.py
+
+Each file in web/ is compressed with gzip -9 and a zero mtime, so unchanged
+sources produce a byte-identical include/WebAssets.h and the ETags (a hash of
+the compressed bytes) only change when the page does. The header is generated;
+edit web/ instead.
+"""
+
+import gzip
+import hashlib
+import os
+
+ASSETS = [
+    # (file in web/, URL path, content type, C identifier)
+    ("index.html", "/", "text/html", "INDEX_HTML"),
+    ("dashboard.html", "/dashboard", "text/html", "DASHBOARD_HTML"),
+]
+
+
+def render(project_dir):
+    out = [
+        "// Generated by scripts/embed_web_assets.py from web/ -- do not edit.",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <Hal.h>",
+        "",
+        "// A gzip-compressed file kept in flash, served as-is with",
+        "// Content-Encoding: gzip",
+        "struct WebAsset {",
+        "  const char* path;",
+        "  const char* contentType;",
+        "  const uint8_t* data;",
+        "  size_t length;",
+        "  const char* etag;",
+        "};",
+        "",
+    ]
+    for filename, path, content_type, name in ASSETS:
+        with open(os.path.join(project_dir, "web", filename), "rb") as f:
+            source = f.read()
+        data = gzip.compress(source, 9, mtime=0)
+        etag = '"' + hashlib.sha1(data).hexdigest()[:16] + '"'
+
+        out.append("// web/%s: %d bytes, %d gzipped" % (filename, len(source), len(data)))
+        out.append("static const uint8_t %s_GZ[] PROGMEM = {" % name)
+        for i in range(0, len(data), 16):
+            out.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        out.append("};")
+        out.append('static const WebAsset ASSET_%s = {"%s", "%s", %s_GZ, sizeof(%s_GZ), "%s"};'
+                   % (name, path, content_type, name, name, etag.replace('"', '\\"')))
+        out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def generate(project_dir):
+    header = os.path.join(project_dir, "include", "WebAssets.h")
+    text = render(project_dir)
+    try:
+        with open(header) as f:
+            if f.read() == text:
+                return  # Leave the mtime alone so nothing rebuilds
+    except OSError:
+        pass
+    with open(header, "w") as f:
+        f.write(text)
+    print("Generated %s" % os.path.relpath(header, project_dir))
+
+
+try:
+    Import("env")  # noqa: F821 -- defined when PlatformIO runs this script
+    generate(env["PROJECT_DIR"])  # noqa: F821
+except NameError:
+    generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
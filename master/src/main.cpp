@@ -1,38 +1,89 @@
 // LED pin (GPIO2, D4 on NodeMCU)
-#include <Arduino.h>
-#include <ESP8266WiFi.h>
-#include <ESP8266WebServer.h>
-#include <ESP8266HTTPClient.h>
+#include <Hal.h>
 #include <ArduinoJson.h>
 #include <vector>
-#include <map>
-#include <SoftwareSerial.h>
+#include <ctype.h>
+#include <RosterCodec.h>
+#include <RosterWriter.h>
+#include <SessionTable.h>
+#include <UartLink.h>
+#include <Profiler.h>
+#include <Trace.h>
+#include <Metrics.h>
+#include <EventHub.h>
+#include <Checkpoint.h>
+#include <Timetable.h>
+#include <SessionLog.h>
+#include <WebAssets.h>
 
 #define LED_PIN 2
 
+// Run the RVU101 link (and the shared TX) on the hardware UART, swapped onto
+// RX=GPIO13 / TX=GPIO15. Debug output then moves to Serial1 (TX-only on
+// GPIO2), which is also the LED pin, so the LED is disabled in that mode.
+#ifndef LINK_USE_HW_UART
+#define LINK_USE_HW_UART 0
+#endif
+
+#if LINK_USE_HW_UART
+#define DEBUG Serial1
+hal::SerialPort uart0(hal::HardwareUart{true}); // RX=GPIO13, TX=GPIO15 (shared TX)
+UartLink link101(uart0);
+hal::SerialPort softSerial2(5, -1); // RX=GPIO5, receive only
+#else
+#define DEBUG Serial
 // SoftwareSerial for both RVU101 and RVU102
-SoftwareSerial softSerial(12, 14); // RX=GPIO12, TX=GPIO14
-SoftwareSerial softSerial2(5,14); // RX=GPIO5, TX=GPIO14
+hal::SerialPort softSerial(12, 14); // RX=GPIO12, TX=GPIO14
+UartLink link101(softSerial);
+hal::SerialPort softSerial2(5,14); // RX=GPIO5, TX=GPIO14
+#endif
+UartLink link102(softSerial2);
+
+hal::Led led(LED_PIN, true); // Active low
+
+// Profiler zones, reported at GET /profile (see Profiler.h)
+enum ProfileZone {
+  ZONE_LOOP,
+  ZONE_HTTP,
+  ZONE_START_TASK,
+  ZONE_LINK_NEGOTIATE,
+  ZONE_DISPATCH,
+  ZONE_UART_RX,
+  ZONE_PARSE_REPLY,
+  ZONE_UPLOAD,
+  ZONE_LED,
+  ZONE_DEBUG_LOG,
+  ZONE_HISTORY,
+  ZONE_COUNT
+};
+const char* const ZONE_NAMES[ZONE_COUNT] = {
+  "loop", "http", "start_task", "link_negotiate", "dispatch",
+  "uart_rx", "parse_reply", "upload", "led", "debug_log", "history"
+};
 //  I want sending to RVU001 and RVU002 to be through the same SoftwareSerial instance as they share the same TX line, but for recieving 
 // I want separate SoftwareSerials to be used. The tasks given will have either RVU001 or RVU002 or both. So if only one rreciever is needed, only that SoftwareSerial will be used to recieve data., if both are needed, both SoftwareSerials will be used to recieve data.
 
 // Helper: blink LED n times, normal brightness
 void blinkLED(int times, int duration = 150) {
+  if (LINK_USE_HW_UART) return;  // GPIO2 carries Serial1 debug output
+  PROFILE_ZONE(ZONE_LED);
   for (int i = 0; i < times; i++) {
-    digitalWrite(LED_PIN, LOW);   // LED ON (active low)
-    delay(duration);
-    digitalWrite(LED_PIN, HIGH);  // LED OFF
-    delay(duration);
+    led.on();
+    hal::delay(duration);
+    led.off();
+    hal::delay(duration);
   }
 }
 
 // Helper: blink LED n times, half brightness
 void blinkLEDHalfBrightness(int times, int duration = 150) {
+  if (LINK_USE_HW_UART) return;  // GPIO2 carries Serial1 debug output
+  PROFILE_ZONE(ZONE_LED);
   for (int i = 0; i < times; i++) {
-    analogWrite(LED_PIN, 512);    // Half brightness (range 0-1023)
-    delay(duration);
-    digitalWrite(LED_PIN, HIGH);  // LED OFF
-    delay(duration);
+    led.dim(512);                 // Half brightness (range 0-1023)
+    hal::delay(duration);
+    led.off();
+    hal::delay(duration);
   }
 }
 
@@ -46,18 +97,34 @@ const int RESULT_SERVER_PORT = 8080;
 const char* RESULT_ENDPOINT = "/results";
 
 // ESP8266 AP static IP
-IPAddress apIP(192, 168, 4, 1); // ESP8266 AP IP
-IPAddress netMsk(255, 255, 255, 0);
-IPAddress clientIP(192, 168, 4, 2); // The only allowed client IP
+const uint32_t apIP = hal::ip(192, 168, 4, 1); // ESP8266 AP IP
+const uint32_t netMsk = hal::ip(255, 255, 255, 0);
+const uint32_t clientIP = hal::ip(192, 168, 4, 2); // The only allowed client IP
 
 // UART Configuration
-#define UART_BAUD_RATE 9600
+#define UART_BAUD_RATE 9600   // Every session starts and ends at this rate
+
+// Try to step the link up to a faster rate at the start of each session
+#ifndef LINK_NEGOTIATE_BAUD
+#define LINK_NEGOTIATE_BAUD 1
+#endif
+const unsigned long LINK_REPLY_TIMEOUT = 200;
 
 // Protocol markers
 const char START_MARKER = '<';
 const char END_MARKER = '>';
 const char SEPARATOR = '|';
 
+// Longest reply frame taken: a whole roster, the most the session arena lets
+// a reply hold, plus the address and section tag
+const size_t MAX_REPLY_FRAME = SessionTable::ARENA_SIZE / 2 + 32;
+
+// Front-code rosters sent to slaves (see RosterCodec.h). The plain format is
+// still used whenever it would be shorter.
+#ifndef ROSTER_FRONT_CODING
+#define ROSTER_FRONT_CODING 1
+#endif
+
 // ==================== STATE MACHINE ====================
 enum State {
   HALT,    // Waiting for HTTP request with task
@@ -68,209 +135,335 @@ enum State {
 State currentState = HALT;
 
 // ==================== DATA STRUCTURES ====================
-// Task: address (string) -> list of USNs to send
-std::map<String, std::vector<String>> taskData;
-
-// Responses: address (string) -> list of USNs received
-std::map<String, std::vector<String>> responseData;
+// Per-session tables: each address with its task USNs, the USNs it replied
+// with and whether we're still waiting for it. Backed by a bump arena that
+// is rewound at HALT instead of freeing every String (see SessionTable.h).
+SessionTable session;
 
-// Track which addresses we're waiting for
-std::vector<String> pendingAddresses;
-
-// UART receive buffers for each address
+// UART receive buffers for each address, reserved at MAX_REPLY_FRAME in
+// setup() so a reply never regrows them on the heap one char at a time
 String uartBuffer101 = "";
 bool receiving101 = false;
 String uartBuffer102 = "";
 bool receiving102 = false;
 
-// Timeout for WAIT state (2 minutes = 120000 ms)
+// Timeout for WAIT state (2 minutes = 120000 ms), stretched for a section
+// with a longer window of its own (see waitTimeout())
 const unsigned long WAIT_TIMEOUT = 120000;
-unsigned long waitStartTime = 0;
+const unsigned long WAIT_GRACE = 30000;  // After a section's window, for its reply
+uint32_t waitStartTime = 0;  // Same width as hal::millis() so resumed starts subtract right
+bool ackCheckPending = false;  // Roster ACKs still to be checked (see resendUnacknowledged())
 unsigned long lastStatusPrint = 0;
+uint32_t sessionStartTime = 0;
+
+// ==================== SESSION CHECKPOINT ====================
+// Enough to rebuild the session after a reset (see Checkpoint.h). The /start
+// body (or "@<name>" for a timetable roster) and each reply are kept in
+// flash (START_FILE, /replyN); the RTC record says how far the session got.
+#define START_FILE "/start"
+#define TRACE_FILE "/trace"  // Traffic trace of the last session (see Trace.h)
+#ifndef TRACE_FLUSH
+#define TRACE_FLUSH 0        // 1: save the trace to flash at the end of every session (a flash write each)
+#endif
+const unsigned long CHECKPOINT_INTERVAL = 1000;  // Refresh while in WAIT
+const uint32_t CHECKPOINT_VERSION = 1;
+struct SessionCheckpoint {
+  uint8_t state;            // ACTIVE or WAIT
+  uint8_t reserved[3];
+  uint32_t startHash;       // Of the /start body or roster
+  uint32_t linkBaud;
+  uint32_t sessionElapsed;  // ms since POST /start
+  uint32_t waitElapsed;     // ms of the WAIT timeout used up
+  uint16_t pending;         // Bit per session entry
+  uint16_t responded;       // Bit per session entry with a /replyN in flash
+};
+SessionCheckpoint checkpoint;
+unsigned long lastCheckpoint = 0;
+
+// ==================== METRICS ====================
+// Per-link counters at GET /metrics are indexed like this (see Metrics.h)
+enum LinkIndex { LINK_RVU101, LINK_RVU102, LINK_COUNT };
+const char* const LINK_NAMES[LINK_COUNT] = {"RVU101", "RVU102"};
 
 // ==================== WEB SERVER ====================
-ESP8266WebServer server(80);
+hal::HttpServer server(80);
+
+// Live status pushed to GET /events subscribers (see EventHub.h)
+EventHub events(server);
+
+// Scheduled sessions, dispatched without a POST /start (see Timetable.h)
+Timetable timetable;
+char sessionPeriod[Timetable::MAX_NAME + 1] = "";  // Roster name of a scheduled session, "" for POST /start
+
+// Finished sessions, kept in flash for GET /results (see SessionLog.h)
+SessionLog history;
 
 // ==================== FUNCTION DECLARATIONS ====================
 void setupWiFi();
 void setupWebServer();
-void handleRoot();
+void serveAsset(const WebAsset& asset);
 void handleStartTask();
+const char* loadTasks(const String& body, int& code);
+const char* loadRosterLines(const String& text, int& code);
+const char* loadSession(const String& body, int& code);
+const char* requireAddresses(int& code);
+const char* openEntry(const char* address, size_t len, const char* section, size_t sectionLen,
+                      uint16_t window, int& index, int& code);
+const char* checkRoster(const String& text, size_t& usns, int& code);
+void handleTime();
+void handleRoster();
+void handleTimetable();
+void handleSetTimetable();
+void pollTimetable();
 void handleStatus();
-void sendUSNsToAddress(const String& address, const std::vector<String>& usns);
+void handleProfile();
+void handleMetrics();
+void handleTrace();
+void handleResults();
+void handleClearResults();
+void recordHistory();
+void handleEvents();
+void publishState();
+void broadcastRosters();
+void sendUSNsToAddress(const char* address);
+void resendUnacknowledged();
+void acknowledge(const char* address, size_t len);
 void processUARTData();
-void parseReceivedMessage(const String& message);
+int parseReceivedMessage(const String& message);
 void sendResultsToServer();
-String buildJsonPayload(const std::map<String, std::vector<String>>& data);
+String buildJsonPayload(const SessionTable& table);
 void transitionToHalt();
 void transitionToActive();
 void transitionToWait();
+unsigned long waitTimeout();
 void debugPrint(const String& msg);
+uint32_t negotiateLinkRate();
+bool tryLinkRate(uint32_t rate);
+void setLinkRate(uint32_t rate);
+void saveCheckpoint();
+void saveReply(int index, const String& message);
+bool readStart(String& body);
+bool resumeSession();
 
 // ==================== SETUP ====================
 void setup() {
-  // Initialize hardware Serial for debug only
-  Serial.begin(115200);
+  // Initialize debug output (hardware Serial, or Serial1 when the link owns it)
+  DEBUG.begin(115200);
   
-  // Initialize SoftwareSerial instances
-  softSerial.begin(UART_BAUD_RATE);   // For RVU101 receive and shared TX
-  softSerial2.begin(UART_BAUD_RATE);  // For RVU102 receive
-  delay(100);
+  // Initialize UART links
+  link101.begin(UART_BAUD_RATE);   // For RVU101 receive and shared TX
+  link102.begin(UART_BAUD_RATE);   // For RVU102 receive
+  uartBuffer101.reserve(MAX_REPLY_FRAME + 1);
+  uartBuffer102.reserve(MAX_REPLY_FRAME + 1);
 
-  pinMode(LED_PIN, OUTPUT);
-  digitalWrite(LED_PIN, HIGH); // LED OFF
+  led.begin(); // LED OFF
+
+  Profiler::begin(ZONE_NAMES, ZONE_COUNT);
+  Metrics::begin(LINK_NAMES, LINK_COUNT);
 
   debugPrint("\n\n=== ESP8266 UART Master Controller ===");
 
   setupWiFi();
   setupWebServer();
 
-  debugPrint("System ready in HALT mode");
-  debugPrint("Waiting for HTTP commands...");
+  if (!hal::files::begin()) {
+    debugPrint("No flash filesystem, sessions will not survive a reset");
+  }
+  timetable.begin();
+  history.begin();
+
+  if (resumeSession()) {
+    debugPrint("Resumed after reset");
+  } else {
+    debugPrint("System ready in HALT mode");
+    debugPrint("Waiting for HTTP commands...");
+  }
+  debugPrint("Ready in " + String(hal::millis()) + " ms");
 }
 
 // ==================== MAIN LOOP ====================
 void loop() {
-  server.handleClient();
+  PROFILE_ZONE(ZONE_LOOP);
+  {
+    PROFILE_ZONE(ZONE_HTTP);
+    server.handleClient();
+    events.poll();
+  }
   
   // Always check for incoming UART data for both possible addresses
   processUARTData();
   
   switch (currentState) {
     case HALT:
-      // Just handle HTTP requests (done above)
+      // Handle HTTP requests (done above) and start scheduled sessions
+      pollTimetable();
       break;
       
     case ACTIVE:
       // Send USNs to all addresses via UART
+#if LINK_NEGOTIATE_BAUD
+      negotiateLinkRate();
+      saveCheckpoint();  // A reset from here on must come back at this rate
+#endif
       debugPrint("ACTIVE: Sending USNs via UART...");
-      debugPrint("Total addresses to send to: " + String(taskData.size()));
-      for (auto& entry : taskData) {
-        String address = entry.first;
-        Serial.println("[ACTIVE] Preparing to send to address: " + address);
-        sendUSNsToAddress(address, entry.second);
-        pendingAddresses.push_back(address);
-        Serial.println("[ACTIVE] Added to pendingAddresses: " + address);
-        Serial.println("[ACTIVE] pendingAddresses size now: " + String(pendingAddresses.size()));
-        delay(50);  // Small delay between transmissions
+      debugPrint("Total addresses to send to: " + String(session.size()));
+      broadcastRosters();
+      for (size_t i = 0; i < session.size(); i++) {
+        SessionTable::Entry& entry = session[i];
+        entry.pending = true;
+        DEBUG.println("[ACTIVE] Marked pending: " + String(entry.address));
+        DEBUG.println("[ACTIVE] Pending count now: " + String(session.pendingCount()));
       }
-      Serial.println("[ACTIVE] All messages sent. Total pending: " + String(pendingAddresses.size()));
-      Serial.print("[ACTIVE] Pending addresses list: ");
-      for (const String& addr : pendingAddresses) {
-        Serial.print(addr + ", ");
+      ackCheckPending = true;
+      DEBUG.println("[ACTIVE] All messages sent. Total pending: " + String(session.pendingCount()));
+      DEBUG.print("[ACTIVE] Pending addresses list: ");
+      for (size_t i = 0; i < session.size(); i++) {
+        if (session[i].pending) {
+          DEBUG.print(String(session[i].address) + ", ");
+        }
       }
-      Serial.println();
+      DEBUG.println();
+      DEBUG.println("[ACTIVE] Session arena: " + String(session.bytesUsed()) + "/" +
+                     String(SessionTable::ARENA_SIZE) + " bytes");
       transitionToWait();
       break;
       
     case WAIT:
       // Print status every 5 seconds
-      if (millis() - lastStatusPrint > 5000) {
-        lastStatusPrint = millis();
-        Serial.println("\\n[WAIT STATUS] ============================");
-        Serial.println("[WAIT STATUS] Time elapsed: " + String((millis() - waitStartTime) / 1000) + " seconds");
-        Serial.println("[WAIT STATUS] pendingAddresses.size() = " + String(pendingAddresses.size()));
-        Serial.println("[WAIT STATUS] Pending addresses:");
-        for (const String& addr : pendingAddresses) {
-          Serial.println("  - '" + addr + "'");
+      if (hal::millis() - lastStatusPrint > 5000) {
+        lastStatusPrint = hal::millis();
+        DEBUG.println("\\n[WAIT STATUS] ============================");
+        DEBUG.println("[WAIT STATUS] Time elapsed: " + String((hal::millis() - waitStartTime) / 1000) + " seconds");
+        DEBUG.println("[WAIT STATUS] Pending count = " + String(session.pendingCount()));
+        DEBUG.println("[WAIT STATUS] Pending addresses:");
+        for (size_t i = 0; i < session.size(); i++) {
+          if (session[i].pending) {
+            DEBUG.println("  - '" + String(session[i].address) + "'");
+          }
         }
-        Serial.println("[WAIT STATUS] responseData.size() = " + String(responseData.size()));
-        Serial.println("[WAIT STATUS] Responses received:");
-        for (const auto& entry : responseData) {
-          Serial.println("  - '" + entry.first + "' -> " + String(entry.second.size()) + " USNs");
+        DEBUG.println("[WAIT STATUS] Responses count = " + String(session.respondedCount()));
+        DEBUG.println("[WAIT STATUS] Responses received:");
+        for (size_t i = 0; i < session.size(); i++) {
+          if (session[i].responded) {
+            DEBUG.println("  - '" + String(session[i].address) + "' -> " + String(session[i].response.count) + " USNs");
+          }
         }
-        Serial.println("[WAIT STATUS] taskData.size() = " + String(taskData.size()));
-        Serial.println("[WAIT STATUS] Task addresses:");
-        for (const auto& entry : taskData) {
-          Serial.println("  - '" + entry.first + "'");
+        DEBUG.println("[WAIT STATUS] Task count = " + String(session.size()));
+        DEBUG.println("[WAIT STATUS] Task addresses:");
+        for (size_t i = 0; i < session.size(); i++) {
+          DEBUG.println("  - '" + String(session[i].address) + "'");
         }
-        Serial.println("[WAIT STATUS] ============================\\n");
+        DEBUG.println("[WAIT STATUS] ============================\\n");
       }
       
+      if (ackCheckPending && hal::millis() - waitStartTime >= UartLink::ACK_TIMEOUT_MS) {
+        ackCheckPending = false;
+        resendUnacknowledged();
+      }
+
       // Check if timeout exceeded
-      if (millis() - waitStartTime > WAIT_TIMEOUT) {
-        debugPrint("WAIT timeout reached (120 seconds)!");
-        debugPrint("Pending addresses: " + String(pendingAddresses.size()));
-        if (!responseData.empty()) {
+      if (hal::millis() - waitStartTime > waitTimeout()) {
+        debugPrint("WAIT timeout reached (" + String(waitTimeout() / 1000) + " seconds)!");
+        debugPrint("Pending addresses: " + String(session.pendingCount()));
+        Metrics::waitTimeouts++;
+        if (session.respondedCount() > 0) {
           debugPrint("Sending partial results...");
+          Metrics::partialSends++;
           sendResultsToServer();
         }
+        recordHistory();
         transitionToHalt();
       }
       // Check if all responses received
-      else if (pendingAddresses.empty()) {
-        Serial.println("[WAIT] pendingAddresses is EMPTY - checking why...");
-        Serial.println("[WAIT] responseData.size() = " + String(responseData.size()));
-        Serial.println("[WAIT] Total responses in responseData: " + String(responseData.size()));
-        for (const auto& entry : responseData) {
-          Serial.println("  [WAIT] '" + entry.first + "' has " + String(entry.second.size()) + " USNs");
+      else if (session.pendingCount() == 0) {
+        size_t responded = session.respondedCount();
+        DEBUG.println("[WAIT] No pending addresses left - checking responses...");
+        DEBUG.println("[WAIT] Total responses: " + String(responded));
+        for (size_t i = 0; i < session.size(); i++) {
+          if (session[i].responded) {
+            DEBUG.println("  [WAIT] '" + String(session[i].address) + "' has " + String(session[i].response.count) + " USNs");
+          }
         }
-        if (responseData.size() < taskData.size()) {
-          Serial.println("[WAIT] WARNING: responseData has fewer entries than taskData!");
-          Serial.println("[WAIT] Expected " + String(taskData.size()) + " responses, got " + String(responseData.size()));
+        if (responded < session.size()) {
+          DEBUG.println("[WAIT] WARNING: fewer responses than task addresses!");
+          DEBUG.println("[WAIT] Expected " + String(session.size()) + " responses, got " + String(responded));
         }
         debugPrint("All responses received!");
         sendResultsToServer();
+        recordHistory();
         transitionToHalt();
       }
+      else if (hal::millis() - lastCheckpoint >= CHECKPOINT_INTERVAL) {
+        saveCheckpoint();
+      }
       break;
   }
+  Profiler::sampleHeap();
 }
 
 // ==================== DEBUG OUTPUT ====================
 // Note: Debug output goes to same UART - disable in production or use different method
 void debugPrint(const String& msg) {
+  PROFILE_ZONE(ZONE_DEBUG_LOG);
   // Only print debug in HALT state to avoid interfering with communication
   // if (currentState == HALT) {
-    Serial.println("[DBG] " + msg);
+    DEBUG.println("[DBG] " + msg);
 
 }
 
 // ==================== WIFI SETUP ====================
 void setupWiFi() {
-  Serial.println("[DBG] Setting up as WiFi AP (host mode)");
-  WiFi.mode(WIFI_AP);
-  WiFi.softAPConfig(apIP, apIP, netMsk);
-  WiFi.softAP(WIFI_SSID, WIFI_PASSWORD, 1, 0, 1); // channel 1, open, max 1 client
-  delay(100);
-  Serial.print("[DBG] AP IP address: ");
-  Serial.println(WiFi.softAPIP());
-  Serial.print("[DBG] Waiting for client to connect and take IP: ");
-  Serial.println(RESULT_SERVER_IP);
+  DEBUG.println("[DBG] Setting up as WiFi AP (host mode)");
+  hal::wifi::startAccessPoint(WIFI_SSID, WIFI_PASSWORD, apIP, netMsk, 1, 1); // channel 1, max 1 client
+  DEBUG.print("[DBG] AP IP address: ");
+  DEBUG.println(hal::ipToString(hal::wifi::accessPointIP()));
+  DEBUG.print("[DBG] Waiting for client to connect and take IP: ");
+  DEBUG.println(RESULT_SERVER_IP);
   // Note: The ESP cannot force the client to take a specific IP, but you can instruct the client to use RESULT_SERVER_IP as its static IP.
 }
 
 // ==================== WEB SERVER SETUP ====================
 void setupWebServer() {
-  server.on("/", HTTP_GET, handleRoot);
+  // Static pages are gzipped into flash at build time (web/, see WebAssets.h)
+  static const char* const cachedHeaders[] = {"If-None-Match"};
+  server.collectHeaders(cachedHeaders, 1);
+  server.on("/", HTTP_GET, [] { serveAsset(ASSET_INDEX_HTML); });
+  server.on("/dashboard", HTTP_GET, [] { serveAsset(ASSET_DASHBOARD_HTML); });
   server.on("/start", HTTP_POST, handleStartTask);
   server.on("/status", HTTP_GET, handleStatus);
+  server.on("/profile", HTTP_GET, handleProfile);
+  server.on("/metrics", HTTP_GET, handleMetrics);
+  server.on("/events", HTTP_GET, handleEvents);
+  server.on("/time", HTTP_POST, handleTime);
+  server.on("/rosters", HTTP_POST, handleRoster);
+  server.on("/timetable", HTTP_GET, handleTimetable);
+  server.on("/timetable", HTTP_POST, handleSetTimetable);
+  server.on("/trace", HTTP_GET, handleTrace);
+  server.on("/results", HTTP_GET, handleResults);
+  server.on("/results", HTTP_DELETE, handleClearResults);
+  server.onRequest([] { Trace::request(server); });
   
   server.begin();
   debugPrint("HTTP server started on port 80");
 }
 
 // ==================== HTTP HANDLERS ====================
-void handleRoot() {
-  String html = "<html><head><title>ESP8266 UART Master</title></head><body>";
-  html += "<h1>ESP8266 UART Master Controller</h1>";
-  html += "<p>State: " + String(currentState == HALT ? "HALT" : (currentState == ACTIVE ? "ACTIVE" : "WAIT")) + "</p>";
-  html += "<h2>API Endpoints:</h2>";
-  html += "<ul>";
-  html += "<li>POST /start - Start task with JSON payload</li>";
-  html += "<li>GET /status - Get current status</li>";
-  html += "</ul>";
-  html += "<h2>Example POST /start payload:</h2>";
-  html += "<pre>{\"tasks\":[{\"address\":\"A1\",\"usns\":[\"USN001\",\"USN002\"]},{\"address\":\"B2\",\"usns\":[\"USN003\"]}]}</pre>";
-  html += "<h2>UART Protocol:</h2>";
-  html += "<p>Send: &lt;ADDRESS|USN1|USN2|...&gt;</p>";
-  html += "<p>Receive: &lt;ADDRESS|USN1|USN2|...&gt;</p>";
-  html += "</body></html>";
-  
-  server.send(200, "text/html", html);
+// Pages only change with the firmware, so browsers revalidate with the ETag
+// and get an empty 304 on every repeat load. Assumes gzip support, as every
+// browser has.
+void serveAsset(const WebAsset& asset) {
+  server.sendHeader("ETag", asset.etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == asset.etag) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.sendProgmem(200, asset.contentType, asset.data, asset.length);
 }
 
 void handleStartTask() {
+  PROFILE_ZONE(ZONE_START_TASK);
   if (currentState != HALT) {
     server.send(400, "application/json", "{\"error\":\"Not in HALT state\"}");
     return;
@@ -285,76 +478,228 @@ void handleStartTask() {
   debugPrint("Received task: " + body);
   blinkLED(2); // Blink twice when HTTP POST /start received
   
-  // Parse JSON
-  StaticJsonDocument<2048> doc;
-  DeserializationError error = deserializeJson(doc, body);
-  
+  int code;
+  const char* error = loadTasks(body, code);
   if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+    server.send(code, "application/json", error);
     return;
   }
+
+  // Keep the request in flash so a reset can rebuild the session (see resumeSession())
+  checkpoint.startHash = Checkpoint::hash(body.c_str(), body.length());
+  if (!hal::files::write(START_FILE, body.c_str(), body.length())) {
+    debugPrint("Task not saved, this session cannot resume after a reset");
+  }
+
+  sessionPeriod[0] = '\0';
+  server.send(200, "application/json", "{\"status\":\"Task accepted, transitioning to ACTIVE\"}");
+  // Move to ACTIVE state only after response is sent and all logic is done
+  transitionToActive();
+}
+
+// Builds the session from a /start body. Returns nullptr, or the error
+// response and its status code.
+const char* loadTasks(const String& body, int& code) {
+  // Parse JSON. Every value but the first in a container follows a comma, so
+  // the separators bound the slots, and the copied strings fit in the body's
+  // length.
+  size_t slots = 1;
+  for (size_t i = 0; i < body.length(); i++) {
+    char c = body[i];
+    if (c == ',' || c == '[' || c == '{') slots++;
+  }
+  DynamicJsonDocument doc(JSON_ARRAY_SIZE(slots) + body.length());
+  DeserializationError error = deserializeJson(doc, body.c_str(), body.length());
+  
+  if (error == DeserializationError::NoMemory) {
+    code = 413;
+    return "{\"error\":\"Task too large\"}";
+  }
+  if (error) {
+    code = 400;
+    return "{\"error\":\"Invalid JSON\"}";
+  }
   
   // Clear previous data
-  taskData.clear();
-  responseData.clear();
-  pendingAddresses.clear();
+  session.reset();
   uartBuffer101 = "";
   uartBuffer102 = "";
   
   // Parse tasks array
   // Expected format: {"tasks":[{"address":"A1","usns":["USN1","USN2"]},{"address":"B2","usns":["USN3"]}]}
+  // A task may add "section":"ID"; an address can run several sections at once,
+  // and a section may set its own "window" in seconds.
   JsonArray tasks = doc["tasks"].as<JsonArray>();
 
-  bool has101 = false, has102 = false;
   for (JsonObject task : tasks) {
-    String address = task["address"].as<String>();
+    const char* address = task["address"] | "";
+    const char* section = task["section"] | "";
+    unsigned long window = task["window"] | 0UL;
     JsonArray usns = task["usns"].as<JsonArray>();
 
-    std::vector<String> usnList;
+    if (window > RosterCodec::MAX_SECTION_WINDOW || (window > 0 && section[0] == '\0')) {
+      session.reset();
+      code = 400;
+      return "{\"error\":\"Invalid window\"}";
+    }
+    int index;
+    const char* error = openEntry(address, strlen(address), section, strlen(section), window, index, code);
+    if (error) {
+      session.reset();
+      return error;
+    }
+
+    SessionTable::Entry& entry = session[index];
+    session.beginList(entry.task);
     for (const char* usn : usns) {
-      usnList.push_back(String(usn));
+      if (!session.appendUSN(entry.task, usn, strlen(usn))) {
+        session.reset();
+        code = 413;
+        return "{\"error\":\"Task too large\"}";
+      }
     }
 
-    taskData[address] = usnList;
-    debugPrint("Task added: Address " + address + " with " + String(usnList.size()) + " USNs");
-    if (address == "RVU101") has101 = true;
-    if (address == "RVU102") has102 = true;
+    debugPrint("Task added: Address " + String(address) + " with " + String(entry.task.count) + " USNs");
   }
-  // Always wait for both RVU101 and RVU102
-  if (!has101) {
-    taskData["RVU101"] = std::vector<String>();
-    debugPrint("Task added: Address RVU101 (empty, forced wait)");
+  const char* missing = requireAddresses(code);
+  if (missing) return missing;
+  // Room for every reply and the sort scratch, as checkRoster() requires
+  if (session.sessionBytes(sizeof(RosterCodec::UsnRef)) > SessionTable::ARENA_SIZE) {
+    session.reset();
+    code = 413;
+    return "{\"error\":\"Task too large\"}";
+  }
+  return nullptr;
+}
+
+// The session entry for this address and section, added if new, with its
+// window. Returns nullptr, or the error response and its status code.
+const char* openEntry(const char* address, size_t len, const char* section, size_t sectionLen,
+                      uint16_t window, int& index, int& code) {
+  index = session.find(address, len, section, sectionLen);
+  if (index >= 0) {
+    session[index].window = window;
+    return nullptr;
+  }
+  if (sectionLen > 0 && !RosterCodec::validSectionId(section, sectionLen)) {
+    code = 400;
+    return "{\"error\":\"Invalid section\"}";
+  }
+  size_t sections = 0;
+  for (size_t i = 0; i < session.size(); i++) {
+    if (strncmp(session[i].address, address, len) == 0 && session[i].address[len] == '\0') sections++;
   }
-  if (!has102) {
-    taskData["RVU102"] = std::vector<String>();
-    debugPrint("Task added: Address RVU102 (empty, forced wait)");
+  if (sections >= RosterCodec::MAX_SECTIONS) {
+    code = 413;
+    return "{\"error\":\"Too many sections\"}";
   }
-  pendingAddresses.clear();
-  pendingAddresses.push_back("RVU101");
-  pendingAddresses.push_back("RVU102");
+  index = session.addAddress(address, len, section, sectionLen);
+  if (index < 0) {
+    code = 413;
+    return "{\"error\":\"Too many addresses\"}";
+  }
+  session[index].window = window;
+  return nullptr;
+}
 
-  if (taskData.empty()) {
-    server.send(400, "application/json", "{\"error\":\"No valid tasks\"}");
-    return;
+// Builds the session from a stored roster: one "ADDRESS|USN1|USN2|..." line
+// per address, or "ADDRESS|~SID|USN1|..." (or ~SID:SECONDS) per section, the
+// same fields as a roster frame on the link
+const char* loadRosterLines(const String& text, int& code) {
+  session.reset();
+  uartBuffer101 = "";
+  uartBuffer102 = "";
+
+  const char* data = text.c_str();
+  size_t length = text.length();
+  size_t lineStart = 0;
+  while (lineStart < length) {
+    size_t lineEnd = lineStart;
+    while (lineEnd < length && data[lineEnd] != '\n') lineEnd++;
+    size_t fieldEnd = lineStart;
+    while (fieldEnd < lineEnd && data[fieldEnd] != SEPARATOR && data[fieldEnd] != '\r') fieldEnd++;
+
+    if (fieldEnd > lineStart) {
+      // A section tag, if any, is the field after the address
+      size_t usnStart = fieldEnd + 1;
+      size_t tagEnd = usnStart;
+      while (tagEnd < lineEnd && data[tagEnd] != SEPARATOR && data[tagEnd] != '\r') tagEnd++;
+      const char* section = "";
+      size_t sectionLen = 0;
+      uint16_t window = 0;
+      if (usnStart < lineEnd &&
+          RosterCodec::isSectionTag(data + usnStart, tagEnd - usnStart, section, sectionLen, window)) {
+        usnStart = tagEnd + 1;
+      }
+
+      int index;
+      const char* error = openEntry(data + lineStart, fieldEnd - lineStart, section, sectionLen, window, index, code);
+      if (error) {
+        session.reset();
+        return error;
+      }
+      SessionTable::Entry& entry = session[index];
+      session.beginList(entry.task);
+      for (size_t i = usnStart; i <= lineEnd; i++) {
+        if (i == lineEnd || data[i] == SEPARATOR || data[i] == '\r') {
+          if (i > usnStart && !session.appendUSN(entry.task, data + usnStart, i - usnStart)) {
+            session.reset();
+            code = 413;
+            return "{\"error\":\"Task too large\"}";
+          }
+          usnStart = i + 1;
+        }
+      }
+      debugPrint("Task added: Address " + String(entry.address) + " with " + String(entry.task.count) + " USNs");
+    }
+    lineStart = lineEnd + 1;
   }
+  return requireAddresses(code);
+}
 
-  server.send(200, "application/json", "{\"status\":\"Task accepted, transitioning to ACTIVE\"}");
-  // Move to ACTIVE state only after response is sent and all logic is done
-  transitionToActive();
+// A /start body is JSON; anything else is a timetable roster
+const char* loadSession(const String& body, int& code) {
+  return body.length() > 0 && body[0] == '{' ? loadTasks(body, code) : loadRosterLines(body, code);
+}
+
+const char* requireAddresses(int& code) {
+  // Always wait for both RVU101 and RVU102
+  const char* const requiredAddresses[] = {"RVU101", "RVU102"};
+  for (const char* address : requiredAddresses) {
+    int index = session.find(address);
+    if (index < 0) {
+      index = session.addAddress(address, strlen(address));
+      debugPrint("Task added: Address " + String(address) + " (empty, forced wait)");
+    }
+    if (index < 0) {
+      session.reset();
+      code = 413;
+      return "{\"error\":\"Too many addresses\"}";
+    }
+  }
+
+  if (session.size() == 0) {
+    code = 400;
+    return "{\"error\":\"No valid tasks\"}";
+  }
+
+  return nullptr;
 }
 
 void handleStatus() {
   StaticJsonDocument<1024> doc;
   
   doc["state"] = (currentState == HALT ? "HALT" : (currentState == ACTIVE ? "ACTIVE" : "WAIT"));
-  doc["pending_addresses"] = pendingAddresses.size();
-  doc["tasks_count"] = taskData.size();
-  doc["responses_count"] = responseData.size();
+  doc["pending_addresses"] = session.pendingCount();
+  doc["tasks_count"] = session.size();
+  doc["responses_count"] = session.respondedCount();
   
   // List pending addresses
   JsonArray pending = doc.createNestedArray("pending");
-  for (const String& addr : pendingAddresses) {
-    pending.add(addr);
+  for (size_t i = 0; i < session.size(); i++) {
+    if (session[i].pending) {
+      pending.add(session[i].address);
+    }
   }
   
   String output;
@@ -362,270 +707,1052 @@ void handleStatus() {
   server.send(200, "application/json", output);
 }
 
+// Compact /status equivalent for the event stream:
+// {"state":"WAIT","tasks":2,"responses":1,"pending":["RVU102"]}
+size_t formatState(char* out, size_t size) {
+  const char* state = currentState == HALT ? "HALT" : (currentState == ACTIVE ? "ACTIVE" : "WAIT");
+  int n = snprintf(out, size, "{\"state\":\"%s\",\"tasks\":%u,\"responses\":%u,\"pending\":[",
+                   state, (unsigned)session.size(), (unsigned)session.respondedCount());
+  size_t length = n > 0 ? n : 0;
+  bool first = true;
+  for (size_t i = 0; i < session.size() && length < size; i++) {
+    if (session[i].pending) {
+      n = snprintf(out + length, size - length, "%s\"%s\"", first ? "" : ",", session[i].address);
+      length += n > 0 ? n : 0;
+      first = false;
+    }
+  }
+  if (length < size) length += snprintf(out + length, size - length, "]}");
+  return length < size ? length : 0;
+}
+
+// Subscribers start from a full state snapshot, then get deltas
+void handleEvents() {
+  int stream = events.subscribe();
+  if (stream < 0) {
+    server.send(503, "application/json", "{\"error\":\"Too many event subscribers\"}");
+    return;
+  }
+  char data[256];
+  if (formatState(data, sizeof(data))) {
+    events.send(stream, "state", data);
+  }
+}
+
+void publishState() {
+  Trace::state(currentState);
+  if (!events.hasSubscribers()) return;
+  char data[256];
+  if (formatState(data, sizeof(data))) {
+    events.publish("state", data);
+  }
+}
+
+// Prometheus text, streamed in small pieces (see Metrics.h)
+void handleMetrics() {
+  Metrics::Gauges gauges = {(uint8_t)currentState, (uint8_t)session.pendingCount(),
+                            (uint16_t)session.bytesUsed()};
+  server.beginResponse(200, "text/plain; version=0.0.4");
+  Metrics::write(gauges, [](const char* data, size_t length) { server.sendContent(data, length); });
+  server.endResponse();
+}
+
+// The traffic trace (see Trace.h) as a binary file; ?saved=1 for the copy
+// saved at the end of the last session
+void handleTrace() {
+  if (server.hasArg("saved")) {
+    String saved;
+    if (!hal::files::read(TRACE_FILE, saved)) {
+      server.send(404, "application/json", "{\"error\":\"No saved trace\"}");
+      return;
+    }
+    server.send(200, "application/octet-stream", saved.c_str(), saved.length());
+    return;
+  }
+  server.beginResponse(200, "application/octet-stream");
+  Trace::write([](const char* data, size_t length) { server.sendContent(data, length); });
+  server.endResponse();
+}
+
+// ==================== SESSION HISTORY ====================
+// Every entry of the session that just ended goes to the history, whether
+// or not the upload got through. Empty rosters (a slave only there because
+// both are always dispatched) are left out.
+void recordHistory() {
+  PROFILE_ZONE(ZONE_HISTORY);
+  uint32_t start = 0;  // Unknown until the clock is set
+  if (timetable.clockSet()) start = (timetable.now() - (uint32_t)(hal::millis() - sessionStartTime)) / 1000;
+  for (size_t i = 0; i < session.size(); i++) {
+    if (session[i].task.count == 0) continue;
+    if (!history.append(session, session[i], start, sessionPeriod)) {
+      debugPrint(history.size() >= SessionLog::MAX_RECORDS ? "Session history full, DELETE /results to clear it"
+                                                            : "Session not saved to the history");
+      return;
+    }
+  }
+  debugPrint("Session history: " + String(history.size()) + " entries, " + String(history.bytesUsed()) + " bytes");
+}
+
+// Writes text as a JSON string, at most 2 * length + 2 chars (control
+// characters are dropped)
+static size_t jsonString(char* out, const char* text, size_t length) {
+  size_t n = 0;
+  out[n++] = '"';
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
+    if (c == '"' || c == '\\') {
+      out[n++] = '\\';
+      out[n++] = c;
+    } else if ((uint8_t)c >= 0x20) {
+      out[n++] = c;
+    }
+  }
+  out[n++] = '"';
+  return n;
+}
+
+// Past sessions, oldest first: ?address= for one room, ?since=<local time,
+// seconds since 1970> from then on. Streamed a USN at a time, in the shape
+// of the /results upload plus when, which period and who was on the roster:
+// {"sessions":[{"time":..,"address":"RVU101","section":"A","period":"cs3a",
+//   "replied":true,"roster":60,"present":52,"usns":["1RV22CS001",...]},...]}
+void handleResults() {
+  PROFILE_ZONE(ZONE_HISTORY);
+  static SessionLog::Cursor cursor;  // Fixed buffers, shared by every query
+  static char buffer[768];           // A session's fields, or the longest USN
+  String address = server.arg("address");
+  uint32_t since = strtoul(server.arg("since").c_str(), nullptr, 10);
+  if (!cursor.begin(history, address.c_str(), since)) {
+    server.send(500, "application/json", "{\"error\":\"Could not read the history\"}");
+    return;
+  }
+
+  server.beginResponse(200, "application/json");
+  size_t used = 0;
+  auto flush = [&](size_t room) {
+    if (used + room <= sizeof(buffer)) return;
+    server.sendContent(buffer, used);
+    used = 0;
+  };
+  used += snprintf(buffer, sizeof(buffer), "{\"sessions\":[");
+
+  SessionLog::Session entry;
+  size_t sessions = 0;
+  while (cursor.next(entry)) {
+    flush(128 + 3 * (2 * SessionLog::MAX_NAME + 2));
+    used += sprintf(buffer + used, sessions++ ? ",{\"time\":" : "{\"time\":");
+    used += entry.time ? sprintf(buffer + used, "%lu", (unsigned long)entry.time) : sprintf(buffer + used, "null");
+    used += sprintf(buffer + used, ",\"address\":");
+    used += jsonString(buffer + used, entry.address, strlen(entry.address));
+    used += sprintf(buffer + used, ",\"section\":");
+    used += jsonString(buffer + used, entry.section, strlen(entry.section));
+    used += sprintf(buffer + used, ",\"period\":");
+    used += jsonString(buffer + used, entry.period, strlen(entry.period));
+    used += sprintf(buffer + used, ",\"replied\":%s,\"roster\":%u,\"present\":%u,\"usns\":[",
+                    entry.replied ? "true" : "false", (unsigned)entry.usns, (unsigned)entry.present);
+
+    const char* usn;
+    size_t length;
+    bool present;
+    bool first = true;
+    while (cursor.nextUsn(usn, length, present)) {
+      if (!present) continue;
+      flush(1 + 2 * length + 2);
+      if (!first) buffer[used++] = ',';
+      used += jsonString(buffer + used, usn, length);
+      first = false;
+    }
+    flush(2);
+    buffer[used++] = ']';
+    buffer[used++] = '}';
+  }
+  cursor.end();
+  flush(2);
+  buffer[used++] = ']';
+  buffer[used++] = '}';
+  server.sendContent(buffer, used);
+  server.endResponse();
+}
+
+void handleClearResults() {
+  if (!history.clear()) {
+    server.send(500, "application/json", "{\"error\":\"Could not clear the history\"}");
+    return;
+  }
+  server.send(200, "application/json", "{\"status\":\"History cleared\"}");
+}
+
+// Zone stats cover the current (or last) session; ?reset=1 clears them now
+void handleProfile() {
+  String output;
+  output.reserve(1536);
+  Profiler::writeJson(output);
+  if (server.hasArg("reset")) {
+    Profiler::reset();
+  }
+  server.send(200, "application/json", output);
+}
+
+// ==================== TIMETABLE ====================
+// Wall clock for the timetable: {"now":<local time, seconds since 1970>}
+void handleTime() {
+  String body = server.arg("plain");
+  StaticJsonDocument<64> doc;
+  if (deserializeJson(doc, body.c_str(), body.length()) || !doc["now"].is<uint32_t>()) {
+    server.send(400, "application/json", "{\"error\":\"Expected {\\\"now\\\":<seconds>}\"}");
+    return;
+  }
+  timetable.setClock(doc["now"].as<uint32_t>());
+  server.send(200, "application/json", "{\"status\":\"Clock set\"}");
+}
+
+// Format and size check for an uploaded roster. The session it starts must
+// still have room in the arena for every reply and for the sort scratch of
+// its largest list (see SessionTable::sessionBytes()).
+const char* checkRoster(const String& text, size_t& usns, int& code) {
+  const char* data = text.c_str();
+  size_t length = text.length();
+  size_t addresses = 0;
+  size_t names = 2 * sizeof("RVU101");  // requireAddresses() may add both
+  size_t bytes = 0;
+  size_t lineUsns = 0;
+  size_t largest = 0;
+  usns = 0;
+  size_t fieldStart = 0;
+  size_t field = 0;  // Position in the line
+  for (size_t i = 0; i <= length; i++) {
+    char c = i < length ? data[i] : '\n';
+    if (c != SEPARATOR && c != '\n' && c != '\r') continue;
+    size_t fieldLength = i - fieldStart;
+    const char* section;
+    size_t sectionLen;
+    if (field == 0 && fieldLength > 0) {
+      addresses++;
+      names += fieldLength + 1;
+    } else if (field == 1 && RosterCodec::isSectionTag(data + fieldStart, fieldLength, section, sectionLen)) {
+      if (!RosterCodec::validSectionId(section, sectionLen)) {
+        code = 400;
+        return "{\"error\":\"Invalid section\"}";
+      }
+      names += sectionLen + 1;
+    } else if (field > 0 && fieldLength > 0) {
+      if (fieldLength > SessionTable::MAX_USN_LEN) {
+        code = 400;
+        return "{\"error\":\"USN too long\"}";
+      }
+      usns++;
+      lineUsns++;
+      bytes += fieldLength + 2;
+    }
+    if (c != SEPARATOR) {
+      if (lineUsns > largest) largest = lineUsns;
+      lineUsns = 0;
+    }
+    field = c == SEPARATOR ? field + 1 : 0;
+    fieldStart = i + 1;
+  }
+  if (addresses == 0) {
+    code = 400;
+    return "{\"error\":\"Expected ADDRESS|USN1|USN2|... lines\"}";
+  }
+  if (addresses > SessionTable::MAX_ADDRESSES ||
+      SessionTable::sessionBytes(names, bytes, largest, sizeof(RosterCodec::UsnRef)) > SessionTable::ARENA_SIZE) {
+    code = 413;
+    return "{\"error\":\"Roster too large\"}";
+  }
+  return nullptr;
+}
+
+// Stores a roster for the timetable as ?name=: text/plain, one
+// "ADDRESS|USN1|USN2|..." line per address
+void handleRoster() {
+  String name = server.arg("name");
+  if (!Timetable::validName(name.c_str())) {
+    server.send(400, "application/json", "{\"error\":\"Invalid roster name\"}");
+    return;
+  }
+  String text = server.arg("plain");
+  size_t usns;
+  int code;
+  const char* error = checkRoster(text, usns, code);
+  if (error) {
+    server.send(code, "application/json", error);
+    return;
+  }
+  if (!hal::files::write(Timetable::rosterPath(name.c_str()).c_str(), text.c_str(), text.length())) {
+    server.send(500, "application/json", "{\"error\":\"Could not store roster\"}");
+    return;
+  }
+  char response[64];
+  snprintf(response, sizeof(response), "{\"roster\":\"%s\",\"usns\":%u}", name.c_str(), (unsigned)usns);
+  server.send(200, "application/json", response);
+}
+
+// Clock, periods, the next occurrence and the last one started, streamed
+// a period at a time
+void handleTimetable() {
+  char buffer[128];
+  int n = snprintf(buffer, sizeof(buffer), "{\"clock_set\":%s,\"now\":%lu,\"missed\":%u,\"periods\":[",
+                   timetable.clockSet() ? "true" : "false",
+                   (unsigned long)(timetable.clockSet() ? timetable.now() / 1000 : 0),
+                   (unsigned)timetable.missedCount());
+  server.beginResponse(200, "application/json");
+  server.sendContent(buffer, n);
+
+  for (size_t i = 0; i < timetable.size(); i++) {
+    const Timetable::Period& period = timetable[i];
+    char days[16] = "";
+    size_t length = 0;
+    for (int day = 0; day < 7; day++) {
+      if (period.days & (1 << day)) length += snprintf(days + length, sizeof(days) - length, length ? ",%d" : "%d", day);
+    }
+    n = snprintf(buffer, sizeof(buffer), "%s{\"days\":[%s],\"start\":\"%02u:%02u\",\"roster\":\"%s\"}",
+                 i ? "," : "", days, (unsigned)(period.start / 60), (unsigned)(period.start % 60), period.roster);
+    server.sendContent(buffer, n);
+  }
+
+  uint32_t minute;
+  int next = timetable.next(minute);
+  if (next >= 0) {
+    n = snprintf(buffer, sizeof(buffer), "],\"next\":{\"roster\":\"%s\",\"at\":%lu}",
+                 timetable[next].roster, (unsigned long)minute * 60);
+  } else {
+    n = snprintf(buffer, sizeof(buffer), "],\"next\":null");
+  }
+  server.sendContent(buffer, n);
+
+  const Timetable::Dispatch& last = timetable.last();
+  if (last.minute) {
+    n = snprintf(buffer, sizeof(buffer), ",\"last\":{\"roster\":\"%s\",\"at\":%lu,\"late_ms\":%u}}",
+                 last.roster, (unsigned long)last.minute * 60, (unsigned)last.lateMs);
+  } else {
+    n = snprintf(buffer, sizeof(buffer), ",\"last\":null}");
+  }
+  server.sendContent(buffer, n);
+  server.endResponse();
+}
+
+// {"now":<optional, as for /time>,"periods":[{"days":[1,2,3,4,5],"start":"09:00","roster":"cs3a"},...]}
+// Days are 0 (Sunday) to 6. Rosters must be stored with POST /rosters first.
+void handleSetTimetable() {
+  String body = server.arg("plain");
+  DynamicJsonDocument doc(body.length() * 2 + 256);
+  if (deserializeJson(doc, body.c_str(), body.length())) {
+    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+    return;
+  }
+  JsonArray list = doc["periods"].as<JsonArray>();
+  if (list.size() > Timetable::MAX_PERIODS) {
+    server.send(413, "application/json", "{\"error\":\"Too many periods\"}");
+    return;
+  }
+
+  std::vector<Timetable::Period> periods(list.size());
+  size_t count = 0;
+  for (JsonObject item : list) {
+    Timetable::Period& period = periods[count++];
+    const char* roster = item["roster"] | "";
+    // "H:MM" or "HH:MM" and nothing after it: %n marks where the minutes
+    // start and end, so "9", "9:5" and "09:00abc" are all rejected
+    const char* start = item["start"] | "";
+    unsigned hours = 24, minutes = 0;
+    int minutesAt = 0, end = 0;
+    if (!isdigit((unsigned char)start[0]) ||
+        sscanf(start, "%u:%n%u%n", &hours, &minutesAt, &minutes, &end) != 2 ||
+        end != minutesAt + 2 || start[end] != '\0' || !isdigit((unsigned char)start[minutesAt])) {
+      hours = 24;
+    }
+    period.days = 0;
+    for (JsonVariant value : item["days"].as<JsonArray>()) {
+      int day = value.as<int>();
+      if (day >= 0 && day < 7) period.days |= 1 << day;
+    }
+    if (hours >= 24 || minutes >= 60 || period.days == 0 || !Timetable::validName(roster)) {
+      server.send(400, "application/json", "{\"error\":\"Expected days [0-6], start HH:MM and a roster name\"}");
+      return;
+    }
+    if (!hal::files::exists(Timetable::rosterPath(roster).c_str())) {
+      server.send(400, "application/json", "{\"error\":\"Unknown roster\"}");
+      return;
+    }
+    period.start = hours * 60 + minutes;
+    strcpy(period.roster, roster);
+  }
+
+  if (doc["now"].is<uint32_t>()) {
+    timetable.setClock(doc["now"].as<uint32_t>());
+  }
+  if (!timetable.setPeriods(periods.data(), count)) {
+    server.send(500, "application/json", "{\"error\":\"Could not store timetable\"}");
+    return;
+  }
+  handleTimetable();
+}
+
+// Starts the due period's session as if its roster had been POSTed to /start
+void pollTimetable() {
+  int index = timetable.due(hal::millis());
+  if (index < 0) return;
+
+  String name = timetable[index].roster;
+  String roster;
+  int code;
+  const char* error = "{\"error\":\"Roster not found\"}";
+  if (hal::files::read(Timetable::rosterPath(name.c_str()).c_str(), roster)) {
+    error = loadRosterLines(roster, code);
+  }
+  timetable.dispatched(hal::millis());
+  if (error) {
+    debugPrint("Scheduled roster '" + name + "' not started: " + error);
+    return;
+  }
+
+  checkpoint.startHash = Checkpoint::hash(roster.c_str(), roster.length());
+  strcpy(sessionPeriod, name.c_str());
+  String reference = "@" + name;
+  if (!hal::files::write(START_FILE, reference.c_str(), reference.length())) {
+    debugPrint("Task not saved, this session cannot resume after a reset");
+  }
+
+  const Timetable::Dispatch& last = timetable.last();
+  debugPrint("Scheduled roster '" + name + "' started " + String(last.lateMs) + " ms after its start time");
+  if (events.hasSubscribers()) {
+    char data[64];
+    snprintf(data, sizeof(data), "{\"roster\":\"%s\",\"late_ms\":%u}", last.roster, (unsigned)last.lateMs);
+    events.publish("scheduled", data);
+  }
+  transitionToActive();
+}
+
 // ==================== STATE TRANSITIONS ====================
 void transitionToHalt() {
+  if (ackCheckPending) {
+    ackCheckPending = false;
+    if (link101.baud() != UART_BAUD_RATE) link101.sendFrame("!R");  // Release never went out
+  }
   currentState = HALT;
-  taskData.clear();
-  responseData.clear();
-  pendingAddresses.clear();
+  Checkpoint::clear();
+  Metrics::sessionDuration.observe(hal::millis() - sessionStartTime);
+  setLinkRate(UART_BAUD_RATE);  // Slaves drop back on their own after replying
+  DEBUG.println("[HALT] Session arena high water: " + String(session.highWater()) + " bytes");
+  session.reset();
   uartBuffer101 = "";
   uartBuffer102 = "";
+  publishState();
+#if TRACE_FLUSH
+  if (!Trace::save(TRACE_FILE)) debugPrint("Trace not saved to flash");
+#endif
   debugPrint("==> Transitioned to HALT state");
 }
 
 void transitionToActive() {
   currentState = ACTIVE;
+  sessionStartTime = hal::millis();
+  Metrics::sessions++;
+  saveCheckpoint();
+  publishState();
+  Profiler::reset();  // Per-session profile
   debugPrint("==> Transitioned to ACTIVE state");
 }
 
 void transitionToWait() {
   currentState = WAIT;
-  waitStartTime = millis();
+  waitStartTime = hal::millis();
+  saveCheckpoint();
+  publishState();
   debugPrint("==> Transitioned to WAIT state");
-  debugPrint("Waiting for responses from " + String(pendingAddresses.size()) + " addresses");
-  debugPrint("WAIT timeout set to 120 seconds");
+  debugPrint("Waiting for responses from " + String(session.pendingCount()) + " addresses");
+  debugPrint("WAIT timeout set to " + String(waitTimeout() / 1000) + " seconds");
+}
+
+// WAIT_TIMEOUT, or the longest section window plus WAIT_GRACE if that is
+// later: the slave only replies for a section once its window has ended
+unsigned long waitTimeout() {
+  unsigned long timeout = WAIT_TIMEOUT;
+  for (size_t i = 0; i < session.size(); i++) {
+    unsigned long window = session[i].window * 1000UL + WAIT_GRACE;
+    if (window > timeout) timeout = window;
+  }
+  return timeout;
 }
 
 // ==================== UART COMMUNICATION ====================
 
-// Send USNs to a specific address via UART
-// Format: <ADDRESS|USN1|USN2|USN3|...>
-void sendUSNsToAddress(const String& address, const std::vector<String>& usns) {
+// Roster frames are written to the link piece by piece (see RosterWriter.h)
+// rather than built in a String first. frameBytes counts what one frame has
+// written, or would write.
+size_t frameBytes = 0;
+
+void countFrame(const char*, size_t length) { frameBytes += length; }
+
+void writeFrame(const char* data, size_t length) {
+  link101.write(data, length);
+  frameBytes += length;
+}
+
+// All rosters in one broadcast frame on the shared TX line (see UartLink.h),
+// so dispatch is a single transfer however many rooms the task has:
+// <*|N|ADDR1:offset:length|...|payload>
+void broadcastRosters() {
+  PROFILE_ZONE(ZONE_DISPATCH);
   blinkLEDHalfBrightness(4); // Blink four times at half brightness when sending via UART
-  String message = "";
-  message += START_MARKER;
-  message += address;
 
-  for (const String& usn : usns) {
-    message += SEPARATOR;
-    message += usn;
+  // Each slice is measured first, since the directory ahead of the payload
+  // gives its offset. A slice leaves out its leading separator, so it reads
+  // like the fields after ADDR|.
+  size_t sliceLengths[SessionTable::MAX_ADDRESSES];
+  size_t slaves = 0;
+  size_t plainLength = 0;
+  bool frontCoded = false;
+  for (size_t i = 0; i < session.size(); i++) {
+    const char* address = session[i].address;
+    if (session.find(address) != (int)i) continue;  // Sent with the address's first entry
+    frameBytes = 0;
+    if (RosterWriter::writeAddress(session, address, SEPARATOR, ROSTER_FRONT_CODING, countFrame, plainLength)) {
+      frontCoded = true;
+    }
+    sliceLengths[slaves++] = frameBytes;
   }
 
-  message += END_MARKER;
+  frameBytes = 0;
+  char field[48];
+  int n = snprintf(field, sizeof(field), "%c%c%c%u", START_MARKER, UartLink::BROADCAST_CHAR, SEPARATOR,
+                   (unsigned)slaves);
+  writeFrame(field, n);
+  size_t offset = 0;
+  for (size_t i = 0, slave = 0; i < session.size(); i++) {
+    const char* address = session[i].address;
+    if (session.find(address) != (int)i) continue;
+    size_t length = sliceLengths[slave++];
+    n = snprintf(field, sizeof(field), "%c%s:%u:%u", SEPARATOR, address, (unsigned)(length > 0 ? offset + 1 : offset),
+                 (unsigned)(length > 0 ? length - 1 : 0));
+    writeFrame(field, n);
+    offset += length;
+  }
+  writeFrame(&SEPARATOR, 1);
+  size_t unused = 0;
+  for (size_t i = 0; i < session.size(); i++) {
+    const char* address = session[i].address;
+    if (session.find(address) != (int)i) continue;
+    RosterWriter::writeAddress(session, address, SEPARATOR, ROSTER_FRONT_CODING, writeFrame, unused);
+  }
+  writeFrame(&END_MARKER, 1);
+  link101.flush();
+  DEBUG.println("[ACTIVE] Broadcast roster for " + String(slaves) + " slaves: " + String(frameBytes) +
+                 " bytes (" + (frontCoded ? "front-coded" : "plain") + " rosters, plain would be " +
+                 String(plainLength) + ")");
+  Metrics::txBytes += frameBytes;
+  Metrics::txFrames++;
+}
 
-  // Send via SoftwareSerial
-  softSerial.print(message);
-  softSerial.flush();
+// Send USNs to a specific address via UART, for a slave that did not
+// acknowledge the broadcast
+// Format: <ADDRESS|USN1|USN2|USN3|...>
+// Front-coded: <ADDRESS|~F|TOKEN1|TOKEN2|...>
+void sendUSNsToAddress(const char* address) {
+  PROFILE_ZONE(ZONE_DISPATCH);
+  // Send via the shared TX line
+  frameBytes = 0;
+  writeFrame(&START_MARKER, 1);
+  writeFrame(address, strlen(address));
+  size_t plainLength = strlen(address) + 2;
+  bool frontCoded =
+      RosterWriter::writeAddress(session, address, SEPARATOR, ROSTER_FRONT_CODING, writeFrame, plainLength);
+  writeFrame(&END_MARKER, 1);
+  link101.flush();
+  DEBUG.println("[WAIT] Roster for " + String(address) + ": " + String(frameBytes) +
+                 " bytes (" + (frontCoded ? "front-coded" : "plain") + ", plain would be " +
+                 String(plainLength) + ")");
+  Metrics::txBytes += frameBytes;
+  Metrics::txFrames++;
+}
+
+// A slave that has not acknowledged its roster by now missed the broadcast;
+// it gets the roster again on its own. Idle slaves are released after that,
+// since one that missed the broadcast is still at the negotiated rate.
+void resendUnacknowledged() {
+  for (size_t i = 0; i < session.size(); i++) {
+    const char* address = session[i].address;
+    if (session.find(address) != (int)i) continue;
+    bool acked = false;
+    bool pending = false;
+    for (size_t j = i; j < session.size(); j++) {
+      if (strcmp(session[j].address, address) != 0) continue;
+      acked = acked || session[j].acked;
+      pending = pending || session[j].pending;
+    }
+    if (pending && !acked) {
+      debugPrint("No ACK from " + String(address) + ", sending its roster again");
+      Metrics::rosterResends++;
+      sendUSNsToAddress(address);
+    }
+  }
+  if (link101.baud() != UART_BAUD_RATE) {
+    link101.sendFrame("!R");  // Slaves that were not addressed drop back to base rate
+  }
+}
 
-  // Debug info (won't print during ACTIVE/WAIT states)
-  // debugPrint("Sent to " + address + ": " + message);
+// Marks every entry of the address as having its roster
+void acknowledge(const char* address, size_t len) {
+  for (size_t i = 0; i < session.size(); i++) {
+    if (strncmp(session[i].address, address, len) == 0 && session[i].address[len] == '\0') {
+      session[i].acked = true;
+    }
+  }
 }
 
-// Process incoming UART data for both RVU101 (Serial) and RVU102 (Serial1)
+// Process incoming UART data for both RVU101 (link101) and RVU102 (link102)
 void processUARTData() {
   // Only process if in WAIT state
   if (currentState != WAIT) {
-    Serial.println("[processUARTData] Not in WAIT state, skipping. Current state: " + String(currentState));
+    DEBUG.println("[processUARTData] Not in WAIT state, skipping. Current state: " + String(currentState));
     return;
   }
 
-  Serial.println("[processUARTData] In WAIT state, checking for data...");
+  PROFILE_ZONE(ZONE_UART_RX);
+  DEBUG.println("[processUARTData] In WAIT state, checking for data...");
 
   // RVU101 (SoftwareSerial)
-  if (taskData.count("RVU101")) {
-    Serial.println("[processUARTData] RVU101 in task list, checking softSerial...");
-    int available = softSerial.available();
-    Serial.println("[processUARTData] softSerial.available() = " + String(available));
+  if (session.find("RVU101") >= 0) {
+    DEBUG.println("[processUARTData] RVU101 in task list, checking link101...");
+    int available = link101.available();
+    DEBUG.println("[processUARTData] link101.available() = " + String(available));
+    Metrics::Link& counters = Metrics::links[LINK_RVU101];
     
-    while (softSerial.available() > 0) {
-      char c = softSerial.read();
-      Serial.print("[RVU101] Read char: ");
-      Serial.println(c);
+    while (link101.available() > 0) {
+      char c = link101.read();
+      DEBUG.print("[RVU101] Read char: ");
+      DEBUG.println(c);
+      counters.rxBytes++;
       
       if (c == START_MARKER) {
-        Serial.println("[RVU101] START_MARKER detected!");
+        DEBUG.println("[RVU101] START_MARKER detected!");
+        if (receiving101) counters.framingErrors++;  // Previous frame never ended
         receiving101 = true;
         uartBuffer101 = "";
       } else if (c == END_MARKER && receiving101) {
-        Serial.println("[RVU101] END_MARKER detected!");
-        Serial.println("[RVU101] Buffer contents: " + uartBuffer101);
+        DEBUG.println("[RVU101] END_MARKER detected!");
+        DEBUG.print("[RVU101] Buffer contents: ");
+        DEBUG.println(uartBuffer101);
         receiving101 = false;
+        counters.rxFrames++;
         blinkLED(1); // Blink once when receiving from UART
-        parseReceivedMessage(uartBuffer101);
+        int index = parseReceivedMessage(uartBuffer101);
+        if (index >= 0) saveReply(index, uartBuffer101);
         uartBuffer101 = "";
       } else if (receiving101) {
         uartBuffer101 += c;
-        Serial.println("[RVU101] Buffer length: " + String(uartBuffer101.length()));
-        if (uartBuffer101.length() > 1024) {
-          Serial.println("[RVU101] Buffer overflow! Resetting...");
+        DEBUG.println("[RVU101] Buffer length: " + String(uartBuffer101.length()));
+        if (uartBuffer101.length() > MAX_REPLY_FRAME) {
+          DEBUG.println("[RVU101] Buffer overflow! Resetting...");
           uartBuffer101 = "";
           receiving101 = false;
+          counters.overflowResets++;
         }
+      } else if (c == END_MARKER) {
+        counters.framingErrors++;  // END without a START
       }
     }
   } else {
-    Serial.println("[processUARTData] RVU101 NOT in task list");
+    DEBUG.println("[processUARTData] RVU101 NOT in task list");
   }
 
   // RVU102 (SoftwareSerial2)
-  if (taskData.count("RVU102")) {
-    Serial.println("[processUARTData] RVU102 in task list, checking softSerial2...");
-    int available = softSerial2.available();
-    Serial.println("[processUARTData] softSerial2.available() = " + String(available));
+  if (session.find("RVU102") >= 0) {
+    DEBUG.println("[processUARTData] RVU102 in task list, checking link102...");
+    int available = link102.available();
+    DEBUG.println("[processUARTData] link102.available() = " + String(available));
+    Metrics::Link& counters = Metrics::links[LINK_RVU102];
     
-    while (softSerial2.available() > 0) {
-      char c = softSerial2.read();
-      Serial.print("[RVU102] Read char: ");
-      Serial.println(c);
+    while (link102.available() > 0) {
+      char c = link102.read();
+      DEBUG.print("[RVU102] Read char: ");
+      DEBUG.println(c);
+      counters.rxBytes++;
       
       if (c == START_MARKER) {
-        Serial.println("[RVU102] START_MARKER detected!");
+        DEBUG.println("[RVU102] START_MARKER detected!");
+        if (receiving102) counters.framingErrors++;  // Previous frame never ended
         receiving102 = true;
         uartBuffer102 = "";
       } else if (c == END_MARKER && receiving102) {
-        Serial.println("[RVU102] END_MARKER detected!");
-        Serial.println("[RVU102] Buffer contents: " + uartBuffer102);
+        DEBUG.println("[RVU102] END_MARKER detected!");
+        DEBUG.print("[RVU102] Buffer contents: ");
+        DEBUG.println(uartBuffer102);
         receiving102 = false;
+        counters.rxFrames++;
         blinkLED(1); // Blink once when receiving from UART
-        parseReceivedMessage(uartBuffer102);
+        int index = parseReceivedMessage(uartBuffer102);
+        if (index >= 0) saveReply(index, uartBuffer102);
         uartBuffer102 = "";
       } else if (receiving102) {
         uartBuffer102 += c;
-        Serial.println("[RVU102] Buffer length: " + String(uartBuffer102.length()));
-        if (uartBuffer102.length() > 1024) {
-          Serial.println("[RVU102] Buffer overflow! Resetting...");
+        DEBUG.println("[RVU102] Buffer length: " + String(uartBuffer102.length()));
+        if (uartBuffer102.length() > MAX_REPLY_FRAME) {
+          DEBUG.println("[RVU102] Buffer overflow! Resetting...");
           uartBuffer102 = "";
           receiving102 = false;
+          counters.overflowResets++;
         }
+      } else if (c == END_MARKER) {
+        counters.framingErrors++;  // END without a START
       }
     }
   } else {
-    Serial.println("[processUARTData] RVU102 NOT in task list");
+    DEBUG.println("[processUARTData] RVU102 NOT in task list");
   }
 // End of processUARTData
 }
 
 // Parse received message and extract address and USNs
 // Format: ADDRESS|USN1|USN2|USN3|...
-void parseReceivedMessage(const String& message) {
-  Serial.println("\n[parseReceivedMessage] ===== START PARSING =====");
-  Serial.println("[parseReceivedMessage] Raw message: " + message);
-  Serial.println("[parseReceivedMessage] Message length: " + String(message.length()));
-  Serial.println("[parseReceivedMessage] Current state: " + String(currentState));
+// Returns the index of the session entry that took it, or -1
+int parseReceivedMessage(const String& message) {
+  PROFILE_ZONE(ZONE_PARSE_REPLY);
+  DEBUG.println("\n[parseReceivedMessage] ===== START PARSING =====");
+  DEBUG.println("[parseReceivedMessage] Raw message: " + message);
+  DEBUG.println("[parseReceivedMessage] Message length: " + String(message.length()));
+  DEBUG.println("[parseReceivedMessage] Current state: " + String(currentState));
   
   if (currentState != WAIT) {
-    Serial.println("[parseReceivedMessage] ERROR: Not in WAIT state, ignoring message!");
-    return;  // Only process messages in WAIT state
+    DEBUG.println("[parseReceivedMessage] ERROR: Not in WAIT state, ignoring message!");
+    return -1;  // Only process messages in WAIT state
   }
-  
-  Serial.println("[parseReceivedMessage] Pending addresses BEFORE parsing:");
-  for (const String& addr : pendingAddresses) {
-    Serial.println("  - " + addr);
+
+  // <!K|ADDR>: the slave has its roster (see UartLink.h)
+  if (message.length() > 3 && message[0] == UartLink::CONTROL_CHAR && message[1] == 'K') {
+    DEBUG.println("[parseReceivedMessage] Roster acknowledged by " + message.substring(3));
+    acknowledge(message.c_str() + 3, message.length() - 3);
+    return -1;
   }
   
-  std::vector<String> parts;
-  int startIdx = 0;
-  
-  // Split by separator
-  for (int i = 0; i <= message.length(); i++) {
-    if (i == message.length() || message[i] == SEPARATOR) {
-      if (i > startIdx) {
-        parts.push_back(message.substring(startIdx, i));
-      }
-      startIdx = i + 1;
+  DEBUG.println("[parseReceivedMessage] Pending addresses BEFORE parsing:");
+  for (size_t i = 0; i < session.size(); i++) {
+    if (session[i].pending) {
+      DEBUG.println("  - " + String(session[i].address));
     }
   }
   
-  Serial.println("[parseReceivedMessage] Split into " + String(parts.size()) + " parts");
-  for (size_t i = 0; i < parts.size(); i++) {
-    Serial.println("  Part[" + String(i) + "]: " + parts[i]);
-  }
+  // First part is address; split in place without copying the message
+  const char* data = message.c_str();
+  size_t length = message.length();
+  size_t pos = 0;
+  while (pos < length && data[pos] == SEPARATOR) pos++;
+  size_t addressEnd = pos;
+  while (addressEnd < length && data[addressEnd] != SEPARATOR) addressEnd++;
   
-  if (parts.empty()) {
-    Serial.println("[parseReceivedMessage] ERROR: No parts found, message empty!");
-    return;
+  if (addressEnd == pos) {
+    DEBUG.println("[parseReceivedMessage] ERROR: No parts found, message empty!");
+    return -1;
   }
   
-  // First part is address
-  String address = parts[0];
-  Serial.println("[parseReceivedMessage] Extracted address: '" + address + "'");
-  
-  // Check if this address is in our pending list
-  bool found = false;
-  Serial.println("[parseReceivedMessage] Searching for address in pendingAddresses...");
-  for (auto it = pendingAddresses.begin(); it != pendingAddresses.end(); ++it) {
-    Serial.println("[parseReceivedMessage] Comparing '" + address + "' with '" + *it + "'");
-    if (*it == address) {
-      Serial.println("[parseReceivedMessage] MATCH FOUND! Removing from pending...");
-      pendingAddresses.erase(it);
-      found = true;
-      break;
+  String address = message.substring(pos, addressEnd);
+  DEBUG.println("[parseReceivedMessage] Extracted address: '" + address + "'");
+
+  // A named section's reply carries its tag next
+  const char* section = "";
+  size_t sectionLen = 0;
+  size_t usnStart = addressEnd + 1;
+  if (addressEnd < length) {
+    size_t tagEnd = usnStart;
+    while (tagEnd < length && data[tagEnd] != SEPARATOR) tagEnd++;
+    if (RosterCodec::isSectionTag(data + usnStart, tagEnd - usnStart, section, sectionLen)) {
+      usnStart = tagEnd + 1;
+      DEBUG.println("[parseReceivedMessage] Section: '" + String(section).substring(0, sectionLen) + "'");
     }
   }
   
-  if (!found) {
-    Serial.println("[parseReceivedMessage] ERROR: Address '" + address + "' NOT found in pending list!");
-    Serial.println("[parseReceivedMessage] This message will be IGNORED.");
-    return;  // Unknown address, ignore
+  // Check if this address is in our pending list
+  DEBUG.println("[parseReceivedMessage] Searching for address in pending list...");
+  int index = session.find(data + pos, addressEnd - pos, section, sectionLen);
+  if (index < 0 || !session[index].pending) {
+    DEBUG.println("[parseReceivedMessage] ERROR: Address '" + address + "' NOT found in pending list!");
+    DEBUG.println("[parseReceivedMessage] This message will be IGNORED.");
+    return -1;  // Unknown address, ignore
   }
   
-  Serial.println("[parseReceivedMessage] Address '" + address + "' removed from pending.");
+  SessionTable::Entry& entry = session[index];
+  entry.pending = false;
+  entry.responded = true;
+  acknowledge(entry.address, strlen(entry.address));  // A reply means the roster got there
+  DEBUG.println("[parseReceivedMessage] Address '" + address + "' removed from pending.");
   
   // Rest are USNs
-  std::vector<String> receivedUSNs;
-  for (size_t i = 1; i < parts.size(); i++) {
-    receivedUSNs.push_back(parts[i]);
+  session.beginList(entry.response);
+  size_t startIdx = usnStart;
+  for (size_t i = startIdx; i <= length; i++) {
+    if (i == length || data[i] == SEPARATOR) {
+      if (i > startIdx && !session.appendUSN(entry.response, data + startIdx, i - startIdx)) {
+        DEBUG.println("[parseReceivedMessage] ERROR: Session arena full, reply truncated!");
+        break;
+      }
+      startIdx = i + 1;
+    }
   }
   
-  Serial.println("[parseReceivedMessage] Extracted " + String(receivedUSNs.size()) + " USNs");
-  
-  responseData[address] = receivedUSNs;
-  Serial.println("[parseReceivedMessage] Stored " + String(receivedUSNs.size()) + " USNs for address '" + address + "'");
+  DEBUG.println("[parseReceivedMessage] Stored " + String(entry.response.count) + " USNs for address '" + address + "'");
+
+  if (events.hasSubscribers()) {
+    char data[128];
+    snprintf(data, sizeof(data), "{\"address\":\"%s\",\"section\":\"%s\",\"usns\":%u,\"pending\":%u}",
+             entry.address, entry.section, (unsigned)entry.response.count, (unsigned)session.pendingCount());
+    events.publish("reply", data);
+  }
   
-  Serial.println("[parseReceivedMessage] Pending addresses AFTER parsing:");
-  for (const String& addr : pendingAddresses) {
-    Serial.println("  - " + addr);
+  DEBUG.println("[parseReceivedMessage] Pending addresses AFTER parsing:");
+  for (size_t i = 0; i < session.size(); i++) {
+    if (session[i].pending) {
+      DEBUG.println("  - " + String(session[i].address));
+    }
   }
-  Serial.println("[parseReceivedMessage] Pending count: " + String(pendingAddresses.size()));
+  DEBUG.println("[parseReceivedMessage] Pending count: " + String(session.pendingCount()));
   
-  Serial.println("[parseReceivedMessage] Response data stored:");
-  for (const auto& entry : responseData) {
-    Serial.println("  Address: " + entry.first + " -> " + String(entry.second.size()) + " USNs");
+  DEBUG.println("[parseReceivedMessage] Response data stored:");
+  for (size_t i = 0; i < session.size(); i++) {
+    if (session[i].responded) {
+      DEBUG.println("  Address: " + String(session[i].address) + " -> " + String(session[i].response.count) + " USNs");
+    }
   }
   
-  Serial.println("[parseReceivedMessage] ===== END PARSING =====\n");
+  DEBUG.println("[parseReceivedMessage] ===== END PARSING =====\n");
+  return index;
+}
+
+// ==================== SESSION CHECKPOINT ====================
+void saveCheckpoint() {
+  checkpoint.state = currentState;
+  checkpoint.linkBaud = link101.baud();
+  checkpoint.sessionElapsed = hal::millis() - sessionStartTime;
+  checkpoint.waitElapsed = currentState == WAIT ? hal::millis() - waitStartTime : 0;
+  checkpoint.pending = 0;
+  checkpoint.responded = 0;
+  for (size_t i = 0; i < session.size(); i++) {
+    if (session[i].pending) checkpoint.pending |= 1 << i;
+    if (session[i].responded) checkpoint.responded |= 1 << i;
+  }
+  Checkpoint::save(CHECKPOINT_VERSION, &checkpoint, sizeof(checkpoint));
+  lastCheckpoint = hal::millis();
+}
+
+String replyFile(int index) { return "/reply" + String(index); }
+
+// The slave has gone back to HALT once it replied, so its reply only
+// survives a reset if it is in flash
+void saveReply(int index, const String& message) {
+  if (!hal::files::write(replyFile(index).c_str(), message.c_str(), message.length())) {
+    debugPrint("Reply not saved, it will be lost if the master resets");
+  }
+  saveCheckpoint();
+}
+
+// START_FILE holds the /start body, or "@<name>" for a timetable roster
+bool readStart(String& body) {
+  if (!hal::files::read(START_FILE, body)) return false;
+  sessionPeriod[0] = '\0';
+  if (body.length() == 0 || body[0] != '@') return true;
+  String name = body.substring(1);
+  snprintf(sessionPeriod, sizeof(sessionPeriod), "%s", name.c_str());
+  return hal::files::read(Timetable::rosterPath(name.c_str()).c_str(), body);
+}
+
+// After a reset mid-session: rebuild the tasks from START_FILE, replay the
+// replies kept in flash and continue with the time that was left. A session
+// caught in ACTIVE is simply dispatched again; slaves that already have
+// their roster ignore it.
+bool resumeSession() {
+  if (Checkpoint::load(CHECKPOINT_VERSION, &checkpoint, sizeof(checkpoint)) != sizeof(checkpoint)) {
+    return false;
+  }
+
+  String body;
+  int code;
+  if (!readStart(body) ||
+      Checkpoint::hash(body.c_str(), body.length()) != checkpoint.startHash ||
+      loadSession(body, code) != nullptr) {
+    debugPrint("Checkpointed task not in flash, dropping session");
+    session.reset();
+    Checkpoint::clear();
+    return false;
+  }
+
+  sessionStartTime = hal::millis() - checkpoint.sessionElapsed;
+  setLinkRate(checkpoint.linkBaud);
+  if (checkpoint.state == WAIT) {
+    currentState = WAIT;
+    waitStartTime = hal::millis() - checkpoint.waitElapsed;
+    for (size_t i = 0; i < session.size(); i++) {
+      session[i].pending = (checkpoint.pending | checkpoint.responded) & (1 << i);
+      session[i].acked = true;  // Dispatched before the reset; only the release is left
+    }
+    ackCheckPending = true;
+    String reply;
+    for (size_t i = 0; i < session.size(); i++) {
+      if ((checkpoint.responded & (1 << i)) && hal::files::read(replyFile(i).c_str(), reply)) {
+        parseReceivedMessage(reply);
+      }
+    }
+  } else {
+    currentState = ACTIVE;
+  }
+  lastCheckpoint = hal::millis();
+  Trace::state(currentState);
+
+  debugPrint("Resumed " + String(currentState == WAIT ? "WAIT" : "ACTIVE") + " session: " +
+             String(session.size()) + " addresses, " + String(session.respondedCount()) +
+             " replies, " + String(checkpoint.sessionElapsed / 1000) + " s in, link at " +
+             String(checkpoint.linkBaud) + " baud");
+  return true;
+}
+
+// ==================== LINK RATE NEGOTIATION ====================
+// See UartLink.h for the control frames. Both slaves must pass the test
+// pattern for a rate to be used, since they share the TX line.
+
+void setLinkRate(uint32_t rate) {
+  link101.setBaud(rate);
+  link102.setBaud(rate);
+}
+
+// Waits for a "<!X|ADDR|value>" reply on link and checks ADDR and value
+bool expectLinkReply(UartLink& link, const char* type, const char* address,
+                     const char* value, unsigned long deadline) {
+  char frame[192];
+  while (link.readFrame(frame, sizeof(frame), deadline)) {
+    String reply = frame;
+    if (reply == String(type) + SEPARATOR + address + SEPARATOR + value) {
+      return true;
+    }
+    DEBUG.println("[LINK] Unexpected reply on " + String(address) + ": " + reply);
+  }
+  return false;
+}
+
+bool tryLinkRate(uint32_t rate) {
+  uint32_t previous = link101.baud();
+  String rateText = String(rate);
+  DEBUG.println("[LINK] Trying " + rateText + " baud");
+
+  link101.drain();
+  link102.drain();
+  link101.sendFrame(("!B|" + rateText).c_str());
+
+  unsigned long deadline = hal::millis() + LINK_REPLY_TIMEOUT;
+  bool accepted = expectLinkReply(link101, "!A", "RVU101", rateText.c_str(), deadline) &&
+                  expectLinkReply(link102, "!A", "RVU102", rateText.c_str(), deadline);
+
+  bool passed = false;
+  if (accepted) {
+    setLinkRate(rate);
+    hal::delay(5);  // Let the slaves finish switching
+    link101.drain();
+    link102.drain();
+    link101.sendFrame((String("!T|") + UartLink::TEST_PATTERN).c_str());
+    deadline = hal::millis() + LINK_REPLY_TIMEOUT;
+    passed = expectLinkReply(link101, "!E", "RVU101", UartLink::TEST_PATTERN, deadline) &&
+             expectLinkReply(link102, "!E", "RVU102", UartLink::TEST_PATTERN, deadline);
+  }
+
+  if (passed) {
+    link101.sendFrame(("!C|" + rateText).c_str());
+    DEBUG.println("[LINK] Now at " + rateText + " baud");
+    return true;
+  }
+
+  // Any slave that switched reverts once it misses the commit
+  setLinkRate(previous);
+  hal::delay(UartLink::COMMIT_TIMEOUT_MS + 50);
+  link101.drain();
+  link102.drain();
+  DEBUG.println("[LINK] " + rateText + " baud failed, staying at " + String(previous));
+  return false;
+}
+
+// Steps the link up through UartLink::RATES until one fails. The last good
+// rate is tried first, so a healthy link normally needs a single step.
+uint32_t negotiateLinkRate() {
+  PROFILE_ZONE(ZONE_LINK_NEGOTIATE);
+  static uint32_t lastGoodRate = UART_BAUD_RATE;
+  unsigned long start = hal::millis();
+
+  if (lastGoodRate == UART_BAUD_RATE || !tryLinkRate(lastGoodRate)) {
+    for (size_t i = 0; i < UartLink::RATE_COUNT; i++) {
+      if (UartLink::RATES[i] <= link101.baud()) continue;
+      if (!tryLinkRate(UartLink::RATES[i])) break;
+    }
+  }
+
+  lastGoodRate = link101.baud();
+  DEBUG.println("[LINK] Negotiated " + String(lastGoodRate) + " baud in " +
+                String(hal::millis() - start) + " ms");
+  return lastGoodRate;
 }
 
 // ==================== HTTP CLIENT - SEND RESULTS ====================
 void sendResultsToServer() {
+  PROFILE_ZONE(ZONE_UPLOAD);
   debugPrint("Sending results to server...");
   blinkLED(3); // Blink thrice when sending to /results
 
-  String payload = buildJsonPayload(responseData);
+  String payload = buildJsonPayload(session);
   debugPrint("Payload: " + payload);
 
-  WiFiClient client;
-  HTTPClient http;
+  hal::HttpClient http;
 
   String url = "http://" + String(RESULT_SERVER_IP) + ":" + String(RESULT_SERVER_PORT) + RESULT_ENDPOINT;
   debugPrint("URL: " + url);
 
-  http.begin(client, url);
-  http.addHeader("Content-Type", "application/json");
+  String response;
+  unsigned long postStart = hal::millis();
+  int httpCode = http.post(RESULT_SERVER_IP, RESULT_SERVER_PORT, RESULT_ENDPOINT,
+                           "application/json", payload, response);
+  uint32_t postMs = hal::millis() - postStart;
+  Metrics::uploads++;
+  Metrics::uploadLatency.observe(postMs);
+  if (httpCode < 200 || httpCode >= 300) {
+    Metrics::uploadFailures++;
+  }
 
-  int httpCode = http.POST(payload);
+  if (events.hasSubscribers()) {
+    char data[64];
+    snprintf(data, sizeof(data), "{\"code\":%d,\"ms\":%u}", httpCode, (unsigned)postMs);
+    events.publish("upload", data);
+  }
 
   if (httpCode > 0) {
     debugPrint("HTTP Response: " + String(httpCode));
-    String response = http.getString();
     debugPrint("Response: " + response);
   } else {
-    debugPrint("HTTP Error: " + http.errorToString(httpCode));
+    debugPrint("HTTP Error: " + hal::HttpClient::errorToString(httpCode));
   }
-
-  http.end();
 }
 
-String buildJsonPayload(const std::map<String, std::vector<String>>& data) {
-  StaticJsonDocument<2048> doc;
+String buildJsonPayload(const SessionTable& table) {
+  // Sized from the replies: a reply can hold a whole roster
+  size_t capacity = JSON_OBJECT_SIZE(1);
+  size_t responded = 0;
+  for (size_t i = 0; i < table.size(); i++) {
+    if (!table[i].responded) continue;
+    responded++;
+    capacity += JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(table[i].response.count);
+  }
+  capacity += JSON_ARRAY_SIZE(responded);
+  DynamicJsonDocument doc(capacity);
   JsonArray results = doc.createNestedArray("results");
   
-  for (const auto& entry : data) {
+  // Arena strings outlive the document, so they are added by pointer, not copied
+  for (size_t i = 0; i < table.size(); i++) {
+    const SessionTable::Entry& entry = table[i];
+    if (!entry.responded) continue;
+
     JsonObject item = results.createNestedObject();
-    item["address"] = entry.first;
+    item["address"] = entry.address;
+    if (entry.section[0] != '\0') item["section"] = entry.section;
     
     JsonArray usns = item.createNestedArray("usns");
-    for (const String& usn : entry.second) {
+    SessionTable::Iterator it(table, entry.response);
+    const char* usn;
+    size_t usnLen;
+    while (it.next(usn, usnLen)) {
       usns.add(usn);
     }
   }
@@ -0,0 +1,179 @@
+// RosterCodec round trips: pio test -e native
+
+#include <RosterCodec.h>
+#include <unity.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+typedef std::vector<std::string> Usns;
+
+static std::string out;
+static void append(const char* data, size_t length) { out.append(data, length); }
+
+// Encodes usns and decodes the result the way a slave reads a frame
+static std::string encodeAll(const Usns& usns, bool& ok) {
+  std::vector<RosterCodec::UsnRef> refs;
+  for (const std::string& usn : usns) refs.push_back({usn.data(), usn.size()});
+  out.clear();
+  ok = RosterCodec::encode(refs.data(), refs.size(), '|', append);
+  return out;
+}
+
+static bool decodeAll(const std::string& tokens, Usns& out) {
+  RosterCodec::Decoder decoder;
+  auto emit = [&](const char* usn, size_t len) { out.push_back(std::string(usn, len)); };
+  size_t start = 0;
+  while (start < tokens.size()) {
+    size_t end = tokens.find('|', start);
+    if (end == std::string::npos) end = tokens.size();
+    if (!decoder.push(tokens.data() + start, end - start, emit)) return false;
+    start = end + 1;
+  }
+  return true;
+}
+
+static std::string roundTrip(Usns usns) {
+  bool ok;
+  std::string tokens = encodeAll(usns, ok);
+  TEST_ASSERT_TRUE(ok);
+  Usns decoded;
+  TEST_ASSERT_TRUE(decodeAll(tokens, decoded));
+  std::sort(usns.begin(), usns.end());
+  TEST_ASSERT_EQUAL(usns.size(), decoded.size());
+  for (size_t i = 0; i < usns.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(usns[i].c_str(), decoded[i].c_str());
+  }
+  return tokens;
+}
+
+static Usns numbered(const char* prefix, int from, int to, int step) {
+  Usns usns;
+  char usn[32];
+  for (int i = from; i <= to; i += step) {
+    snprintf(usn, sizeof(usn), "%s%03d", prefix, i);
+    usns.push_back(usn);
+  }
+  return usns;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_contiguous() {
+  TEST_ASSERT_EQUAL_STRING("01RV17CS001|*59", roundTrip(numbered("1RV17CS", 1, 60, 1)).c_str());
+  // Runs stop where the suffix would carry out of its digits
+  TEST_ASSERT_EQUAL_STRING("01RV17CS998|*1", roundTrip(numbered("1RV17CS", 998, 999, 1)).c_str());
+}
+
+void test_sparse() {
+  Usns usns = numbered("1RV17CS", 3, 120, 3);
+  std::reverse(usns.begin(), usns.end());  // Sorted by the encoder
+  std::string tokens = roundTrip(usns);
+  TEST_ASSERT_TRUE(tokens.find('*') == std::string::npos);
+  TEST_ASSERT_EQUAL_STRING("01RV17CS003|96|99|812|95", tokens.substr(0, 24).c_str());
+}
+
+void test_mixed_branches() {
+  Usns usns = numbered("1RV17CS", 1, 20, 1);
+  Usns ec = numbered("1RV17EC", 5, 40, 5);
+  Usns me = numbered("1RV18ME", 1, 10, 1);
+  usns.insert(usns.begin(), ec.begin(), ec.end());
+  usns.insert(usns.end(), me.begin(), me.end());
+  usns.push_back("1RV17CS500");
+  std::string tokens = roundTrip(usns);
+  TEST_ASSERT_TRUE(tokens.find("|*19|7500|5EC005|810|95|") != std::string::npos);
+  TEST_ASSERT_TRUE(tokens.find("|48ME001|*9") != std::string::npos);
+}
+
+void test_non_numeric_suffixes() {
+  Usns usns = {"1RV17CSB", "1RV17CSA", "1RV17CS", "1RV17CSAB", "GUEST", "1RV17CS1X"};
+  std::string tokens = roundTrip(usns);
+  TEST_ASSERT_TRUE(tokens.find('*') == std::string::npos);
+  // Identical USNs share the whole of the previous one
+  roundTrip({"1RV17CS001", "1RV17CS001", "1RV17CS002"});
+}
+
+void test_empty() {
+  TEST_ASSERT_EQUAL_STRING("", roundTrip({}).c_str());
+  roundTrip({"X"});
+}
+
+void test_encode_rejects() {
+  bool ok;
+  TEST_ASSERT_EQUAL_STRING("", encodeAll({"1RV17CS001", ""}, ok).c_str());  // Nothing written
+  TEST_ASSERT_FALSE(ok);
+  encodeAll({std::string(RosterCodec::MAX_USN_LEN + 1, 'A')}, ok);
+  TEST_ASSERT_FALSE(ok);
+  encodeAll({std::string(RosterCodec::MAX_USN_LEN, 'A')}, ok);
+  TEST_ASSERT_TRUE(ok);
+}
+
+void test_malformed_tokens() {
+  const char* bad[] = {
+      "*5",                                     // Run with nothing before it
+      "01RV17CS001|*",                          // Run without a count
+      "01RV17CS001|*5x",                        // Run count not a number
+      "01RV17CS001|*70000",                     // Run count too large
+      "01RV17CS998|*2",                         // Run carries out of the digits
+      "0GUEST|*1",                              // Run after a USN with no digits
+      "3ABC",                                   // Shares a prefix with nothing
+      "0AB|3C",                                 // Shares more than the previous USN
+      "0AB|aC",                                 // Not a base-36 digit
+      "0AB||1C",                                // Empty token
+      "0AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA",  // Longer than MAX_USN_LEN
+  };
+  for (const char* tokens : bad) {
+    Usns decoded;
+    TEST_ASSERT_FALSE_MESSAGE(decodeAll(tokens, decoded), tokens);
+  }
+}
+
+void test_section_tags() {
+  const char* id;
+  size_t len;
+  TEST_ASSERT_TRUE(RosterCodec::isSectionTag("~SCS-A", 6, id, len));
+  TEST_ASSERT_EQUAL(4, len);
+  TEST_ASSERT_TRUE(RosterCodec::validSectionId(id, len));
+  TEST_ASSERT_FALSE(RosterCodec::isSectionTag("~S", 2, id, len));
+  TEST_ASSERT_FALSE(RosterCodec::isSectionTag("~F", 2, id, len));
+  TEST_ASSERT_FALSE(RosterCodec::validSectionId("CS A", 4));
+  TEST_ASSERT_FALSE(RosterCodec::validSectionId("0123456789ABCDEF", 16));
+  TEST_ASSERT_TRUE(RosterCodec::isFrontCodedTag("~F", 2));
+}
+
+void test_section_windows() {
+  const char* id;
+  size_t len;
+  uint16_t window;
+  TEST_ASSERT_TRUE(RosterCodec::isSectionTag("~SCS-A", 6, id, len, window));
+  TEST_ASSERT_EQUAL(0, window);
+  TEST_ASSERT_TRUE(RosterCodec::isSectionTag("~SLAB-B1:10800", 14, id, len, window));
+  TEST_ASSERT_EQUAL(6, len);
+  TEST_ASSERT_EQUAL(10800, window);
+  TEST_ASSERT_TRUE(RosterCodec::validSectionId(id, len));
+
+  // Bad windows stay in the ID, which is then invalid
+  const char* bad[] = {"~SA:", "~SA:0", "~SA:90s", "~SA:14401", "~SA:123456", "~SA:-5"};
+  for (const char* tag : bad) {
+    TEST_ASSERT_TRUE_MESSAGE(RosterCodec::isSectionTag(tag, strlen(tag), id, len, window), tag);
+    TEST_ASSERT_EQUAL_MESSAGE(0, window, tag);
+    TEST_ASSERT_FALSE_MESSAGE(RosterCodec::validSectionId(id, len), tag);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_contiguous);
+  RUN_TEST(test_sparse);
+  RUN_TEST(test_mixed_branches);
+  RUN_TEST(test_non_numeric_suffixes);
+  RUN_TEST(test_empty);
+  RUN_TEST(test_encode_rejects);
+  RUN_TEST(test_malformed_tokens);
+  RUN_TEST(test_section_tags);
+  RUN_TEST(test_section_windows);
+  return UNITY_END();
+}
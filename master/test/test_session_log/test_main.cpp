@@ -0,0 +1,151 @@
+// SessionLog history in flash: pio test -e native -f test_session_log
+//
+// Runs against the native HAL's flash files, in a temporary data directory.
+
+#include <Hal.h>
+#include <SessionLog.h>
+#include <SessionTable.h>
+#include <native/NativeConfig.h>
+#include <unity.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static SessionTable table;
+static SessionLog history;
+
+static int addList(const char* address, const char* section, std::initializer_list<const char*> task,
+                   std::initializer_list<const char*> reply, bool responded) {
+  int index = table.addAddress(address, strlen(address), section, strlen(section));
+  TEST_ASSERT_TRUE(index >= 0);
+  SessionTable::Entry& entry = table[index];
+  table.beginList(entry.task);
+  for (const char* usn : task) TEST_ASSERT_TRUE(table.appendUSN(entry.task, usn, strlen(usn)));
+  table.beginList(entry.response);
+  for (const char* usn : reply) TEST_ASSERT_TRUE(table.appendUSN(entry.response, usn, strlen(usn)));
+  entry.responded = responded;
+  return index;
+}
+
+// RVU101 section A replied with two of its three USNs; RVU102 never replied
+static void loadSession() {
+  table.reset();
+  addList("RVU101", "A", {"1RV17CS001", "1RV17CS002", "1RV17CS003"}, {"1RV17CS001", "1RV17CS003"}, true);
+  addList("RVU102", "", {"1RV17EC001"}, {}, false);
+}
+
+static void appendSession(uint32_t time, const char* period) {
+  for (size_t i = 0; i < table.size(); i++) {
+    TEST_ASSERT_TRUE(history.append(table, table[i], time, period));
+  }
+}
+
+void setUp() {
+  history.begin();
+  TEST_ASSERT_TRUE(history.clear());
+  loadSession();
+}
+
+void tearDown() {}
+
+void test_sessions_read_back() {
+  appendSession(1000, "cs3a");
+  TEST_ASSERT_EQUAL(2, history.size());
+
+  SessionLog::Cursor cursor;
+  TEST_ASSERT_TRUE(cursor.begin(history, "", 0));
+  SessionLog::Session session;
+  TEST_ASSERT_TRUE(cursor.next(session));
+  TEST_ASSERT_EQUAL(1000, session.time);
+  TEST_ASSERT_EQUAL_STRING("RVU101", session.address);
+  TEST_ASSERT_EQUAL_STRING("A", session.section);
+  TEST_ASSERT_EQUAL_STRING("cs3a", session.period);
+  TEST_ASSERT_EQUAL(3, session.usns);
+  TEST_ASSERT_EQUAL(2, session.present);
+  TEST_ASSERT_TRUE(session.replied);
+
+  const bool expected[] = {true, false, true};
+  for (bool present : expected) {
+    const char* usn;
+    size_t length;
+    bool marked;
+    TEST_ASSERT_TRUE(cursor.nextUsn(usn, length, marked));
+    TEST_ASSERT_EQUAL(10, length);
+    TEST_ASSERT_EQUAL(present, marked);
+  }
+
+  TEST_ASSERT_TRUE(cursor.next(session));
+  TEST_ASSERT_EQUAL_STRING("RVU102", session.address);
+  TEST_ASSERT_FALSE(session.replied);
+  TEST_ASSERT_EQUAL(0, session.present);
+  TEST_ASSERT_FALSE(cursor.next(session));
+  cursor.end();
+}
+
+void test_address_and_time_filters() {
+  appendSession(1000, "cs3a");
+  appendSession(2000, "cs3b");
+
+  SessionLog::Cursor cursor;
+  SessionLog::Session session;
+  size_t found = 0;
+  TEST_ASSERT_TRUE(cursor.begin(history, "RVU102", 0));
+  while (cursor.next(session)) {
+    TEST_ASSERT_EQUAL_STRING("RVU102", session.address);
+    found++;
+  }
+  cursor.end();
+  TEST_ASSERT_EQUAL(2, found);
+
+  TEST_ASSERT_TRUE(cursor.begin(history, "RVU101", 1500));
+  TEST_ASSERT_TRUE(cursor.next(session));
+  TEST_ASSERT_EQUAL(2000, session.time);
+  TEST_ASSERT_EQUAL_STRING("cs3b", session.period);
+  TEST_ASSERT_FALSE(cursor.next(session));
+  cursor.end();
+}
+
+// The same rosters a week later are stored once
+void test_rosters_stored_once() {
+  appendSession(1000, "cs3a");
+  size_t first = history.bytesUsed();
+  appendSession(1000 + 7 * 86400, "cs3a");
+  size_t second = history.bytesUsed() - first;
+  TEST_ASSERT_TRUE(second < first);
+
+  history.begin();  // As after a restart: the cache is rebuilt from flash
+  size_t before = history.bytesUsed();
+  appendSession(1000 + 14 * 86400, "cs3a");
+  TEST_ASSERT_EQUAL(second, history.bytesUsed() - before);
+  TEST_ASSERT_EQUAL(6, history.size());
+}
+
+// A clock set back still lists the session after the ones before it
+void test_clock_set_back() {
+  appendSession(2000, "cs3a");
+  appendSession(500, "cs3b");
+
+  SessionLog::Cursor cursor;
+  SessionLog::Session session;
+  TEST_ASSERT_TRUE(cursor.begin(history, "RVU101", 1500));
+  TEST_ASSERT_TRUE(cursor.next(session));
+  TEST_ASSERT_EQUAL_STRING("cs3a", session.period);
+  TEST_ASSERT_TRUE(cursor.next(session));
+  TEST_ASSERT_EQUAL_STRING("cs3b", session.period);
+  TEST_ASSERT_EQUAL(500, session.time);
+  cursor.end();
+}
+
+int main() {
+  char dir[] = "/tmp/test_session_log-XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+  hal::native::config().dataDir = dir;
+  hal::files::begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_sessions_read_back);
+  RUN_TEST(test_address_and_time_filters);
+  RUN_TEST(test_rosters_stored_once);
+  RUN_TEST(test_clock_set_back);
+  return UNITY_END();
+}
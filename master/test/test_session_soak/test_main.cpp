@@ -0,0 +1,146 @@
+// 1000 sessions through one SessionTable, as a day of timetable periods
+// would run them: pio test -e native -f test_session_soak -v
+//
+// Each session loads rosters, sends them through RosterWriter as the firmware
+// does (front-coded, resent to slaves that miss the broadcast), stores
+// replies and goes back to HALT. Reports heap
+// allocations and setup time per session, and fails if the arena leaks or
+// creeps: after every session's replies it must hold exactly its names,
+// rosters and replies.
+
+#include <RosterWriter.h>
+#include <SessionTable.h>
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <new>
+#include <random>
+
+static const size_t SESSIONS = 1000;
+
+static size_t allocations = 0;
+
+void* operator new(size_t bytes) {
+  allocations++;
+  void* p = malloc(bytes ? bytes : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static SessionTable table;
+static std::mt19937 rng(1);
+
+static size_t pick(size_t low, size_t high) { return low + rng() % (high - low + 1); }
+
+// Stands in for the link: keeps the last frame's bytes
+static char frame[8192];
+static size_t frameLength = 0;
+
+static void writeFrame(const char* data, size_t length) {
+  TEST_ASSERT_TRUE(frameLength + length <= sizeof(frame));
+  memcpy(frame + frameLength, data, length);
+  frameLength += length;
+}
+
+// Writes every address's rosters the way sendUSNsToAddress() does
+static void send() {
+  for (size_t i = 0; i < table.size(); i++) {
+    const char* address = table[i].address;
+    if (table.find(address) != (int)i) continue;
+    size_t used = table.bytesUsed();
+    size_t plainLength = 0;
+    frameLength = 0;
+    RosterWriter::writeAddress(table, address, '|', true, writeFrame, plainLength);
+    TEST_ASSERT_TRUE(frameLength > 0 && frameLength <= plainLength);
+    TEST_ASSERT_EQUAL(used, table.bytesUsed());
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_soak() {
+  char usn[16];
+  double setupUs = 0;
+  double worstUs = 0;
+  size_t heapAllocations = 0;
+  size_t highWater = 0;
+
+  for (size_t s = 0; s < SESSIONS; s++) {
+    // 2-4 rooms, the third with two sections; 20-50 USNs each, 70% present
+    size_t rooms = pick(2, 4);
+    size_t expected = 0;
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+
+    table.reset();
+    for (size_t r = 0; r < rooms; r++) {
+      char address[8];
+      snprintf(address, sizeof(address), "RVU1%02u", (unsigned)(r + 1));
+      size_t sections = r == 2 ? 2 : 1;
+      for (size_t k = 0; k < sections; k++) {
+        const char* section = sections == 1 ? "" : (k == 0 ? "CS-A" : "CS-B");
+        int index = table.addAddress(address, 6, section, strlen(section));
+        TEST_ASSERT_TRUE(index >= 0);
+        expected += 7 + (section[0] ? 5 : 0);
+        SessionTable::Entry& entry = table[index];
+        table.beginList(entry.task);
+        size_t count = pick(20, 50);
+        size_t first = pick(1, 400);
+        for (size_t i = 0; i < count; i++) {
+          snprintf(usn, sizeof(usn), "1RV%02uCS%03u", (unsigned)(17 + r), (unsigned)(first + i * pick(1, 2)));
+          TEST_ASSERT_TRUE(table.appendUSN(entry.task, usn, strlen(usn)));
+        }
+        expected += entry.task.bytes;
+        entry.pending = true;
+      }
+    }
+    send();
+    for (size_t resend = pick(0, 3); resend > 0; resend--) send();
+
+    for (size_t i = 0; i < table.size(); i++) {
+      SessionTable::Entry& entry = table[i];
+      table.beginList(entry.response);
+      SessionTable::Iterator it(table, entry.task);
+      const char* present;
+      size_t length;
+      while (it.next(present, length)) {
+        if (rng() % 10 < 7) TEST_ASSERT_TRUE(table.appendUSN(entry.response, present, length));
+      }
+      expected += entry.response.bytes;
+      entry.pending = false;
+      entry.responded = true;
+    }
+    TEST_ASSERT_EQUAL(expected, table.bytesUsed());
+    if (table.highWater() > highWater) highWater = table.highWater();
+    table.reset();
+
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    setupUs += us;
+    if (us > worstUs) worstUs = us;
+    heapAllocations += allocations - before;
+  }
+
+  TEST_ASSERT_EQUAL(0, table.bytesUsed());
+  TEST_ASSERT_EQUAL(0, heapAllocations);
+  TEST_ASSERT_LESS_OR_EQUAL(SessionTable::ARENA_SIZE, highWater);
+
+  char report[160];
+  snprintf(report, sizeof(report),
+           "%u sessions: %.2f heap allocations/session, setup+teardown %.1f us/session (worst %.1f us), "
+           "arena high water %u/%u bytes",
+           (unsigned)SESSIONS, (double)heapAllocations / SESSIONS, setupUs / SESSIONS, worstUs,
+           (unsigned)highWater, (unsigned)SessionTable::ARENA_SIZE);
+  TEST_MESSAGE(report);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_soak);
+  return UNITY_END();
+}
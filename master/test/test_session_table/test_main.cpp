@@ -0,0 +1,274 @@
+// SessionTable arena and budget: pio test -e native
+
+#include <RosterWriter.h>
+#include <SessionTable.h>
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+static SessionTable table;
+
+struct List {
+  const char* address;
+  const char* section;
+  size_t usns;
+  size_t usnLength;
+};
+
+static std::string usnOf(size_t i, size_t length) {
+  std::string usn = std::to_string(i);
+  return std::string(length - usn.size(), 'U') + usn;
+}
+
+// Arena a roster of these lists may need, counted the way checkRoster() in
+// main.cpp counts an upload (RVU101 and RVU102 reserved)
+static size_t budget(const std::vector<List>& lists) {
+  size_t names = 2 * sizeof("RVU101");
+  size_t bytes = 0;
+  size_t largest = 0;
+  for (const List& list : lists) {
+    names += strlen(list.address) + 1 + (list.section[0] ? strlen(list.section) + 1 : 0);
+    bytes += list.usns * (list.usnLength + 2);
+    if (list.usns > largest) largest = list.usns;
+  }
+  return SessionTable::sessionBytes(names, bytes, largest, sizeof(RosterCodec::UsnRef));
+}
+
+// Grows the first list to the largest roster the budget accepts
+static void fill(std::vector<List>& lists) {
+  while (budget(lists) <= SessionTable::ARENA_SIZE) lists[0].usns++;
+  lists[0].usns--;
+}
+
+static void load(const std::vector<List>& lists) {
+  table.reset();
+  for (const List& list : lists) {
+    int index = table.addAddress(list.address, strlen(list.address), list.section, strlen(list.section));
+    TEST_ASSERT_TRUE(index >= 0);
+    table.beginList(table[index].task);
+    for (size_t i = 0; i < list.usns; i++) {
+      std::string usn = usnOf(i, list.usnLength);
+      TEST_ASSERT_TRUE(table.appendUSN(table[index].task, usn.data(), usn.size()));
+    }
+  }
+  for (const char* address : {"RVU101", "RVU102"}) {
+    if (table.find(address) < 0) TEST_ASSERT_TRUE(table.addAddress(address, strlen(address)) >= 0);
+  }
+}
+
+static void discard(const char*, size_t) {}
+
+// Sends every roster again, as resendUnacknowledged() does: sort scratch
+// taken and handed back
+static void resendAll() {
+  for (size_t i = 0; i < table.size(); i++) {
+    size_t mark = table.mark();
+    RosterWriter::writeList(table, table[i].task, '|', true, discard);
+    TEST_ASSERT_EQUAL(mark, table.bytesUsed());
+  }
+}
+
+// Every slave answers with its whole roster, after several rounds of resends
+static void replyInFull() {
+  for (int round = 0; round < 5; round++) resendAll();
+  for (size_t i = 0; i < table.size(); i++) {
+    SessionTable::Entry& entry = table[i];
+    table.beginList(entry.response);
+    SessionTable::Iterator it(table, entry.task);
+    const char* usn;
+    size_t length;
+    while (it.next(usn, length)) {
+      TEST_ASSERT_TRUE(table.appendUSN(entry.response, usn, length));
+    }
+    TEST_ASSERT_EQUAL(entry.task.count, entry.response.count);
+    resendAll();
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(SessionTable::ARENA_SIZE, table.highWater());
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Records come back in order, each list packed right after the last
+void test_packed_records() {
+  table.reset();
+  int first = table.addAddress("RVU101", 6);
+  table.beginList(table[first].task);
+  for (size_t i = 0; i < 3; i++) {
+    std::string usn = usnOf(i, 10);
+    TEST_ASSERT_TRUE(table.appendUSN(table[first].task, usn.data(), usn.size()));
+  }
+  int second = table.addAddress("RVU102", 6);
+  table.beginList(table[second].task);
+  TEST_ASSERT_TRUE(table.appendUSN(table[second].task, "1RV17EC001", 10));
+
+  TEST_ASSERT_EQUAL(second, table.find("RVU102"));
+  TEST_ASSERT_EQUAL(-1, table.find("RVU10", 5));
+  TEST_ASSERT_EQUAL(3, table[first].task.count);
+  TEST_ASSERT_EQUAL(3 * 12, table[first].task.bytes);
+  TEST_ASSERT_EQUAL(2 * 7 + 4 * 12, table.bytesUsed());
+
+  SessionTable::Iterator it(table, table[first].task);
+  const char* usn;
+  size_t length;
+  for (size_t i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(it.next(usn, length));
+    TEST_ASSERT_EQUAL_STRING(usnOf(i, 10).c_str(), usn);
+  }
+  TEST_ASSERT_FALSE(it.next(usn, length));
+}
+
+// A roster that outgrows the arena is refused (413 in handleStartTask()),
+// and the next session starts from an empty arena
+void test_full_arena_refused() {
+  table.reset();
+  int index = table.addAddress("RVU101", 6);
+  table.beginList(table[index].task);
+  size_t appended = 0;
+  for (;; appended++) {
+    std::string usn = usnOf(appended, 10);
+    if (!table.appendUSN(table[index].task, usn.data(), usn.size())) break;
+  }
+  TEST_ASSERT_EQUAL(appended, table[index].task.count);
+  TEST_ASSERT_EQUAL((SessionTable::ARENA_SIZE - 7) / 12, appended);
+  TEST_ASSERT_LESS_OR_EQUAL(SessionTable::ARENA_SIZE, table.highWater());
+
+  table.reset();
+  TEST_ASSERT_EQUAL(0, table.bytesUsed());
+  index = table.addAddress("RVU101", 6);
+  table.beginList(table[index].task);
+  std::string tooLong(SessionTable::MAX_USN_LEN + 1, 'U');
+  TEST_ASSERT_FALSE(table.appendUSN(table[index].task, tooLong.data(), tooLong.size()));
+  TEST_ASSERT_TRUE(table.appendUSN(table[index].task, tooLong.data(), SessionTable::MAX_USN_LEN));
+}
+
+void test_address_table_full() {
+  table.reset();
+  char address[8];
+  for (size_t i = 0; i < SessionTable::MAX_ADDRESSES; i++) {
+    snprintf(address, sizeof(address), "RVU%03u", (unsigned)i);
+    TEST_ASSERT_EQUAL(i, table.addAddress(address, 6));
+  }
+  TEST_ASSERT_EQUAL(-1, table.addAddress("RVU999", 6));
+  TEST_ASSERT_EQUAL(SessionTable::MAX_ADDRESSES, table.size());
+}
+
+void test_pending_and_responded() {
+  table.reset();
+  int first = table.addAddress("RVU101", 6);
+  int second = table.addAddress("RVU102", 6);
+  table[first].pending = table[second].pending = true;
+  TEST_ASSERT_EQUAL(2, table.pendingCount());
+  table[first].pending = false;
+  table[first].responded = true;
+  TEST_ASSERT_EQUAL(1, table.pendingCount());
+  TEST_ASSERT_EQUAL(1, table.respondedCount());
+}
+
+// Scratch is aligned for UsnRef arrays and refused once the arena is spent
+void test_scratch_aligned() {
+  table.reset();
+  table.addAddress("RVU1", 4);
+  void* scratch = table.allocate(64);
+  TEST_ASSERT_NOT_NULL(scratch);
+  TEST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(scratch) % 4);
+  TEST_ASSERT_NULL(table.allocate(SessionTable::ARENA_SIZE));
+}
+
+void test_largest_single_roster() {
+  std::vector<List> lists = {{"RVU101", "", 0, 10}};
+  fill(lists);
+  TEST_ASSERT_TRUE(lists[0].usns > 200);
+  load(lists);
+  replyInFull();
+}
+
+void test_largest_sections() {
+  std::vector<List> lists = {{"RVU101", "CS-A", 0, 10}, {"RVU101", "CS-B", 60, 10}, {"RVU102", "", 40, 12}};
+  fill(lists);
+  load(lists);
+  replyInFull();
+}
+
+void test_long_usns() {
+  std::vector<List> lists = {{"RVU101", "", 0, SessionTable::MAX_USN_LEN}, {"RVU102", "", 3, 100}};
+  fill(lists);
+  TEST_ASSERT_TRUE(lists[0].usns > 0);
+  load(lists);
+  replyInFull();
+}
+
+// What loadTasks() checks once a JSON /start is loaded: the same count as
+// budget(), less the reservation for RVU101 and RVU102 where a list already
+// names them
+void test_loaded_session_budget() {
+  std::vector<List> lists = {{"RVU101", "CS-A", 30, 10}, {"RVU101", "CS-B", 50, 11}, {"RVU103", "", 20, 12}};
+  load(lists);
+  TEST_ASSERT_EQUAL(budget(lists) - sizeof("RVU101"), table.sessionBytes(sizeof(RosterCodec::UsnRef)));
+
+  lists = {{"RVU101", "", 0, 10}};
+  fill(lists);
+  lists[0].usns += 2;  // Past the budget, though the task lists alone still fit
+  load(lists);
+  TEST_ASSERT_TRUE(table.sessionBytes(sizeof(RosterCodec::UsnRef)) > SessionTable::ARENA_SIZE);
+}
+
+void test_rewind_keeps_lists() {
+  table.reset();
+  int index = table.addAddress("RVU101", 6);
+  table.beginList(table[index].task);
+  TEST_ASSERT_TRUE(table.appendUSN(table[index].task, "1RV17CS001", 10));
+  size_t used = table.bytesUsed();
+  size_t mark = table.mark();
+  TEST_ASSERT_NOT_NULL(table.allocate(64));
+  table.rewind(mark);
+  TEST_ASSERT_EQUAL(used, table.bytesUsed());
+  table.rewind(used + 100);  // Past the top: nothing to release
+  TEST_ASSERT_EQUAL(used, table.bytesUsed());
+  SessionTable::Iterator it(table, table[index].task);
+  const char* usn;
+  size_t length;
+  TEST_ASSERT_TRUE(it.next(usn, length));
+  TEST_ASSERT_EQUAL_STRING("1RV17CS001", usn);
+}
+
+static std::string frame;
+
+static void collect(const char* data, size_t length) { frame.append(data, length); }
+
+// The unnamed section first, then each tag with its window if it has one
+void test_section_window_fields() {
+  table.reset();
+  int lab = table.addAddress("RVU101", 6, "LAB", 3);
+  table[lab].window = 5400;
+  table.beginList(table[lab].task);
+  TEST_ASSERT_TRUE(table.appendUSN(table[lab].task, "1RV17CS002", 10));
+  int plain = table.addAddress("RVU101", 6);
+  table.beginList(table[plain].task);
+  TEST_ASSERT_TRUE(table.appendUSN(table[plain].task, "1RV17CS001", 10));
+
+  frame.clear();
+  size_t plainLength = 0;
+  TEST_ASSERT_FALSE(RosterWriter::writeAddress(table, "RVU101", '|', false, collect, plainLength));
+  TEST_ASSERT_EQUAL_STRING("|1RV17CS001|~SLAB:5400|1RV17CS002", frame.c_str());
+  TEST_ASSERT_EQUAL(frame.size(), plainLength);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_packed_records);
+  RUN_TEST(test_full_arena_refused);
+  RUN_TEST(test_address_table_full);
+  RUN_TEST(test_pending_and_responded);
+  RUN_TEST(test_scratch_aligned);
+  RUN_TEST(test_largest_single_roster);
+  RUN_TEST(test_largest_sections);
+  RUN_TEST(test_long_usns);
+  RUN_TEST(test_loaded_session_budget);
+  RUN_TEST(test_rewind_keeps_lists);
+  RUN_TEST(test_section_window_fields);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// Timetable planning and persistence: pio test -e native -f test_timetable
+//
+// The periods and the last occurrence go to the native HAL's flash files,
+// in a temporary data directory. due() and dispatched() take millis() as an
+// argument, so the test walks time forward from the moment the clock was set.
+
+#include <Hal.h>
+#include <Timetable.h>
+#include <native/NativeConfig.h>
+#include <unity.h>
+
+#include <stdlib.h>
+
+static const uint32_t MINUTES_PER_DAY = 24 * 60;
+static const uint32_t MONDAY = 20003;  // Days since 1970-01-01, a Thursday
+static const uint32_t SATURDAY = MONDAY + 5;
+
+static Timetable timetable;
+static uint32_t clockSetAt;
+
+static uint32_t at(uint32_t day, uint32_t hours, uint32_t minutes, uint32_t seconds = 0) {
+  return ((day * 24 + hours) * 60 + minutes) * 60 + seconds;
+}
+
+static Timetable::Period period(uint8_t days, uint16_t start, const char* roster) {
+  Timetable::Period p = {days, start, ""};
+  strcpy(p.roster, roster);
+  return p;
+}
+
+static void setClock(Timetable& table, uint32_t seconds) {
+  table.setClock(seconds);
+  clockSetAt = hal::millis();
+}
+
+// Monday 09:00 and 10:00, Tuesday 09:00
+static void loadWeek() {
+  Timetable::Period week[] = {period(1 << 1, 9 * 60, "cs3a"), period(1 << 1, 10 * 60, "cs3b"),
+                              period(1 << 2, 9 * 60, "lab")};
+  TEST_ASSERT_TRUE(timetable.setPeriods(week, 3));
+}
+
+void setUp() {
+  hal::files::remove("/timetable-done");
+  timetable = Timetable();
+  timetable.begin();
+}
+
+void tearDown() {}
+
+void test_due_at_start_then_next() {
+  loadWeek();
+  setClock(timetable, at(MONDAY, 8, 59, 30));
+  uint32_t minute;
+  TEST_ASSERT_EQUAL(0, timetable.next(minute));
+  TEST_ASSERT_EQUAL(MONDAY * MINUTES_PER_DAY + 9 * 60, minute);
+
+  TEST_ASSERT_EQUAL(-1, timetable.due(clockSetAt + 29000));
+  TEST_ASSERT_EQUAL(0, timetable.due(clockSetAt + 30000));
+  TEST_ASSERT_EQUAL(0, timetable.due(clockSetAt + 31000));  // Due until dispatched
+  timetable.dispatched(clockSetAt + 31000);
+  TEST_ASSERT_EQUAL_STRING("cs3a", timetable.last().roster);
+  TEST_ASSERT_TRUE(timetable.last().lateMs >= 1000 && timetable.last().lateMs < 1100);
+
+  TEST_ASSERT_EQUAL(1, timetable.next(minute));
+  TEST_ASSERT_EQUAL(MONDAY * MINUTES_PER_DAY + 10 * 60, minute);
+  TEST_ASSERT_EQUAL(0, timetable.missedCount());
+}
+
+void test_late_occurrence_skipped() {
+  loadWeek();
+  setClock(timetable, at(MONDAY, 8, 59, 30));
+  TEST_ASSERT_EQUAL(-1, timetable.due(clockSetAt + 30000 + Timetable::LATE_LIMIT_MS + 1000));
+  TEST_ASSERT_EQUAL(1, timetable.missedCount());
+  uint32_t minute;
+  TEST_ASSERT_EQUAL(1, timetable.next(minute));
+}
+
+void test_week_wraps() {
+  loadWeek();
+  setClock(timetable, at(SATURDAY, 12, 0));
+  uint32_t minute;
+  TEST_ASSERT_EQUAL(0, timetable.next(minute));
+  TEST_ASSERT_EQUAL((MONDAY + 7) * MINUTES_PER_DAY + 9 * 60, minute);
+}
+
+// A restart reloads the periods and does not send a dispatched one again
+void test_restart_keeps_periods_and_progress() {
+  loadWeek();
+  setClock(timetable, at(MONDAY, 9, 0));
+  TEST_ASSERT_EQUAL(0, timetable.due(clockSetAt));
+  timetable.dispatched(clockSetAt);
+
+  Timetable restarted;
+  restarted.begin();
+  TEST_ASSERT_EQUAL(3, restarted.size());
+  TEST_ASSERT_EQUAL_STRING("lab", restarted[2].roster);
+  setClock(restarted, at(MONDAY, 9, 1));
+  uint32_t minute;
+  TEST_ASSERT_EQUAL(1, restarted.next(minute));
+}
+
+void test_invalid_periods_rejected() {
+  loadWeek();
+  Timetable::Period bad[] = {period(1, MINUTES_PER_DAY, "cs3a")};
+  TEST_ASSERT_FALSE(timetable.setPeriods(bad, 1));
+  bad[0] = period(1, 0, "cs 3a");
+  TEST_ASSERT_FALSE(timetable.setPeriods(bad, 1));
+  TEST_ASSERT_EQUAL(3, timetable.size());  // Unchanged
+  TEST_ASSERT_FALSE(Timetable::validName("0123456789ABCDEF"));
+  TEST_ASSERT_TRUE(Timetable::validName("LAB-B1_x"));
+}
+
+int main() {
+  char dir[] = "/tmp/test_timetable-XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+  hal::native::config().dataDir = dir;
+  hal::files::begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_due_at_start_then_next);
+  RUN_TEST(test_late_occurrence_skipped);
+  RUN_TEST(test_week_wraps);
+  RUN_TEST(test_restart_keeps_periods_and_progress);
+  RUN_TEST(test_invalid_periods_rejected);
+  return UNITY_END();
+}
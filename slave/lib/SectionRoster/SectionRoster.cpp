@@ -0,0 +1,76 @@
+#include "SectionRoster.h"
+
+#include <Checkpoint.h>
+
+void SectionRoster::clear() {
+  usns.clear();
+  present.clear();
+  owner.clear();
+  index.clear();
+  count = 0;
+}
+
+int SectionRoster::addSection(const char* id, size_t len, uint32_t startTime, uint32_t window) {
+  if (count >= MAX_SECTIONS || len > RosterCodec::MAX_SECTION_ID) return -1;
+  Section& section = sections[count];
+  memcpy(section.id, id, len);
+  section.id[len] = '\0';
+  section.startTime = startTime;
+  section.window = window;
+  section.first = usns.size();
+  section.count = 0;
+  section.open = true;
+  return count++;
+}
+
+void SectionRoster::addUSN(const char* usn, size_t len) {
+  if (count == 0 || usns.size() >= 0xFFFF) return;
+  usns.emplace_back(usn, len);
+  present.push_back(0);
+  owner.push_back(count - 1);
+  sections[count - 1].count++;
+}
+
+int SectionRoster::findSection(const char* id, size_t len) const {
+  for (size_t i = 0; i < count; i++) {
+    if (strncmp(sections[i].id, id, len) == 0 && sections[i].id[len] == '\0') return i;
+  }
+  return -1;
+}
+
+size_t SectionRoster::openCount() const {
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (sections[i].open) n++;
+  }
+  return n;
+}
+
+// At most half full, so probe runs stay short. Rebuilt whole: sections
+// arrive a frame at a time, never per tap.
+void SectionRoster::buildIndex() {
+  size_t slots = 16;
+  while (slots < usns.size() * 2) slots *= 2;
+  index.assign(slots, 0);
+  for (size_t i = 0; i < usns.size(); i++) {
+    size_t slot = Checkpoint::hash(usns[i].data(), usns[i].size()) & (slots - 1);
+    while (index[slot] != 0) slot = (slot + 1) & (slots - 1);
+    index[slot] = i + 1;
+  }
+}
+
+size_t SectionRoster::mark(const char* usn, size_t len, bool& newlyMarked) {
+  newlyMarked = false;
+  if (index.empty()) return 0;
+  size_t sectionsMarked = 0;
+  size_t mask = index.size() - 1;
+  // A USN on several rosters has an entry per roster, all in one probe run
+  for (size_t slot = Checkpoint::hash(usn, len) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+    size_t i = index[slot] - 1;
+    if (!sections[owner[i]].open || usns[i].size() != len || memcmp(usns[i].data(), usn, len) != 0) continue;
+    if (!present[i]) newlyMarked = true;
+    present[i] = 1;
+    sectionsMarked++;
+  }
+  return sectionsMarked;
+}
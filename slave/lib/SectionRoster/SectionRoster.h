@@ -0,0 +1,67 @@
+#ifndef SECTION_ROSTER_H
+#define SECTION_ROSTER_H
+
+#include <Hal.h>
+#include <RosterCodec.h>
+#include <string>
+#include <vector>
+
+// The rosters of every section a slave is running, behind one lookup index.
+//
+// A combined lecture or a lab split into batches is several sections on one
+// slave (see RosterCodec.h for the frame). Each section keeps its own ID,
+// start time, window (its deadline is that long after the start) and open
+// flag; the USNs of all of them share one pool with a presence flag each,
+// and one open-addressing hash index maps a USN to its pool entries, so a
+// tap resolves in constant time however many sections are loaded. A section
+// that has replied stays in the pool, closed, until clear().
+
+class SectionRoster {
+public:
+  static const size_t MAX_SECTIONS = RosterCodec::MAX_SECTIONS;
+
+  struct Section {
+    char id[RosterCodec::MAX_SECTION_ID + 1];  // "" for an untagged frame
+    uint32_t startTime;                        // millis() when its roster arrived
+    uint32_t window;                           // ms it stays open after that
+    uint16_t first;                            // Pool entries first..first+count-1
+    uint16_t count;
+    bool open;                                 // Still taking attendance
+  };
+
+  SectionRoster() : count(0) {}
+
+  void clear();
+
+  // Opens a section; USNs added next belong to it. -1 when every section
+  // slot is taken.
+  int addSection(const char* id, size_t len, uint32_t startTime, uint32_t window);
+  void addUSN(const char* usn, size_t len);
+  // Rebuilds the index over the whole pool; call once a frame is loaded
+  void buildIndex();
+
+  int findSection(const char* id, size_t len) const;
+  size_t sectionCount() const { return count; }
+  size_t openCount() const;
+  Section& section(size_t i) { return sections[i]; }
+  const Section& section(size_t i) const { return sections[i]; }
+
+  size_t size() const { return usns.size(); }
+  const std::string& usn(size_t i) const { return usns[i]; }
+  bool marked(size_t i) const { return present[i] != 0; }
+  void setMarked(size_t i, bool value) { present[i] = value; }
+
+  // Marks the USN in every open section that lists it. Returns how many
+  // did (0: not on any open roster); newlyMarked if one had not been yet.
+  size_t mark(const char* usn, size_t len, bool& newlyMarked);
+
+private:
+  std::vector<std::string> usns;
+  std::vector<uint8_t> present;
+  std::vector<uint8_t> owner;   // Section of each pool entry
+  std::vector<uint16_t> index;  // Slot -> pool entry + 1 (0 = empty); power-of-two size
+  Section sections[MAX_SECTIONS];
+  size_t count;
+};
+
+#endif
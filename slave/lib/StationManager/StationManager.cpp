@@ -0,0 +1,132 @@
+#include "StationManager.h"
+
+static const uint32_t MINUTE_MS = 60000;
+static const uint32_t POLL_INTERVAL_MS = 250;
+
+void StationManager::RateCounter::roll(uint32_t now) {
+  if (now - windowStart < MINUTE_MS) return;
+  // Skipped a whole minute with no events: the previous window was empty
+  lastMinute = (now - windowStart < 2 * MINUTE_MS) ? thisMinute : 0;
+  thisMinute = 0;
+  windowStart = now;
+}
+
+void StationManager::RateCounter::add(uint32_t now) {
+  roll(now);
+  total++;
+  thisMinute++;
+}
+
+void StationManager::begin(uint8_t maxConnections, uint32_t idleTimeout, uint32_t evictDelay) {
+  maxConn = maxConnections > MAX_STATIONS ? MAX_STATIONS : maxConnections;
+  idleTimeoutMs = idleTimeout;
+  evictDelayMs = evictDelay;
+  stationCount = 0;
+  lastPoll = 0;
+  for (size_t i = 0; i < MAX_STATIONS; i++) stations[i].inUse = false;
+
+  uint32_t now = hal::millis();
+  associations = {0, 0, 0, now};
+  evictions = {0, 0, 0, now};
+  marks = {0, 0, 0, now};
+  idleEvictions = 0;
+  markedEvictions = 0;
+  failedEvictions = 0;
+}
+
+bool StationManager::canEvict() const {
+  return hal::wifi::canDeauth();
+}
+
+StationManager::Station* StationManager::findByMac(const uint8_t mac[6]) {
+  for (size_t i = 0; i < MAX_STATIONS; i++) {
+    if (stations[i].inUse && memcmp(stations[i].mac, mac, 6) == 0) return &stations[i];
+  }
+  return nullptr;
+}
+
+StationManager::Station* StationManager::findByIP(uint32_t ip) {
+  uint8_t mac[6];
+  return hal::wifi::stationMac(ip, mac) ? findByMac(mac) : nullptr;
+}
+
+void StationManager::onConnected(const uint8_t mac[6]) {
+  uint32_t now = hal::millis();
+  associations.add(now);
+
+  Station* station = findByMac(mac);
+  for (size_t i = 0; station == nullptr && i < MAX_STATIONS; i++) {
+    if (!stations[i].inUse) {
+      station = &stations[i];
+      station->inUse = true;
+      memcpy(station->mac, mac, 6);
+      stationCount++;
+    }
+  }
+  if (station != nullptr) {
+    station->lastSeen = now;
+    station->evictAt = 0;
+  }
+}
+
+void StationManager::onDisconnected(const uint8_t mac[6]) {
+  Station* station = findByMac(mac);
+  if (station != nullptr) {
+    station->inUse = false;
+    stationCount--;
+  }
+}
+
+void StationManager::onRequest(uint32_t ip) {
+  Station* station = findByIP(ip);
+  if (station != nullptr) station->lastSeen = hal::millis();
+}
+
+void StationManager::onMarked(uint32_t ip) {
+  uint32_t now = hal::millis();
+  marks.add(now);
+
+  Station* station = findByIP(ip);
+  if (station != nullptr && station->evictAt == 0) {
+    // Never 0, which means "not scheduled"
+    station->evictAt = (now + evictDelayMs) | 1;
+  }
+}
+
+bool StationManager::evict(Station& station) {
+  if (!hal::wifi::deauth(station.mac)) {
+    failedEvictions++;
+    station.evictAt = 0;
+    return false;
+  }
+  evictions.add(hal::millis());
+  station.inUse = false;
+  stationCount--;
+  return true;
+}
+
+void StationManager::poll() {
+  uint32_t now = hal::millis();
+  if (now - lastPoll < POLL_INTERVAL_MS) return;
+  lastPoll = now;
+
+  associations.roll(now);
+  evictions.roll(now);
+  marks.roll(now);
+  if (!canEvict()) return;
+
+  bool full = stationCount >= maxConn;
+  for (size_t i = 0; i < MAX_STATIONS; i++) {
+    Station& station = stations[i];
+    if (!station.inUse) continue;
+
+    if (station.evictAt != 0 && (int32_t)(now - station.evictAt) >= 0) {
+      if (evict(station)) markedEvictions++;
+    } else if (full && station.evictAt == 0 && now - station.lastSeen > idleTimeoutMs) {
+      if (evict(station)) {
+        idleEvictions++;
+        full = stationCount >= maxConn;
+      }
+    }
+  }
+}
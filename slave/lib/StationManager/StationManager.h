@@ -0,0 +1,73 @@
+#ifndef STATION_MANAGER_H
+#define STATION_MANAGER_H
+
+#include <Hal.h>
+
+// Keeps SoftAP association slots free for students who still have to mark.
+//
+// Stations are tracked by MAC from the SoftAP connect/disconnect events and
+// matched to HTTP clients by their DHCP-assigned IP. A station whose USN was
+// marked is deauthenticated shortly after its reply has gone out; when every
+// slot is taken, stations idle for longer than the idle timeout go too.
+// Where the HAL cannot deauthenticate (hal::wifi::canDeauth()) nothing is
+// evicted and only the counters are kept; /stations says so.
+
+class StationManager {
+public:
+  static const size_t MAX_STATIONS = 8;  // SoftAP limit on the ESP8266
+
+  // Events in the current and previous one-minute window plus a running total
+  struct RateCounter {
+    uint32_t total;
+    uint32_t thisMinute;
+    uint32_t lastMinute;
+    uint32_t windowStart;
+
+    void add(uint32_t now);
+    void roll(uint32_t now);
+  };
+
+  void begin(uint8_t maxConnections, uint32_t idleTimeout, uint32_t evictDelay);
+
+  void onConnected(const uint8_t mac[6]);
+  void onDisconnected(const uint8_t mac[6]);
+
+  // Called from the HTTP handlers with server.clientIP()
+  void onRequest(uint32_t ip);
+  void onMarked(uint32_t ip);
+
+  // Evicts due stations; call from loop()
+  void poll();
+
+  uint8_t connected() const { return stationCount; }
+  uint8_t maxConnections() const { return maxConn; }
+  bool canEvict() const;
+
+  RateCounter associations;
+  RateCounter evictions;
+  RateCounter marks;
+  uint32_t idleEvictions;
+  uint32_t markedEvictions;
+  uint32_t failedEvictions;
+
+private:
+  struct Station {
+    uint8_t mac[6];
+    uint32_t lastSeen;    // Association or last HTTP request
+    uint32_t evictAt;     // 0 = not scheduled
+    bool inUse;
+  };
+
+  Station stations[MAX_STATIONS];
+  uint8_t stationCount;
+  uint8_t maxConn;
+  uint32_t idleTimeoutMs;
+  uint32_t evictDelayMs;
+  uint32_t lastPoll;
+
+  Station* findByMac(const uint8_t mac[6]);
+  Station* findByIP(uint32_t ip);
+  bool evict(Station& station);
+};
+
+#endif
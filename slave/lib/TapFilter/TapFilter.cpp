@@ -0,0 +1,71 @@
+#include "TapFilter.h"
+
+#include <Checkpoint.h>
+
+void TapFilter::begin(uint32_t ratePerSecond, uint32_t burst) {
+  rate = ratePerSecond;
+  capacity = burst * 1000;
+  reset();
+}
+
+void TapFilter::reset() {
+  for (size_t i = 0; i < CACHE_SIZE; i++) cache[i].answer = NONE;
+  cacheNext = 0;
+  for (size_t i = 0; i < MAX_CLIENTS; i++) buckets[i].inUse = false;
+  cacheHits = 0;
+  limited = 0;
+}
+
+bool TapFilter::allow(uint32_t ip, uint32_t now) {
+  Bucket* bucket = nullptr;
+  Bucket* oldest = &buckets[0];
+  for (size_t i = 0; i < MAX_CLIENTS; i++) {
+    Bucket& b = buckets[i];
+    if (b.inUse && b.ip == ip) {
+      bucket = &b;
+      break;
+    }
+    if (!b.inUse || (oldest->inUse && now - b.lastSeen > now - oldest->lastSeen)) oldest = &b;
+  }
+
+  if (bucket == nullptr) {
+    // New client (or one evicted for being idle longest): a full bucket
+    bucket = oldest;
+    bucket->ip = ip;
+    bucket->milliTokens = capacity;
+    bucket->inUse = true;
+  } else {
+    // Rate tokens per second is rate milliTokens per ms
+    uint32_t elapsed = now - bucket->lastSeen;
+    uint32_t refill = elapsed >= capacity / rate ? capacity : elapsed * rate;
+    bucket->milliTokens = bucket->milliTokens + refill > capacity ? capacity : bucket->milliTokens + refill;
+  }
+  bucket->lastSeen = now;
+
+  if (bucket->milliTokens < 1000) {
+    limited++;
+    return false;
+  }
+  bucket->milliTokens -= 1000;
+  return true;
+}
+
+TapFilter::Answer TapFilter::lookup(uint32_t ip, const char* body, size_t length) {
+  uint32_t bodyHash = Checkpoint::hash(body, length);
+  for (size_t i = 0; i < CACHE_SIZE; i++) {
+    const CacheEntry& entry = cache[i];
+    if (entry.answer != NONE && entry.ip == ip && entry.bodyHash == bodyHash) {
+      cacheHits++;
+      return entry.answer;
+    }
+  }
+  return NONE;
+}
+
+void TapFilter::remember(uint32_t ip, const char* body, size_t length, Answer answer) {
+  CacheEntry& entry = cache[cacheNext];
+  entry.ip = ip;
+  entry.bodyHash = Checkpoint::hash(body, length);
+  entry.answer = answer;
+  cacheNext = (cacheNext + 1) % CACHE_SIZE;
+}
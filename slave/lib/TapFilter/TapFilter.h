@@ -0,0 +1,60 @@
+#ifndef TAP_FILTER_H
+#define TAP_FILTER_H
+
+#include <Hal.h>
+
+// Cheap answers for repeated /attendance taps and a per-client rate limit.
+//
+// Phones retry and students tap again during the rush. Answers that cannot
+// change for the rest of the session (marked, not in this class) are kept in
+// a small ring keyed by client IP and a hash of the request body, so a repeat
+// is answered without the JSON parse, the roster scan or the LED blink.
+// Each client IP also has a token bucket, spent only by taps that miss the
+// cache; one that keeps tapping faster than the sustained rate after its
+// burst is used up gets 429 until it slows down.
+// Both tables are fixed-size and reset with each roster.
+
+class TapFilter {
+public:
+  static const size_t CACHE_SIZE = 32;
+  static const size_t MAX_CLIENTS = 16;  // Buckets; the least recently seen is reused
+
+  enum Answer : uint8_t { NONE, MARKED, REJECTED };
+
+  void begin(uint32_t ratePerSecond, uint32_t burst);
+
+  // Forgets cached answers and buckets (new roster)
+  void reset();
+
+  // Takes a token from the client's bucket; false when it is empty
+  bool allow(uint32_t ip, uint32_t now);
+
+  // Answer given to this client for the same body, or NONE
+  Answer lookup(uint32_t ip, const char* body, size_t length);
+  void remember(uint32_t ip, const char* body, size_t length, Answer answer);
+
+  uint32_t cacheHits;
+  uint32_t limited;
+
+private:
+  struct CacheEntry {
+    uint32_t ip;
+    uint32_t bodyHash;
+    Answer answer;
+  };
+
+  struct Bucket {
+    uint32_t ip;
+    uint32_t lastSeen;
+    uint32_t milliTokens;  // 1000 per request
+    bool inUse;
+  };
+
+  CacheEntry cache[CACHE_SIZE];
+  size_t cacheNext;
+  Bucket buckets[MAX_CLIENTS];
+  uint32_t rate;
+  uint32_t capacity;  // milliTokens
+};
+
+#endif
@@ -1,30 +1,64 @@
-#include <Arduino.h>
-#include <ESP8266WiFi.h>
-#include <ESP8266WebServer.h>
+#include <Hal.h>
 #include <ArduinoJson.h>
 #include <vector>
 #include <string>
-#include <SoftwareSerial.h>
+#include <RosterCodec.h>
+#include <UartLink.h>
+#include <StationManager.h>
+#include <TapFilter.h>
+#include <SectionRoster.h>
+#include <Profiler.h>
+#include <Trace.h>
+#include <Checkpoint.h>
 
-// SoftwareSerial soft(14,12); //D5, D6 RX, TX
-SoftwareSerial soft(14,5); //D5, D1 RX, TX
+// Run the master link on the hardware UART, swapped onto RX=GPIO13 (D7) /
+// TX=GPIO15 (D8), instead of SoftwareSerial on D5/D1.
+#ifndef LINK_USE_HW_UART
+#define LINK_USE_HW_UART 0
+#endif
+
+#if LINK_USE_HW_UART
+hal::SerialPort uart0(hal::HardwareUart{true});
+UartLink link(uart0);
 // Debug output on Serial1 (TX1 = GPIO2/D4) - connect USB-TTL RX to D4
-#define DEBUG_BAUD 115200
+#define DEBUG Serial1
+#else
+// SoftwareSerial soft(14,12); //D5, D6 RX, TX
+hal::SerialPort soft(14,5); //D5, D1 RX, TX
+UartLink link(soft);
 #define DEBUG Serial
+#endif
+#define DEBUG_BAUD 115200
 
 // LED for status indication (built-in LED on most ESP8266 boards)
 #define LED_PIN 16 // GPIO16 (D0) - safer than GPIO2 which is used for boot
+hal::Led led(LED_PIN, true); // Active low on most ESP8266 boards
 
 // ==================== Configuration ====================
-#define SLAVE_ADDRESS "RVU101"              // This slave's address - change for each device
+#ifndef SLAVE_ADDRESS
+#define SLAVE_ADDRESS "RVU101"              // This slave's address - change for each device (or -DSLAVE_ADDRESS)
+#endif
 #define UART_BAUD 9600                  // UART baud rate
 #define SSID "RV_CLASS_1"
 #define PASSWORD "123456789"
 #define DEVICE_IP "192.168.0.10"
 #define SUBNET_MASK "255.255.255.0"
 #define GATEWAY "192.168.0.10"
+#ifndef ACTIVE_DURATION
 #define ACTIVE_DURATION 1.2 * 60 * 1000  // 45 minutes in milliseconds
+#endif
 #define JSON_BUFFER_SIZE 512
+#define AP_MAX_CONNECTIONS 8              // SoftAP association slots (ESP8266 max is 8)
+#define STATION_IDLE_TIMEOUT 30000        // Evict idle stations after this long when the AP is full
+#define STATION_EVICT_DELAY 1500          // Let the reply reach the phone before evicting
+#define TAP_RATE 2                        // Sustained /attendance requests per second per client
+#define TAP_BURST 6                       // Requests a client may send at once (covers retries)
+#define CHECKPOINT_INTERVAL 1000          // Refresh the RTC checkpoint this often while ACTIVE
+#define ROSTER_FILE "/roster"             // This session's roster frames in flash, for resuming after a reset
+#define TRACE_FILE "/trace"               // Traffic trace of the last session (see Trace.h)
+#ifndef TRACE_FLUSH
+#define TRACE_FLUSH 0                     // 1: save the trace to flash at the end of every session (a flash write each)
+#endif
 
 // UART Protocol characters
 #define START_CHAR '<'
@@ -38,14 +72,61 @@ enum DeviceState {
   SEND
 };
 
+// ==================== Profiler Zones ====================
+// Reported at GET /profile (see Profiler.h)
+enum ProfileZone {
+  ZONE_LOOP,
+  ZONE_HTTP,
+  ZONE_UART_RX,
+  ZONE_PARSE_ROSTER,
+  ZONE_ATTENDANCE,
+  ZONE_JSON_PARSE,
+  ZONE_SEND_REPLY,
+  ZONE_STATION_POLL,
+  ZONE_LED,
+  ZONE_COUNT
+};
+const char* const ZONE_NAMES[ZONE_COUNT] = {
+  "loop", "http", "uart_rx", "parse_roster", "attendance",
+  "json_parse", "send_reply", "station_poll", "led"
+};
+
 // ==================== Global Variables ====================
 DeviceState currentState = HALT;
-ESP8266WebServer server(80);
-std::vector<std::string> receivedUSNs;
-std::vector<uint8_t> markedAttendance;
-unsigned long activeStartTime = 0;
+hal::HttpServer server(80);
+SectionRoster roster;  // Every section running, each with its own window (see SectionRoster.h)
 String uartBuffer = "";
 bool messageStarted = false;
+BroadcastSlice broadcast(SLAVE_ADDRESS);  // Our part of a broadcast roster frame (see UartLink.h)
+bool broadcastFrame = false;
+
+// Link rate negotiation (see UartLink.h)
+uint32_t linkPreviousBaud = UART_BAUD;
+unsigned long linkSwitchTime = 0;
+bool linkAwaitingCommit = false;
+
+// SoftAP station tracking and eviction
+StationManager stations;
+
+// Repeated taps and over-eager clients on /attendance (see TapFilter.h)
+TapFilter taps;
+
+// Session checkpoint in RTC memory (see Checkpoint.h). The roster frames
+// are too big for it, so they are kept in flash and recognised by their hash.
+const uint32_t CHECKPOINT_VERSION = 2;
+struct SessionCheckpoint {
+  uint8_t state;            // ACTIVE or SEND
+  uint8_t sectionCount;
+  uint16_t rosterCount;
+  uint32_t rosterHash;      // Of ROSTER_FILE
+  uint32_t linkBaud;        // Negotiated rate the master expects the reply at
+  uint8_t closed;           // Bit per section that has replied
+  uint8_t reserved[3];
+  uint32_t elapsed[SectionRoster::MAX_SECTIONS];  // ms of each section's window used up
+  uint8_t present[Checkpoint::CAPACITY - 16 - 4 * SectionRoster::MAX_SECTIONS];  // Bit per roster entry
+};
+SessionCheckpoint checkpoint;
+unsigned long lastCheckpoint = 0;
 
 // Add a testing flag to bypass UART receive
 bool testing = false;
@@ -53,33 +134,57 @@ bool testing = false;
 // Forward declarations
 void setupHTTPServer();
 void parseUARTMessage(String message);
+void acceptRoster(const String& usnData);
 void sendAttendanceResponse();
 void blinkLED(int times, int onTime, int offTime);
+void handleLinkControl(const String& message);
+bool loadFrame(const String& usnData, uint32_t now, size_t& added);
+bool windowEnded(const SectionRoster::Section& section, uint32_t now);
+void saveCheckpoint();
 
 // ==================== LED Functions ====================
 void blinkLED(int times, int onTime = 100, int offTime = 100) {
+  PROFILE_ZONE(ZONE_LED);
   for (int i = 0; i < times; i++) {
-    digitalWrite(LED_PIN, LOW);   // LED ON (active low on most ESP8266)
-    delay(onTime);
-    digitalWrite(LED_PIN, HIGH);  // LED OFF
-    if (i < times - 1) delay(offTime);
+    led.on();
+    hal::delay(onTime);
+    led.off();
+    if (i < times - 1) hal::delay(offTime);
   }
 }
 
 // ==================== UART Functions ====================
 void processUARTInput() {
-  while (soft.available()) {
-    char c = soft.read();
+  PROFILE_ZONE(ZONE_UART_RX);
+  while (link.available()) {
+    char c = link.read();
     
     if (c == START_CHAR) {
       // Start of new message
       uartBuffer = "";
       messageStarted = true;
+      broadcastFrame = false;
     } else if (c == END_CHAR && messageStarted) {
       // End of message - process it
       messageStarted = false;
-      parseUARTMessage(uartBuffer);
+      if (!broadcastFrame) {
+        parseUARTMessage(uartBuffer);
+      } else if (broadcast.complete()) {
+        PROFILE_ZONE(ZONE_PARSE_ROSTER);
+        DEBUG.println("[UART] Roster found in broadcast frame");
+        acceptRoster(broadcast.slice());
+      } else {
+        DEBUG.println("[UART] Broadcast frame without a roster for us, ignoring");
+      }
       uartBuffer = "";
+      broadcast.begin();
+    } else if (broadcastFrame) {
+      // Only our slice of the payload is kept
+      broadcast.push(c);
+    } else if (messageStarted && uartBuffer.length() == 0 && c == UartLink::BROADCAST_CHAR) {
+      broadcastFrame = true;
+      broadcast.begin();
+      broadcast.push(c);
     } else if (messageStarted) {
       // Add character to buffer
       uartBuffer += c;
@@ -89,8 +194,17 @@ void processUARTInput() {
 }
 
 void parseUARTMessage(String message) {
+  PROFILE_ZONE(ZONE_PARSE_ROSTER);
   // Message format: address|usn1|usn2|usn3|...
-  // First field is address, rest are USNs
+  //             or: address|~F|token1|token2|...   (front-coded, see RosterCodec.h)
+  // First field is address, rest are USNs. Broadcast frames never get here;
+  // processUARTInput() keeps only our slice of them.
+  
+  if (message.length() > 0 && message[0] == UartLink::CONTROL_CHAR) {
+    // Once ACTIVE the reply goes out at the rate already agreed
+    if (currentState == HALT) handleLinkControl(message);
+    return;
+  }
   
   int firstSep = message.indexOf(SEPARATOR);
   String address;
@@ -118,111 +232,329 @@ void parseUARTMessage(String message) {
   }
   
   DEBUG.println("[UART] Address matched!");
-  
-  // Address matches - only process if in HALT state
-  if (currentState != HALT) {
-    DEBUG.println("[UART] Not in HALT state, ignoring");
+  acceptRoster(usnData);
+}
+
+// Loads the roster fields of a frame addressed to us, unicast or our slice
+// of a broadcast, and acknowledges them.
+void acceptRoster(const String& usnData) {
+  // In HALT the frame starts a session; while ACTIVE it adds sections
+  // alongside the running ones
+  bool starting = currentState == HALT;
+  if (starting) roster.clear();
+  size_t added;
+  if (!loadFrame(usnData, hal::millis(), added)) {
+    DEBUG.println("[UART] Warning: malformed front-coded roster, some USNs skipped");
+  }
+  // Acknowledged even when nothing was new: a resent roster means our ACK was lost
+  link.sendFrame("!K|" SLAVE_ADDRESS);
+  if (added == 0) {
+    DEBUG.println("[UART] No new sections in frame, ignoring");
     return;
   }
-  
-  // Parse USNs (separated by |)
-  receivedUSNs.clear();
-  markedAttendance.clear();
-  
+
+  // Keep every frame of the session in flash so a reset can reload them (see resumeSession())
+  String frames;
+  if (!starting) hal::files::read(ROSTER_FILE, frames);
+  frames += usnData;
+  frames += '\n';
+  checkpoint.rosterHash = Checkpoint::hash(frames.c_str(), frames.length());
+  if (!hal::files::write(ROSTER_FILE, frames.c_str(), frames.length())) {
+    DEBUG.println("[CHECKPOINT] Roster not saved, this session cannot resume after a reset");
+  }
+  taps.reset();  // A USN turned away before may be on a new section
+
+  if (starting) {
+    // Transition to ACTIVE state
+    currentState = ACTIVE;
+    Profiler::reset();  // Per-session profile
+    saveCheckpoint();
+    setupHTTPServer();
+
+    // Blink LED 3 times - got data from master
+    blinkLED(3, 200, 200);
+    DEBUG.println("[STATE] Transitioned to ACTIVE");
+  } else {
+    saveCheckpoint();
+  }
+
+  for (size_t s = roster.sectionCount() - added; s < roster.sectionCount(); s++) {
+    const SectionRoster::Section& section = roster.section(s);
+    DEBUG.print("[STATE] Section '");
+    DEBUG.print(section.id);
+    DEBUG.print("' received ");
+    DEBUG.print(section.count);
+    DEBUG.print(" USNs, open ");
+    DEBUG.print(section.window / 1000);
+    DEBUG.println(" s:");
+    for (size_t i = section.first; i < section.first + section.count; i++) {
+      DEBUG.print("  - ");
+      DEBUG.println(roster.usn(i).c_str());
+    }
+  }
+  if (starting) DEBUG.println("[HTTP] Server started on port 80");
+}
+
+// Parses a frame's roster fields into new sections. Fields before any
+// section tag are the unnamed section; each section is plain or front-coded
+// (see RosterCodec.h) and stays open for its tag's window, or ACTIVE_DURATION.
+// Sections already loaded are skipped, so a roster sent again changes
+// nothing. False if front-coded tokens had to be skipped.
+bool loadFrame(const String& usnData, uint32_t now, size_t& added) {
+  added = 0;
+  RosterCodec::Decoder decoder;
+  bool opened = false;
+  bool skipping = false;
+  bool frontCoded = false;
+  bool firstField = true;
+  bool decodeOk = true;
+  auto addUSN = [](const char* usn, size_t len) { roster.addUSN(usn, len); };
+  auto openSection = [&](const char* id, size_t len, uint16_t window) {
+    opened = true;
+    uint32_t windowMs = window ? window * 1000UL : (uint32_t)(ACTIVE_DURATION);
+    skipping = roster.findSection(id, len) >= 0 || roster.addSection(id, len, now, windowMs) < 0;
+    if (!skipping) added++;
+    decoder = RosterCodec::Decoder();
+    frontCoded = false;
+    firstField = true;
+  };
+
   int startIdx = 0;
-  int sepIdx = 0;
-  
-  while ((sepIdx = usnData.indexOf(SEPARATOR, startIdx)) != -1) {
-    String usn = usnData.substring(startIdx, sepIdx);
-    usn.trim();
-    if (usn.length() > 0) {
-      receivedUSNs.push_back(usn.c_str());
-      markedAttendance.push_back(0);
+  int length = usnData.length();
+  while (startIdx <= length) {
+    int sepIdx = usnData.indexOf(SEPARATOR, startIdx);
+    if (sepIdx == -1) sepIdx = length;
+
+    // Trim the field in place instead of copying it out
+    int fieldStart = startIdx;
+    int fieldEnd = sepIdx;
+    while (fieldStart < fieldEnd && isspace(usnData[fieldStart])) fieldStart++;
+    while (fieldEnd > fieldStart && isspace(usnData[fieldEnd - 1])) fieldEnd--;
+    const char* field = usnData.c_str() + fieldStart;
+    size_t fieldLen = fieldEnd - fieldStart;
+
+    const char* id;
+    size_t idLen;
+    uint16_t window;
+    if (fieldLen > 0 && RosterCodec::isSectionTag(field, fieldLen, id, idLen, window)) {
+      if (RosterCodec::validSectionId(id, idLen)) {
+        openSection(id, idLen, window);
+      } else {
+        opened = skipping = true;
+      }
+    } else if (fieldLen > 0) {
+      if (!opened) openSection("", 0, 0);
+      if (skipping) {
+        // Already loaded, or no section slot left
+      } else if (firstField && RosterCodec::isFrontCodedTag(field, fieldLen)) {
+        frontCoded = true;
+      } else if (frontCoded) {
+        if (!decoder.push(field, fieldLen, addUSN)) decodeOk = false;
+      } else {
+        addUSN(field, fieldLen);
+      }
+      firstField = false;
     }
     startIdx = sepIdx + 1;
   }
-  
-  // Add last USN
-  String usn = usnData.substring(startIdx);
-  usn.trim();
-  if (usn.length() > 0) {
-    receivedUSNs.push_back(usn.c_str());
-    markedAttendance.push_back(0);
-  }
-  
-  // Transition to ACTIVE state
-  currentState = ACTIVE;
-  activeStartTime = millis();
-  soft.println(usnData);
-  setupHTTPServer();
-  
-  // Blink LED 3 times - got data from master
-  blinkLED(3, 200, 200);
-  
-  DEBUG.println("[STATE] Transitioned to ACTIVE");
-  DEBUG.print("[STATE] Received ");
-  DEBUG.print(receivedUSNs.size());
-  DEBUG.println(" USNs:");
-  for (size_t i = 0; i < receivedUSNs.size(); i++) {
-    DEBUG.print("  - ");
-    DEBUG.println(receivedUSNs[i].c_str());
-  }
-  DEBUG.println("[HTTP] Server started on port 80");
+  // An untagged frame with no USNs still runs (and replies) as an empty section
+  if (!opened) openSection("", 0, 0);
+
+  if (added > 0) roster.buildIndex();
+  return decodeOk;
+}
+
+bool windowEnded(const SectionRoster::Section& section, uint32_t now) {
+  return now - section.startTime >= section.window;
 }
 
+// Replies for every open section whose window has ended, back in HALT once
+// none is left open
 void sendAttendanceResponse() {
-  // Send format: <address|usn1|usn2|...>
-  // Only send USNs that were marked as present (attendance = 1)
+  PROFILE_ZONE(ZONE_SEND_REPLY);
+  // Send format: <address|usn1|usn2|...>, or <address|~Sid|usn1|...> for a
+  // named section. Only USNs that were marked as present are sent.
   
   DEBUG.println("[STATE] Sending attendance response");
   
-  String response = "";
-  response += START_CHAR;
-  response += SLAVE_ADDRESS;
-  
-  int markedCount = 0;
-  for (size_t i = 0; i < markedAttendance.size(); i++) {
-    if (markedAttendance[i] == 1) {
+  uint32_t now = hal::millis();
+  for (size_t s = 0; s < roster.sectionCount(); s++) {
+    SectionRoster::Section& section = roster.section(s);
+    if (!section.open || !windowEnded(section, now)) continue;
+
+    String response = "";
+    response += START_CHAR;
+    response += SLAVE_ADDRESS;
+    if (section.id[0] != '\0') {
       response += SEPARATOR;
-      response += receivedUSNs[i].c_str();
-      markedCount++;
+      response += RosterCodec::SECTION_TAG;
+      response += section.id;
+    }
+    
+    int markedCount = 0;
+    for (size_t i = section.first; i < section.first + section.count; i++) {
+      if (roster.marked(i)) {
+        response += SEPARATOR;
+        response += roster.usn(i).c_str();
+        markedCount++;
+      }
     }
+    
+    response += END_CHAR;
+    
+    DEBUG.print("[UART] Sending: ");
+    DEBUG.println(response);
+    DEBUG.print("[STATE] Marked attendance count: ");
+    DEBUG.println(markedCount);
+    
+    link.print(response);
+    section.open = false;
+  }
+
+  if (roster.openCount() > 0) {
+    currentState = ACTIVE;
+    saveCheckpoint();
+    DEBUG.println("[STATE] Sections still open, back to ACTIVE");
+    return;
   }
   
-  response += END_CHAR;
-  
-  DEBUG.print("[UART] Sending: ");
-  DEBUG.println(response);
-  DEBUG.print("[STATE] Marked attendance count: ");
-  DEBUG.println(markedCount);
-  
-  soft.print(response);
-  
-  // Transition back to HALT
+  // Transition back to HALT; the next session starts at the base rate again
+  link.setBaud(UART_BAUD);
   currentState = HALT;
   DEBUG.println("[STATE] Transitioned to HALT");
   
   // Clear data for next session
-  receivedUSNs.clear();
-  markedAttendance.clear();
+  roster.clear();
+  Checkpoint::clear();
 }
 
-// ==================== USN Functions ====================
-bool isUSNInList(const std::string& usn) {
-  for (const auto& receivedUSN : receivedUSNs) {
-    if (receivedUSN == usn) {
-      return true;
-    }
+// ==================== Session Checkpoint ====================
+// State, link rate, each section's time used and a presence bit per roster
+// entry. Rosters too long for the bitmap run without one.
+void saveCheckpoint() {
+  size_t count = roster.size();
+  if (count > sizeof(checkpoint.present) * 8) return;
+  size_t bytes = (count + 7) / 8;
+  uint32_t now = hal::millis();
+  checkpoint.state = currentState;
+  checkpoint.sectionCount = roster.sectionCount();
+  checkpoint.rosterCount = count;
+  checkpoint.linkBaud = link.baud();
+  checkpoint.closed = 0;
+  for (size_t s = 0; s < roster.sectionCount(); s++) {
+    checkpoint.elapsed[s] = now - roster.section(s).startTime;
+    if (!roster.section(s).open) checkpoint.closed |= 1 << s;
   }
-  return false;
+  memset(checkpoint.present, 0, bytes);
+  for (size_t i = 0; i < count; i++) {
+    if (roster.marked(i)) checkpoint.present[i / 8] |= 1 << (i % 8);
+  }
+  Checkpoint::save(CHECKPOINT_VERSION, &checkpoint, offsetof(SessionCheckpoint, present) + bytes);
+  lastCheckpoint = hal::millis();
 }
 
-void markAttendance(const std::string& usn) {
-  for (size_t i = 0; i < receivedUSNs.size(); i++) {
-    if (receivedUSNs[i] == usn) {
-      markedAttendance[i] = 1;
-      break;
-    }
+// After a reset mid-session: reload the roster frames from flash, re-apply
+// the marks and carry on with the time each section had left
+bool resumeSession() {
+  size_t length = Checkpoint::load(CHECKPOINT_VERSION, &checkpoint, sizeof(checkpoint));
+  if (length < offsetof(SessionCheckpoint, present)) return false;
+
+  String frames;
+  if (!hal::files::read(ROSTER_FILE, frames) ||
+      Checkpoint::hash(frames.c_str(), frames.length()) != checkpoint.rosterHash) {
+    DEBUG.println("[CHECKPOINT] Roster in flash does not match, dropping session");
+    Checkpoint::clear();
+    return false;
+  }
+  // One line per frame, in the order they arrived
+  roster.clear();
+  int start = 0;
+  while (start < (int)frames.length()) {
+    int end = frames.indexOf('\n', start);
+    if (end == -1) end = frames.length();
+    size_t added;
+    loadFrame(frames.substring(start, end), 0, added);
+    start = end + 1;
+  }
+  size_t count = roster.size();
+  if (count != checkpoint.rosterCount || roster.sectionCount() != checkpoint.sectionCount ||
+      length < offsetof(SessionCheckpoint, present) + (count + 7) / 8) {
+    DEBUG.println("[CHECKPOINT] Checkpoint does not fit the roster, dropping session");
+    roster.clear();
+    Checkpoint::clear();
+    return false;
+  }
+
+  uint32_t now = hal::millis();
+  for (size_t s = 0; s < roster.sectionCount(); s++) {
+    roster.section(s).startTime = now - checkpoint.elapsed[s];
+    roster.section(s).open = !(checkpoint.closed & (1 << s));
+  }
+  size_t marked = 0;
+  for (size_t i = 0; i < count; i++) {
+    roster.setMarked(i, (checkpoint.present[i / 8] >> (i % 8)) & 1);
+    marked += roster.marked(i);
+  }
+  link.setBaud(checkpoint.linkBaud);
+  lastCheckpoint = hal::millis();
+  currentState = checkpoint.state == SEND ? SEND : ACTIVE;
+  if (currentState == ACTIVE) setupHTTPServer();
+
+  DEBUG.print("[CHECKPOINT] Resumed ");
+  DEBUG.print(currentState == ACTIVE ? "ACTIVE" : "SEND");
+  DEBUG.print(" session: ");
+  DEBUG.print(marked);
+  DEBUG.print("/");
+  DEBUG.print(count);
+  DEBUG.print(" marked in ");
+  DEBUG.print(roster.openCount());
+  DEBUG.print(" open section(s), ");
+  DEBUG.print(checkpoint.elapsed[0] / 1000);
+  DEBUG.print(" s elapsed, link at ");
+  DEBUG.print(checkpoint.linkBaud);
+  DEBUG.println(" baud");
+  return true;
+}
+
+// ==================== Link Rate Negotiation ====================
+void handleLinkControl(const String& message) {
+  String type = message.substring(0, 2);
+  String value = message.length() > 3 ? message.substring(3) : String();
+
+  if (type == "!B") {
+    // Proposal: accept at the current rate, then switch and wait for the test
+    uint32_t rate = value.toInt();
+    if (rate < UART_BAUD) return;
+    link.sendFrame(("!A|" SLAVE_ADDRESS "|" + value).c_str());
+    if (!linkAwaitingCommit) linkPreviousBaud = link.baud();
+    link.setBaud(rate);
+    linkSwitchTime = hal::millis();
+    linkAwaitingCommit = true;
+    DEBUG.print("[LINK] Switched to ");
+    DEBUG.print(rate);
+    DEBUG.println(" baud, awaiting commit");
+  } else if (type == "!T") {
+    link.sendFrame(("!E|" SLAVE_ADDRESS "|" + value).c_str());
+  } else if (type == "!C") {
+    linkAwaitingCommit = false;
+    DEBUG.print("[LINK] Committed ");
+    DEBUG.print(link.baud());
+    DEBUG.println(" baud");
+  } else if (type == "!R") {
+    // Not addressed this session: wait for the next one at the base rate
+    linkAwaitingCommit = false;
+    link.setBaud(UART_BAUD);
+  }
+}
+
+// A switched link that never saw a commit goes back to the previous rate
+void pollLinkRevert() {
+  if (linkAwaitingCommit && hal::millis() - linkSwitchTime > UartLink::COMMIT_TIMEOUT_MS) {
+    linkAwaitingCommit = false;
+    link.setBaud(linkPreviousBaud);
+    DEBUG.print("[LINK] No commit, reverted to ");
+    DEBUG.print(linkPreviousBaud);
+    DEBUG.println(" baud");
   }
 }
 
@@ -238,10 +570,16 @@ void handleOptions() {
   server.send(204);
 }
 
+const char MARKED_RESPONSE[] = "{\"response\": \"attendance marked\"}";
+const char REJECTED_RESPONSE[] = "{\"response\": \"you are not from this class\"}";
+
 void handleAttendance() {
+  PROFILE_ZONE(ZONE_ATTENDANCE);
   sendCORSHeaders();
   
   DEBUG.println("[HTTP] POST /attendance received");
+  uint32_t clientIP = server.clientIP();
+  stations.onRequest(clientIP);
   
   if (currentState != ACTIVE) {
     DEBUG.println("[HTTP] Error: Not in ACTIVE state");
@@ -254,14 +592,35 @@ void handleAttendance() {
     server.send(405, "application/json", "{\"error\": \"Method not allowed\"}");
     return;
   }
-  
+
   String body = server.arg("plain");
+
+  // A repeat of an answered tap gets the same answer without another pass,
+  // and without spending a token: only taps that need a pass are limited
+  TapFilter::Answer cached = taps.lookup(clientIP, body.c_str(), body.length());
+  if (cached != TapFilter::NONE) {
+    DEBUG.println("[HTTP] Repeat, answered from cache");
+    server.send(200, "application/json", cached == TapFilter::MARKED ? MARKED_RESPONSE : REJECTED_RESPONSE);
+    return;
+  }
+
+  if (!taps.allow(clientIP, hal::millis())) {
+    DEBUG.println("[HTTP] Rate limited");
+    server.sendHeader("Retry-After", "1");
+    server.send(429, "application/json", "{\"error\": \"Too many requests\"}");
+    return;
+  }
+
   DEBUG.print("[HTTP] Body: ");
   DEBUG.println(body);
   
   // Parse JSON
   StaticJsonDocument<JSON_BUFFER_SIZE> doc;
-  DeserializationError error = deserializeJson(doc, body);
+  DeserializationError error;
+  {
+    PROFILE_ZONE(ZONE_JSON_PARSE);
+    error = deserializeJson(doc, body.c_str(), body.length());
+  }
   
   if (error) {
     DEBUG.println("[HTTP] Error: Invalid JSON");
@@ -277,18 +636,27 @@ void handleAttendance() {
   DEBUG.print(", Status: ");
   DEBUG.println(status.c_str());
   
-  String response;
+  const char* response;
   
-  // Check attendance eligibility
-  if (status == "success" && isUSNInList(usn)) {
-    markAttendance(usn);
-    response = "{\"response\": \"attendance marked\"}";
-    DEBUG.print("[HTTP] Attendance MARKED for: ");
+  // Check attendance eligibility: one index lookup across every open section
+  bool newlyMarked = false;
+  if (status == "success" && roster.mark(usn.data(), usn.size(), newlyMarked) > 0) {
+    bool alreadyMarked = !newlyMarked;
+    response = MARKED_RESPONSE;
+    taps.remember(clientIP, body.c_str(), body.length(), TapFilter::MARKED);
+    DEBUG.print(alreadyMarked ? "[HTTP] Attendance already marked for: " : "[HTTP] Attendance MARKED for: ");
     DEBUG.println(usn.c_str());
-    // Blink LED 1 time - HTTP attendance marked
-    blinkLED(1, 100, 0);
+    // Either way this phone is done: free its association slot
+    stations.onMarked(clientIP);
+    if (!alreadyMarked) {
+      saveCheckpoint();
+      // Blink LED 1 time - HTTP attendance marked (not again for repeats)
+      blinkLED(1, 100, 0);
+    }
   } else {
-    response = "{\"response\": \"you are not from this class\"}";
+    response = REJECTED_RESPONSE;
+    // Only a valid "success" tap is final; anything else may be corrected
+    if (status == "success") taps.remember(clientIP, body.c_str(), body.length(), TapFilter::REJECTED);
     DEBUG.print("[HTTP] Attendance REJECTED for: ");
     DEBUG.println(usn.c_str());
   }
@@ -296,6 +664,64 @@ void handleAttendance() {
   server.send(200, "application/json", response);
 }
 
+void handleStations() {
+  sendCORSHeaders();
+
+  StaticJsonDocument<JSON_BUFFER_SIZE> doc;
+  doc["connected"] = stations.connected();
+  doc["max_connections"] = stations.maxConnections();
+  doc["eviction"] = stations.canEvict() ? "enabled" : "unavailable";
+
+  const StationManager::RateCounter* counters[] = {&stations.associations, &stations.evictions, &stations.marks};
+  const char* names[] = {"associations", "evictions", "marks"};
+  for (size_t i = 0; i < 3; i++) {
+    JsonObject counter = doc.createNestedObject(names[i]);
+    counter["total"] = counters[i]->total;
+    counter["this_minute"] = counters[i]->thisMinute;
+    counter["last_minute"] = counters[i]->lastMinute;
+  }
+  doc["evictions"]["marked"] = stations.markedEvictions;
+  doc["evictions"]["idle"] = stations.idleEvictions;
+  doc["evictions"]["failed"] = stations.failedEvictions;
+  JsonObject repeats = doc.createNestedObject("taps");
+  repeats["cached"] = taps.cacheHits;
+  repeats["rate_limited"] = taps.limited;
+
+  String output;
+  serializeJson(doc, output);
+  server.send(200, "application/json", output);
+}
+
+// Zone stats cover the current (or last) session; ?reset=1 clears them now
+void handleProfile() {
+  sendCORSHeaders();
+  String output;
+  output.reserve(1536);
+  Profiler::writeJson(output);
+  if (server.hasArg("reset")) {
+    Profiler::reset();
+  }
+  server.send(200, "application/json", output);
+}
+
+// The traffic trace (see Trace.h) as a binary file; ?saved=1 for the copy
+// saved at the end of the last session
+void handleTrace() {
+  sendCORSHeaders();
+  if (server.hasArg("saved")) {
+    String saved;
+    if (!hal::files::read(TRACE_FILE, saved)) {
+      server.send(404, "application/json", "{\"error\": \"No saved trace\"}");
+      return;
+    }
+    server.send(200, "application/octet-stream", saved.c_str(), saved.length());
+    return;
+  }
+  server.beginResponse(200, "application/octet-stream");
+  Trace::write([](const char* data, size_t length) { server.sendContent(data, length); });
+  server.endResponse();
+}
+
 void handleNotFound() {
   sendCORSHeaders();
   server.send(404, "application/json", "{\"error\": \"Endpoint not found\"}");
@@ -303,29 +729,47 @@ void handleNotFound() {
 
 // ==================== AP Setup ====================
 void setupAP() {
-  WiFi.mode(WIFI_AP);
-  WiFi.softAPConfig(IPAddress(192, 168, 0, 10),
-                    IPAddress(192, 168, 0, 10),
-                    IPAddress(255, 255, 255, 0));
-  bool success = WiFi.softAP(SSID, PASSWORD);
+  bool success = hal::wifi::startAccessPoint(SSID, PASSWORD,
+                                             hal::ip(192, 168, 0, 10),
+                                             hal::ip(255, 255, 255, 0),
+                                             1, AP_MAX_CONNECTIONS);
+
+  stations.begin(AP_MAX_CONNECTIONS, STATION_IDLE_TIMEOUT, STATION_EVICT_DELAY);
+  hal::wifi::onStationConnected([](const uint8_t mac[6]) { stations.onConnected(mac); });
+  hal::wifi::onStationDisconnected([](const uint8_t mac[6]) { stations.onDisconnected(mac); });
   
   DEBUG.print("[WIFI] AP Setup: ");
   DEBUG.println(success ? "SUCCESS" : "FAILED");
   DEBUG.print("[WIFI] SSID: ");
   DEBUG.println(SSID);
   DEBUG.print("[WIFI] IP: ");
-  DEBUG.println(WiFi.softAPIP());
+  DEBUG.println(hal::ipToString(hal::wifi::accessPointIP()));
+  DEBUG.print("[WIFI] Max stations: ");
+  DEBUG.print(AP_MAX_CONNECTIONS);
+  DEBUG.println(stations.canEvict() ? " (eviction enabled)" : " (eviction unavailable: stations are not disconnected)");
 }
 
 // ==================== HTTP Server Setup ====================
 void setupHTTPServer() {
   server.on("/attendance", HTTP_POST, handleAttendance);
   server.on("/attendance", HTTP_OPTIONS, handleOptions);  // CORS preflight
+  server.on("/stations", HTTP_GET, handleStations);
+  server.on("/profile", HTTP_GET, handleProfile);
+  server.on("/trace", HTTP_GET, handleTrace);
   server.onNotFound(handleNotFound);
+  server.onRequest([] { Trace::request(server); });
   server.begin();
 }
 
 // ==================== State Machine ====================
+bool sectionWindowEnded() {
+  uint32_t now = hal::millis();
+  for (size_t s = 0; s < roster.sectionCount(); s++) {
+    if (roster.section(s).open && windowEnded(roster.section(s), now)) return true;
+  }
+  return false;
+}
+
 void handleStateMachine() {
   static DeviceState lastState = HALT;
   
@@ -336,6 +780,11 @@ void handleStateMachine() {
       case ACTIVE: DEBUG.println("ACTIVE"); break;
       case SEND: DEBUG.println("SEND"); break;
     }
+    Trace::state(currentState);
+#if TRACE_FLUSH
+    // The session is over: keep its trace in flash
+    if (currentState == HALT && !Trace::save(TRACE_FILE)) DEBUG.println("[TRACE] Not saved to flash");
+#endif
     lastState = currentState;
   }
   
@@ -343,21 +792,32 @@ void handleStateMachine() {
     case HALT:
       // Process incoming UART messages
       processUARTInput();
+      pollLinkRevert();
       break;
       
     case ACTIVE:
       // Handle HTTP clients
-      server.handleClient();
+      {
+        PROFILE_ZONE(ZONE_HTTP);
+        server.handleClient();
+      }
+      {
+        PROFILE_ZONE(ZONE_STATION_POLL);
+        stations.poll();
+      }
       
-      // Also check for UART input (in case master sends new message)
-      //processUARTInput();
+      // More sections can arrive while these run
+      processUARTInput();
       
-      // Check if 45 minutes have passed
-      if (millis() - activeStartTime >= ACTIVE_DURATION) {
+      // Check if a section's 45 minutes have passed
+      if (sectionWindowEnded()) {
         DEBUG.println("[STATE] Time expired, moving to SEND");
         // Blink LED 5 times fast - timer expired
         blinkLED(5, 50, 50);
         currentState = SEND;
+        saveCheckpoint();
+      } else if (hal::millis() - lastCheckpoint >= CHECKPOINT_INTERVAL) {
+        saveCheckpoint();
       }
       break;
       
@@ -372,15 +832,13 @@ void handleStateMachine() {
 // ==================== Setup ====================
 void setup() {
   // Initialize LED pin
-  pinMode(LED_PIN, OUTPUT);
-  digitalWrite(LED_PIN, HIGH);  // LED OFF initially (active low)
+  led.begin();  // LED OFF initially
   
   // Initialize UART for communication with master
-  soft.begin(UART_BAUD);
+  link.begin(UART_BAUD);
   
-  // Initialize debug serial on GPIO2/D4 (TX only)
-  Serial.begin(DEBUG_BAUD);
-  delay(1000);
+  // Initialize debug serial (Serial1 on GPIO2/D4 when the link owns Serial)
+  DEBUG.begin(DEBUG_BAUD);
   
   DEBUG.println("\n\n==============================");
   DEBUG.println("   SLAVE DEVICE STARTING");
@@ -389,36 +847,54 @@ void setup() {
   DEBUG.println(SLAVE_ADDRESS);
   DEBUG.print("[CONFIG] UART Baud: ");
   DEBUG.println(UART_BAUD);
+  DEBUG.print("[CONFIG] Link: ");
+  DEBUG.println(link.isHardware() ? "hardware UART (GPIO13/15)" : "SoftwareSerial");
   DEBUG.print("[CONFIG] Active Duration: ");
-  DEBUG.print(ACTIVE_DURATION / 60000);
+  DEBUG.print((ACTIVE_DURATION) / 60000.0);
   DEBUG.println(" minutes");
   
+  Profiler::begin(ZONE_NAMES, ZONE_COUNT);
+  taps.begin(TAP_RATE, TAP_BURST);
+
   // Start Access Point
   setupAP();
+
+  if (!hal::files::begin()) {
+    DEBUG.println("[CHECKPOINT] No flash filesystem, sessions will not survive a reset");
+  }
   
-  DEBUG.println("[STATE] Initial state: HALT");
-  DEBUG.println("[STATE] Waiting for UART message...");
+  if (resumeSession()) {
+    DEBUG.println("[STATE] Resumed after reset");
+  } else {
+    DEBUG.println("[STATE] Initial state: HALT");
+    DEBUG.println("[STATE] Waiting for UART message...");
+  }
+  DEBUG.print("[BOOT] Ready in ");
+  DEBUG.print(hal::millis());
+  DEBUG.println(" ms");
   DEBUG.println("==============================\n");
   
   // if (testing) {
   //   // Add some test USNs for testing mode
-  //   receivedUSNs.push_back("1RV17CS001");
-  //   receivedUSNs.push_back("1RV17CS002");
-  //   receivedUSNs.push_back("1RV17CS003");
-  //   markedAttendance.push_back(0);
-  //   markedAttendance.push_back(0);
-  //   markedAttendance.push_back(0);
+  //   roster.addSection("", 0, hal::millis(), ACTIVE_DURATION);
+  //   roster.addUSN("1RV17CS001", 10);
+  //   roster.addUSN("1RV17CS002", 10);
+  //   roster.addUSN("1RV17CS003", 10);
+  //   roster.buildIndex();
     
   //   currentState = ACTIVE;
-  //   activeStartTime = millis();
   //   setupHTTPServer();
   // }
 }
 
 // ==================== Main Loop ====================
 void loop() {
-  handleStateMachine();
-  delay(10);
+  {
+    PROFILE_ZONE(ZONE_LOOP);
+    handleStateMachine();
+  }
+  Profiler::sampleHeap();
+  hal::delay(10);
 }
 
 
@@ -0,0 +1,109 @@
+// SectionRoster's merged index: pio test -e native -f test_section_roster
+
+#include <SectionRoster.h>
+#include <unity.h>
+#include <string.h>
+
+#include <string>
+
+static SectionRoster roster;
+
+static void addSection(const char* id, std::initializer_list<const char*> usns) {
+  TEST_ASSERT_TRUE(roster.addSection(id, strlen(id), 0, 1000) >= 0);
+  for (const char* usn : usns) roster.addUSN(usn, strlen(usn));
+}
+
+static size_t mark(const char* usn, bool& newlyMarked) { return roster.mark(usn, strlen(usn), newlyMarked); }
+
+void setUp() { roster.clear(); }
+void tearDown() {}
+
+void test_usn_on_several_sections() {
+  addSection("CS-A", {"1RV17CS001", "1RV17CS002"});
+  addSection("CS-B", {"1RV17CS002", "1RV17CS003"});
+  roster.buildIndex();
+
+  bool newlyMarked;
+  TEST_ASSERT_EQUAL(2, mark("1RV17CS002", newlyMarked));
+  TEST_ASSERT_TRUE(newlyMarked);
+  TEST_ASSERT_TRUE(roster.marked(1));
+  TEST_ASSERT_TRUE(roster.marked(2));
+  TEST_ASSERT_EQUAL(2, mark("1RV17CS002", newlyMarked));
+  TEST_ASSERT_FALSE(newlyMarked);
+
+  TEST_ASSERT_EQUAL(1, mark("1RV17CS003", newlyMarked));
+  TEST_ASSERT_FALSE(roster.marked(0));
+  TEST_ASSERT_EQUAL(0, mark("1RV17CS004", newlyMarked));
+  TEST_ASSERT_EQUAL(0, mark("1RV17CS00", newlyMarked));
+  TEST_ASSERT_FALSE(newlyMarked);
+}
+
+void test_closed_section_not_marked() {
+  addSection("CS-A", {"1RV17CS001"});
+  addSection("CS-B", {"1RV17CS001"});
+  roster.buildIndex();
+  roster.section(0).open = false;
+  TEST_ASSERT_EQUAL(1, roster.openCount());
+
+  bool newlyMarked;
+  TEST_ASSERT_EQUAL(1, mark("1RV17CS001", newlyMarked));
+  TEST_ASSERT_FALSE(roster.marked(0));
+  TEST_ASSERT_TRUE(roster.marked(1));
+}
+
+void test_sections_found_by_id() {
+  for (size_t i = 0; i < SectionRoster::MAX_SECTIONS; i++) {
+    std::string id = "S" + std::to_string(i);
+    TEST_ASSERT_EQUAL(i, roster.addSection(id.data(), id.size(), 0, 1000));
+  }
+  TEST_ASSERT_EQUAL(-1, roster.addSection("S9", 2, 0, 1000));
+  TEST_ASSERT_EQUAL(3, roster.findSection("S3", 2));
+  TEST_ASSERT_EQUAL(-1, roster.findSection("S", 1));
+  TEST_ASSERT_EQUAL(-1, roster.addSection("0123456789ABCDEF", 16, 0, 1000));
+  roster.clear();
+  TEST_ASSERT_EQUAL(0, roster.sectionCount());
+  TEST_ASSERT_EQUAL(0, roster.addSection("", 0, 0, 1000));
+  TEST_ASSERT_EQUAL(0, roster.findSection("", 0));
+}
+
+// Every USN of a large pool is found once, whatever the probe runs
+void test_every_usn_found() {
+  const size_t sections = 4;
+  const size_t perSection = 300;
+  for (size_t s = 0; s < sections; s++) {
+    std::string id = "S" + std::to_string(s);
+    TEST_ASSERT_TRUE(roster.addSection(id.data(), id.size(), 0, 1000) >= 0);
+    for (size_t i = 0; i < perSection; i++) {
+      std::string usn = "1RV" + std::to_string(s * perSection + i);
+      roster.addUSN(usn.data(), usn.size());
+    }
+  }
+  roster.buildIndex();
+
+  for (size_t i = 0; i < sections * perSection; i++) {
+    std::string usn = "1RV" + std::to_string(i);
+    bool newlyMarked;
+    TEST_ASSERT_EQUAL_MESSAGE(1, roster.mark(usn.data(), usn.size(), newlyMarked), usn.c_str());
+    TEST_ASSERT_TRUE(newlyMarked);
+  }
+  for (size_t i = 0; i < roster.size(); i++) TEST_ASSERT_TRUE(roster.marked(i));
+}
+
+void test_empty_roster() {
+  bool newlyMarked;
+  TEST_ASSERT_EQUAL(0, mark("1RV17CS001", newlyMarked));
+  addSection("", {});
+  roster.buildIndex();
+  TEST_ASSERT_EQUAL(0, mark("1RV17CS001", newlyMarked));
+  TEST_ASSERT_EQUAL(0, roster.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_usn_on_several_sections);
+  RUN_TEST(test_closed_section_not_marked);
+  RUN_TEST(test_sections_found_by_id);
+  RUN_TEST(test_every_usn_found);
+  RUN_TEST(test_empty_roster);
+  return UNITY_END();
+}
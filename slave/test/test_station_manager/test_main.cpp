@@ -0,0 +1,96 @@
+// StationManager eviction on the native HAL's simulated access point:
+// pio test -e native -f test_station_manager
+//
+// Runs on the real clock, so each poll() waits out POLL_INTERVAL_MS first.
+
+#include <Hal.h>
+#include <StationManager.h>
+#include <native/NativeWifi.h>
+#include <unity.h>
+
+namespace nwifi = hal::native::wifi;
+
+static StationManager stations;
+
+static const uint8_t PHONE_A[6] = {0x02, 0, 0, 0, 0, 0xA1};
+static const uint8_t PHONE_B[6] = {0x02, 0, 0, 0, 0, 0xB2};
+static const uint8_t PHONE_C[6] = {0x02, 0, 0, 0, 0, 0xC3};
+static const uint32_t IP_A = hal::ip(192, 168, 4, 10);
+static const uint32_t IP_B = hal::ip(192, 168, 4, 11);
+static const uint32_t IP_C = hal::ip(192, 168, 4, 12);
+
+static void pollLater(uint32_t ms) {
+  hal::delay(ms);
+  stations.poll();
+}
+
+void setUp() {
+  for (const uint8_t* mac : {PHONE_A, PHONE_B, PHONE_C}) nwifi::leave(mac);
+  hal::wifi::onStationConnected([](const uint8_t mac[6]) { stations.onConnected(mac); });
+  hal::wifi::onStationDisconnected([](const uint8_t mac[6]) { stations.onDisconnected(mac); });
+}
+
+void tearDown() {}
+
+void test_marked_station_evicted_after_delay() {
+  stations.begin(4, 60000, 100);
+  TEST_ASSERT_TRUE(stations.canEvict());
+  TEST_ASSERT_TRUE(nwifi::associate(PHONE_A, IP_A));
+  TEST_ASSERT_TRUE(nwifi::associate(PHONE_B, IP_B));
+  TEST_ASSERT_EQUAL(2, stations.connected());
+
+  stations.onMarked(IP_A);
+  pollLater(300);
+  TEST_ASSERT_FALSE(nwifi::associated(PHONE_A));
+  TEST_ASSERT_TRUE(nwifi::associated(PHONE_B));
+  TEST_ASSERT_EQUAL(1, stations.connected());
+  TEST_ASSERT_EQUAL(1, stations.markedEvictions);
+  TEST_ASSERT_EQUAL(1, stations.evictions.total);
+  TEST_ASSERT_EQUAL(1, stations.marks.total);
+  TEST_ASSERT_EQUAL(2, stations.associations.total);
+
+  // A marked phone that leaves on its own is not evicted again
+  stations.onMarked(IP_B);
+  TEST_ASSERT_TRUE(nwifi::leave(PHONE_B));
+  pollLater(300);
+  TEST_ASSERT_EQUAL(0, stations.connected());
+  TEST_ASSERT_EQUAL(1, stations.markedEvictions);
+  TEST_ASSERT_EQUAL(0, stations.failedEvictions);
+}
+
+void test_idle_station_evicted_only_when_full() {
+  stations.begin(2, 200, 100);
+  TEST_ASSERT_TRUE(nwifi::associate(PHONE_A, IP_A));
+  pollLater(300);
+  TEST_ASSERT_TRUE(nwifi::associated(PHONE_A));  // Idle, but slots are free
+
+  TEST_ASSERT_TRUE(nwifi::associate(PHONE_B, IP_B));
+  hal::delay(300);
+  stations.onRequest(IP_B);  // B is busy, A has been idle past the timeout
+  stations.poll();
+  TEST_ASSERT_FALSE(nwifi::associated(PHONE_A));
+  TEST_ASSERT_TRUE(nwifi::associated(PHONE_B));
+  TEST_ASSERT_EQUAL(1, stations.idleEvictions);
+  TEST_ASSERT_EQUAL(0, stations.markedEvictions);
+
+  pollLater(300);  // B idle now, but a slot is free again
+  TEST_ASSERT_TRUE(nwifi::associated(PHONE_B));
+  TEST_ASSERT_EQUAL(1, stations.idleEvictions);
+}
+
+void test_failed_eviction_counted() {
+  stations.begin(1, 100, 100);
+  stations.onConnected(PHONE_C);  // Known to the manager, not to the access point
+  pollLater(300);
+  TEST_ASSERT_EQUAL(1, stations.failedEvictions);
+  TEST_ASSERT_EQUAL(0, stations.idleEvictions);
+  TEST_ASSERT_EQUAL(1, stations.connected());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_marked_station_evicted_after_delay);
+  RUN_TEST(test_idle_station_evicted_only_when_full);
+  RUN_TEST(test_failed_eviction_counted);
+  return UNITY_END();
+}
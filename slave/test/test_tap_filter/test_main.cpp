@@ -0,0 +1,76 @@
+// TapFilter answer cache and token buckets: pio test -e native -f test_tap_filter
+//
+// allow() takes the time as an argument, so the buckets run on a made-up clock.
+
+#include <TapFilter.h>
+#include <unity.h>
+#include <string.h>
+
+static TapFilter taps;
+
+static const uint32_t PHONE = hal::ip(192, 168, 4, 10);
+static const uint32_t OTHER = hal::ip(192, 168, 4, 11);
+static const char TAP[] = "{\"usn\":\"1RV17CS001\",\"status\":\"success\"}";
+
+void setUp() { taps.begin(2, 3); }  // 2 a second sustained, bursts of 3
+void tearDown() {}
+
+void test_burst_then_limited() {
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(taps.allow(PHONE, 1000));
+  TEST_ASSERT_FALSE(taps.allow(PHONE, 1000));
+  TEST_ASSERT_FALSE(taps.allow(PHONE, 1499));  // Not quite a token back yet
+  TEST_ASSERT_EQUAL(2, taps.limited);
+  TEST_ASSERT_TRUE(taps.allow(OTHER, 1499));  // Buckets are per client
+}
+
+void test_refill_at_rate() {
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(taps.allow(PHONE, 0));
+  TEST_ASSERT_TRUE(taps.allow(PHONE, 500));
+  TEST_ASSERT_FALSE(taps.allow(PHONE, 500));
+  // Idle long enough: a full bucket, but no more than the burst
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(taps.allow(PHONE, 60000));
+  TEST_ASSERT_FALSE(taps.allow(PHONE, 60000));
+}
+
+void test_idle_bucket_reused() {
+  for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(taps.allow(PHONE, 0));
+  // More clients than buckets: PHONE, seen longest ago, loses its bucket
+  for (uint32_t i = 0; i < TapFilter::MAX_CLIENTS; i++) {
+    TEST_ASSERT_TRUE(taps.allow(hal::ip(10, 0, 0, i), 10 + i));
+  }
+  TEST_ASSERT_TRUE(taps.allow(PHONE, 100));  // A new, full bucket
+}
+
+void test_answers_cached_per_client_and_body() {
+  size_t length = strlen(TAP);
+  TEST_ASSERT_EQUAL(TapFilter::NONE, taps.lookup(PHONE, TAP, length));
+  taps.remember(PHONE, TAP, length, TapFilter::MARKED);
+  TEST_ASSERT_EQUAL(TapFilter::MARKED, taps.lookup(PHONE, TAP, length));
+  TEST_ASSERT_EQUAL(TapFilter::NONE, taps.lookup(OTHER, TAP, length));
+  TEST_ASSERT_EQUAL(TapFilter::NONE, taps.lookup(PHONE, TAP, length - 1));
+  TEST_ASSERT_EQUAL(1, taps.cacheHits);
+
+  taps.reset();
+  TEST_ASSERT_EQUAL(TapFilter::NONE, taps.lookup(PHONE, TAP, length));
+  TEST_ASSERT_EQUAL(0, taps.cacheHits);
+}
+
+void test_cache_ring_drops_oldest() {
+  for (uint32_t i = 0; i <= TapFilter::CACHE_SIZE; i++) {
+    taps.remember(hal::ip(10, 0, 0, i), TAP, strlen(TAP), TapFilter::REJECTED);
+  }
+  TEST_ASSERT_EQUAL(TapFilter::NONE, taps.lookup(hal::ip(10, 0, 0, 0), TAP, strlen(TAP)));
+  TEST_ASSERT_EQUAL(TapFilter::REJECTED, taps.lookup(hal::ip(10, 0, 0, 1), TAP, strlen(TAP)));
+  TEST_ASSERT_EQUAL(TapFilter::REJECTED,
+                    taps.lookup(hal::ip(10, 0, 0, TapFilter::CACHE_SIZE), TAP, strlen(TAP)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_then_limited);
+  RUN_TEST(test_refill_at_rate);
+  RUN_TEST(test_idle_bucket_reused);
+  RUN_TEST(test_answers_cached_per_client_and_body);
+  RUN_TEST(test_cache_ring_drops_oldest);
+  return UNITY_END();
+}